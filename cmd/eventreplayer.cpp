@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "eventreplayer.h"
+#include <QFile>
+#include <QSettings>
+#include <QThread>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+EventReplayer::EventReplayer(const QString &eventFile, const QString &socket, int interval, const QString &confFile, bool quiet) :
+    ConfigFile(confFile, false, false, quiet), m_eventFile(eventFile), m_socket(socket), m_interval(interval)
+{
+
+}
+
+
+int EventReplayer::exec() const
+{
+    QString socketPath = m_socket;
+    if (socketPath.isEmpty()) {
+        int retVal = checkConfigFile();
+        if (retVal > 0) {
+            return retVal;
+        }
+
+        QSettings s(configFileName(), QSettings::IniFormat);
+        socketPath = s.value(QStringLiteral("IMAP/eventsocket")).toString();
+        if (socketPath.isEmpty()) {
+            return configError(tr("No event socket has been defined in the IMAP section of the configuration file."));
+        }
+    }
+
+    const QByteArray encodedPath = QFile::encodeName(socketPath);
+    sockaddr_un addr;
+    if (static_cast<size_t>(encodedPath.size()) >= sizeof(addr.sun_path)) {
+        return configError(tr("The path to the event socket is too long."));
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, encodedPath.constData(), static_cast<size_t>(encodedPath.size()));
+
+    QFile file(m_eventFile);
+    printStatus(tr("Opening event file"));
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text)) {
+        printFailed();
+        return fileError(tr("Failed to open event file %1: %2").arg(m_eventFile, file.errorString()));
+    }
+    printDone();
+
+    const int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return fileError(tr("Failed to create socket: %1").arg(QString::fromLocal8Bit(std::strerror(errno))));
+    }
+
+    int sent = 0;
+    int lineNo = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        ++lineNo;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        QJsonParseError jsonError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &jsonError);
+        if (jsonError.error != QJsonParseError::NoError || !doc.isObject()) {
+            printError(tr("Skipping invalid event in line %1: %2").arg(QString::number(lineNo), jsonError.errorString()));
+            continue;
+        }
+
+        if (sent > 0 && m_interval > 0) {
+            QThread::msleep(static_cast<unsigned long>(m_interval));
+        }
+
+        //: %1 will be the event type, like QuotaChange, %2 the line number
+        printStatus(tr("Sending %1 event from line %2").arg(doc.object().value(QStringLiteral("event")).toString(), QString::number(lineNo)));
+        const QByteArray datagram = notifydDatagram(line);
+        if (::sendto(fd, datagram.constData(), static_cast<size_t>(datagram.size()), 0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            printFailed();
+            const QString errorString = QString::fromLocal8Bit(std::strerror(errno));
+            ::close(fd);
+            return fileError(tr("Failed to send event to %1: %2").arg(socketPath, errorString));
+        }
+        printDone();
+        ++sent;
+    }
+
+    ::close(fd);
+
+    printSuccess(tr("Sent %n event(s) to %1.", "", sent).arg(socketPath));
+
+    return 0;
+}
+
+
+QByteArray EventReplayer::notifydDatagram(const QByteArray &event)
+{
+    // method, class, priority, user, mailbox, number of options, message, file name
+    static const char header[] = "log\0EVENT\0NOTICE\0\0\0" "0\0";
+    QByteArray datagram(header, sizeof(header) - 1);
+    datagram.reserve(datagram.size() + event.size() + 2);
+    datagram.append(event);
+    datagram.append('\0');
+    datagram.append('\0');
+    return datagram;
+}
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef EVENTREPLAYER_H
+#define EVENTREPLAYER_H
+
+#include <QCoreApplication>
+#include "configfile.h"
+
+/*!
+ * \ingroup skaffaricmd
+ * \brief Sends recorded Cyrus IMAP event notifications to the event socket of Skaffari.
+ *
+ * The event file contains one JSON encoded event notification (RFC 5423) per line, like
+ * they are sent by Cyrus IMAP. Empty lines and lines starting with \c # are ignored. Every
+ * event is sent as datagram in the notifyd format to the socket configured in IMAP/eventsocket
+ * of the configuration file or to the socket given to the constructor. This can be used to test
+ * the quota updates of Skaffari without a running Cyrus IMAP server.
+ */
+class EventReplayer : public ConfigFile
+{
+    Q_DECLARE_TR_FUNCTIONS(EventReplayer)
+public:
+    /*!
+     * \brief Constructs a new EventReplayer object.
+     * \param eventFile Path to the file containing the recorded events.
+     * \param socket    Path to the event socket, if empty, the path will be read from \a confFile.
+     * \param interval  Time in milliseconds to wait between two events.
+     * \param confFile  Absolute path to the configuration file.
+     * \param quiet     If \c true, no output will be print to stdout.
+     */
+    EventReplayer(const QString &eventFile, const QString &socket, int interval, const QString &confFile, bool quiet = false);
+
+    /*!
+     * \brief Sends all events from the event file.
+     * \return Returns \c 0 on success.
+     */
+    int exec() const;
+
+    /*!
+     * \brief Returns a datagram in the notifyd format that contains the \a event.
+     */
+    static QByteArray notifydDatagram(const QByteArray &event);
+
+private:
+    QString m_eventFile;
+    QString m_socket;
+    int m_interval = 0;
+};
+
+#endif // EVENTREPLAYER_H
@@ -30,6 +30,8 @@
 #include "webcyradmimporter.h"
 #include "tester.h"
 #include "accountstatusupdater.h"
+#include "eventreplayer.h"
+#include "passwordbenchmark.h"
 
 /*!
  * \defgroup skaffaricmd CMD
@@ -70,6 +72,24 @@ int main(int argc, char *argv[])
     QCommandLineOption updateAccountStatus(QStringLiteral("update-account-status"), QCoreApplication::translate("main", "Checks and updates the status column of every account."));
     parser.addOption(updateAccountStatus);
 
+    QCommandLineOption replayEvents(QStringLiteral("replay-events"), QCoreApplication::translate("main", "Sends recorded Cyrus IMAP event notifications to the event socket of Skaffari."), QCoreApplication::translate("main", "path to event file"));
+    parser.addOption(replayEvents);
+
+    QCommandLineOption eventSocket(QStringLiteral("event-socket"), QCoreApplication::translate("main", "Path to the event socket used by --replay-events. Default: IMAP/eventsocket from the configuration file."), QStringLiteral("socket"));
+    parser.addOption(eventSocket);
+
+    QCommandLineOption replayInterval(QStringLiteral("replay-interval"), QCoreApplication::translate("main", "Time in milliseconds to wait between two events sent by --replay-events."), QStringLiteral("msecs"), QStringLiteral("0"));
+    parser.addOption(replayInterval);
+
+    QCommandLineOption benchmarkPasswords(QStringLiteral("benchmark-passwords"), QCoreApplication::translate("main", "Measures the password hashing algorithms on this host and recommends rounds for the target time."));
+    parser.addOption(benchmarkPasswords);
+
+    QCommandLineOption targetTime(QStringLiteral("target-time"), QCoreApplication::translate("main", "Time in milliseconds hashing a single password should take, used by --benchmark-passwords. Default: 50"), QStringLiteral("msecs"), QStringLiteral("50"));
+    parser.addOption(targetTime);
+
+    QCommandLineOption writeRounds(QStringLiteral("write-rounds"), QCoreApplication::translate("main", "Writes the rounds recommended by --benchmark-passwords for the configured algorithms to the configuration file."));
+    parser.addOption(writeRounds);
+
     parser.process(app);
 
     if (parser.isSet(setup)) {
@@ -96,6 +116,16 @@ int main(int argc, char *argv[])
         AccountStatusUpdater asu(parser.value(iniPath), parser.isSet(quiet));
         return asu.exec();
 
+    } else if (parser.isSet(replayEvents)) {
+
+        EventReplayer replayer(parser.value(replayEvents), parser.value(eventSocket), parser.value(replayInterval).toInt(), parser.value(iniPath), parser.isSet(quiet));
+        return replayer.exec();
+
+    } else if (parser.isSet(benchmarkPasswords)) {
+
+        PasswordBenchmark benchmark(parser.value(iniPath), parser.value(targetTime).toInt(), parser.isSet(writeRounds), parser.isSet(quiet));
+        return benchmark.exec();
+
     } else {
         parser.showHelp(1);
     }
@@ -0,0 +1,274 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "passwordbenchmark.h"
+#include "../common/config.h"
+
+#include <Cutelyst/Plugins/Authentication/credentialpassword.h>
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QSettings>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#define SK_PWBENCH_SAMPLES 3
+#define SK_PWBENCH_PASSWORD "Sk4ff4ri-B3nchm4rk"
+
+PasswordBenchmark::PasswordBenchmark(const QString &confFile, int targetMsecs, bool writeRounds, bool quiet) :
+    ConfigFile(confFile, false, writeRounds, quiet), m_targetMsecs(targetMsecs), m_writeRounds(writeRounds)
+{
+
+}
+
+
+int PasswordBenchmark::exec() const
+{
+    if (m_targetMsecs < 1) {
+        return inputError(tr("The target time has to be at least one millisecond."));
+    }
+
+    Password::Method accMethod = static_cast<Password::Method>(SK_DEF_ACC_PWMETHOD);
+    Password::Algorithm accAlgo = static_cast<Password::Algorithm>(SK_DEF_ACC_PWALGORITHM);
+    quint8 admAlgo = SK_DEF_ADM_PWALGORITHM;
+
+    if (exists() || m_writeRounds) {
+        const int rc = checkConfigFile();
+        if (rc > 0) {
+            return rc;
+        }
+
+        QSettings s(configFileName(), QSettings::IniFormat);
+        accMethod = static_cast<Password::Method>(s.value(QStringLiteral("Accounts/pwmethod"), SK_DEF_ACC_PWMETHOD).value<quint8>());
+        accAlgo = static_cast<Password::Algorithm>(s.value(QStringLiteral("Accounts/pwalgorithm"), SK_DEF_ACC_PWALGORITHM).value<quint8>());
+        admAlgo = s.value(QStringLiteral("Admins/pwalgorithm"), SK_DEF_ADM_PWALGORITHM).value<quint8>();
+        if (admAlgo < SK_MIN_ADM_PWALGORITHM || admAlgo > SK_MAX_ADM_PWALGORITHM) {
+            return configError(tr("Invalid value for the administrator password hashing algorithm."));
+        }
+    }
+
+    if (accMethod == Password::Crypt && accAlgo == Password::Default) {
+        accAlgo = Password::CryptSHA256;
+    }
+
+    // the weak methods would print a warning on every single run
+    QLoggingCategory::setFilterRules(QStringLiteral("skaffari.password.warning=false"));
+
+    printMessage(tr("Measuring password hashing on this host. Every value is the median of %n run(s).", "", SK_PWBENCH_SAMPLES));
+
+    const auto resultRow = [](const Result &r) -> std::pair<QString,QString> {
+        const QString label = r.rounds > 0 ? tr("%1 (%2 rounds)").arg(r.name, QString::number(r.rounds)) : r.name;
+        return std::make_pair(label, r.msecs < 0.0 ? tr("not supported") : formatMsecs(r.msecs));
+    };
+
+    // account passwords
+
+    std::vector<std::pair<QString,QString>> accTable;
+
+    const std::vector<std::pair<Password::Method,Password::Algorithm>> fixedCost({
+                                                                                      {Password::PlainText, Password::Default},
+                                                                                      {Password::MD5, Password::Default},
+                                                                                      {Password::SHA1, Password::Default},
+                                                                                      {Password::MySQL, Password::MySQLOld},
+                                                                                      {Password::MySQL, Password::MySQLNew},
+                                                                                      {Password::Crypt, Password::CryptDES},
+                                                                                      {Password::Crypt, Password::CryptMD5}
+                                                                                  });
+    for (const auto &ma : fixedCost) {
+        Result r;
+        r.name = ma.first == Password::Crypt ? Password::methodToString(ma.first) + QLatin1Char(' ') + Password::algorithmToString(ma.second) : (ma.first == Password::MySQL ? Password::algorithmToString(ma.second) : Password::methodToString(ma.first));
+        printStatus(tr("Measuring %1").arg(r.name));
+        r.msecs = measureAccount(ma.first, ma.second, 0);
+        printDone();
+        accTable.push_back(resultRow(r));
+    }
+
+    // the last, most expensive measurement of every algorithm is used to calculate the recommendation
+    Result accResults[3];
+    const std::array<Password::Algorithm,3> roundAlgos({Password::CryptSHA256, Password::CryptSHA512, Password::CryptBcrypt});
+    for (std::size_t i = 0; i < roundAlgos.size(); ++i) {
+        const Password::Algorithm algo = roundAlgos.at(i);
+        const std::vector<quint32> roundsList = (algo == Password::CryptBcrypt) ? std::vector<quint32>({8, 10, 12}) : std::vector<quint32>({5000, SK_DEF_ACC_PWROUNDS, 100000});
+        for (quint32 rounds : roundsList) {
+            Result r;
+            r.name = Password::methodToString(Password::Crypt) + QLatin1Char(' ') + Password::algorithmToString(algo);
+            r.rounds = rounds;
+            printStatus(tr("Measuring %1 with %2 rounds").arg(r.name, QString::number(rounds)));
+            r.msecs = measureAccount(Password::Crypt, algo, rounds);
+            printDone();
+            accTable.push_back(resultRow(r));
+            accResults[i] = r;
+        }
+    }
+
+    printTable(accTable, tr("Account passwords"));
+
+    // administrator passwords
+
+    std::vector<std::pair<QString,QString>> admTable;
+    Result admResults[SK_MAX_ADM_PWALGORITHM - SK_MIN_ADM_PWALGORITHM + 1];
+
+    for (quint8 algo = SK_MIN_ADM_PWALGORITHM; algo <= SK_MAX_ADM_PWALGORITHM; ++algo) {
+        for (quint32 rounds : {10000U, static_cast<quint32>(SK_DEF_ADM_PWROUNDS), 100000U}) {
+            Result r;
+            r.name = pbkdf2Name(algo);
+            r.rounds = rounds;
+            printStatus(tr("Measuring %1 with %2 rounds").arg(r.name, QString::number(rounds)));
+            r.msecs = measureAdmin(static_cast<QCryptographicHash::Algorithm>(algo), rounds);
+            printDone();
+            admTable.push_back(resultRow(r));
+            admResults[algo - SK_MIN_ADM_PWALGORITHM] = r;
+        }
+    }
+
+    printTable(admTable, tr("Administrator passwords"));
+
+    // recommendations
+
+    quint32 accRounds = 0;
+    const quint32 admRounds = linearRounds(admResults[admAlgo - SK_MIN_ADM_PWALGORITHM], m_targetMsecs, 1000, std::numeric_limits<qint32>::max());
+
+    std::vector<std::pair<QString,QString>> recTable;
+    for (std::size_t i = 0; i < roundAlgos.size(); ++i) {
+        const Result &r = accResults[i];
+        const bool bcrypt = (roundAlgos.at(i) == Password::CryptBcrypt);
+        const quint32 rounds = bcrypt ? bcryptCost(r, m_targetMsecs) : linearRounds(r, m_targetMsecs, 1000, 999999999);
+        if (accMethod == Password::Crypt && accAlgo == roundAlgos.at(i)) {
+            accRounds = rounds;
+        }
+        recTable.emplace_back(r.name, rounds > 0 ? QString::number(rounds) : tr("not supported"));
+    }
+    for (const Result &r : admResults) {
+        const quint32 rounds = linearRounds(r, m_targetMsecs, 1000, std::numeric_limits<qint32>::max());
+        recTable.emplace_back(r.name, rounds > 0 ? QString::number(rounds) : tr("not supported"));
+    }
+
+    //: %1 will be the target time in milliseconds
+    printTable(recTable, tr("Recommended rounds for %1 ms").arg(m_targetMsecs));
+
+    if (accRounds > 0) {
+        printMessage(tr("Recommended value for Accounts/pwrounds with %1: %2").arg(Password::algorithmToString(accAlgo), QString::number(accRounds)));
+    } else {
+        printMessage(tr("There is no rounds recommendation for the configured account password algorithm."));
+    }
+    if (admRounds > 0) {
+        printMessage(tr("Recommended value for Admins/pwrounds with %1: %2").arg(pbkdf2Name(admAlgo), QString::number(admRounds)));
+    }
+
+    if (m_writeRounds) {
+        printStatus(tr("Writing recommended rounds to configuration file"));
+        QSettings s(configFileName(), QSettings::IniFormat);
+        if (accRounds > 0) {
+            s.setValue(QStringLiteral("Accounts/pwrounds"), accRounds);
+        }
+        if (admRounds > 0) {
+            s.setValue(QStringLiteral("Admins/pwrounds"), admRounds);
+        }
+        s.sync();
+        if (s.status() != QSettings::NoError) {
+            printFailed();
+            return fileError(tr("Failed to write the configuration file at %1.").arg(configFileName()));
+        }
+        printDone();
+    }
+
+    return 0;
+}
+
+
+double PasswordBenchmark::measureAccount(Password::Method method, Password::Algorithm algo, quint32 rounds)
+{
+    const Password pw(QStringLiteral(SK_PWBENCH_PASSWORD));
+    std::array<double,SK_PWBENCH_SAMPLES> samples;
+    QElapsedTimer timer;
+    for (double &sample : samples) {
+        timer.start();
+        const QByteArray enc = pw.encrypt(method, algo, rounds);
+        sample = static_cast<double>(timer.nsecsElapsed()) / 1000000.0;
+        if (enc.isEmpty()) {
+            return -1.0;
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() / 2);
+}
+
+
+double PasswordBenchmark::measureAdmin(QCryptographicHash::Algorithm algo, quint32 rounds)
+{
+    const QByteArray pw = QByteArrayLiteral(SK_PWBENCH_PASSWORD);
+    std::array<double,SK_PWBENCH_SAMPLES> samples;
+    QElapsedTimer timer;
+    for (double &sample : samples) {
+        timer.start();
+        const QByteArray enc = Cutelyst::CredentialPassword::createPassword(pw, algo, static_cast<int>(rounds), 24, 27);
+        sample = static_cast<double>(timer.nsecsElapsed()) / 1000000.0;
+        if (enc.isEmpty()) {
+            return -1.0;
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() / 2);
+}
+
+
+quint32 PasswordBenchmark::linearRounds(const Result &result, int targetMsecs, quint32 minRounds, quint32 maxRounds)
+{
+    if (result.msecs <= 0.0 || result.rounds == 0) {
+        return 0;
+    }
+
+    // the time grows linearly with the rounds, round down to full thousands
+    const double rounds = std::floor(static_cast<double>(result.rounds) * targetMsecs / result.msecs / 1000.0) * 1000.0;
+    return static_cast<quint32>(std::clamp(rounds, static_cast<double>(minRounds), static_cast<double>(maxRounds)));
+}
+
+
+quint32 PasswordBenchmark::bcryptCost(const Result &result, int targetMsecs)
+{
+    if (result.msecs <= 0.0 || result.rounds == 0) {
+        return 0;
+    }
+
+    // the cost is the base-2 logarithm of the rounds, so every step doubles the time
+    const double cost = static_cast<double>(result.rounds) + std::floor(std::log2(targetMsecs / result.msecs));
+    return static_cast<quint32>(std::clamp(cost, 4.0, 31.0));
+}
+
+
+QString PasswordBenchmark::pbkdf2Name(quint8 algo)
+{
+    switch (algo) {
+    case 3:
+        return QStringLiteral("PBKDF2 SHA-224");
+    case 4:
+        return QStringLiteral("PBKDF2 SHA-256");
+    case 5:
+        return QStringLiteral("PBKDF2 SHA-384");
+    case 6:
+        return QStringLiteral("PBKDF2 SHA-512");
+    case 7:
+        return QStringLiteral("PBKDF2 SHA3-224");
+    case 8:
+        return QStringLiteral("PBKDF2 SHA3-256");
+    case 9:
+        return QStringLiteral("PBKDF2 SHA3-384");
+    case 10:
+        return QStringLiteral("PBKDF2 SHA3-512");
+    default:
+        return QStringLiteral("PBKDF2");
+    }
+}
+
+
+QString PasswordBenchmark::formatMsecs(double msecs)
+{
+    //: time in milliseconds
+    return tr("%1 ms").arg(msecs, 0, 'f', 2);
+}
@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef PASSWORDBENCHMARK_H
+#define PASSWORDBENCHMARK_H
+
+#include "configfile.h"
+#include "../common/password.h"
+
+#include <QCryptographicHash>
+
+/*!
+ * \ingroup skaffaricmd
+ * \brief Measures the password hashing algorithms on the current host and recommends iteration counts.
+ *
+ * All account password methods and algorithms and the PBKDF2 algorithms for administrator
+ * passwords are timed with different iteration counts. From these measurements the iteration
+ * counts are calculated that need about the target time for hashing a single password. The
+ * recommended values for the configured algorithms can be written to the configuration file.
+ */
+class PasswordBenchmark : public ConfigFile
+{
+    Q_DECLARE_TR_FUNCTIONS(PasswordBenchmark)
+public:
+    /*!
+     * \brief Constructs a new PasswordBenchmark object.
+     * \param confFile      Absolute path to the configuration file.
+     * \param targetMsecs   Time in milliseconds hashing a single password should take.
+     * \param writeRounds   Set to \c true to write the recommended rounds for the configured algorithms to \a confFile.
+     * \param quiet         If \c true, no output will be print to stdout.
+     */
+    PasswordBenchmark(const QString &confFile, int targetMsecs, bool writeRounds, bool quiet = false);
+
+    /*!
+     * \brief Runs the benchmark.
+     * \return Returns \c 0 on success.
+     */
+    int exec() const;
+
+private:
+    struct Result {
+        QString name;
+        quint32 rounds = 0;
+        double msecs = 0.0;
+    };
+
+    static double measureAccount(Password::Method method, Password::Algorithm algo, quint32 rounds);
+    static double measureAdmin(QCryptographicHash::Algorithm algo, quint32 rounds);
+    static quint32 linearRounds(const Result &result, int targetMsecs, quint32 minRounds, quint32 maxRounds);
+    static quint32 bcryptCost(const Result &result, int targetMsecs);
+    static QString pbkdf2Name(quint8 algo);
+    static QString formatMsecs(double msecs);
+
+    int m_targetMsecs = 50;
+    bool m_writeRounds = false;
+};
+
+#endif // PASSWORDBENCHMARK_H
@@ -16,16 +16,98 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#define _XOPEN_SOURCE
 #include "password.h"
-#include <unistd.h>
-#include <QSqlQuery>
-#include <QFile>
-#include <Cutelyst/Plugins/Utils/Sql>
+#include "../common/config.h"
+#include <crypt.h>
+#include <QRandomGenerator>
 #include <QCryptographicHash>
+#include <memory>
 
 Q_LOGGING_CATEGORY(SK_PASSWORD, "skaffari.password")
 
+namespace {
+
+/*!
+ * \internal
+ * \brief Calls the reentrant crypt function with data owned by the current thread.
+ *
+ * struct crypt_data is too large to be placed into the static TLS block of a
+ * dlopen()ed application library, so it is allocated zero initialized on first use.
+ */
+QByteArray cryptThreadSafe(const QByteArray &phrase, const QByteArray &settings)
+{
+    thread_local std::unique_ptr<crypt_data> data;
+    if (!data) {
+        data = std::make_unique<crypt_data>();
+    }
+
+#ifdef HAVE_CRYPT_RN
+    const char *result = crypt_rn(phrase.constData(), settings.constData(), data.get(), static_cast<int>(sizeof(crypt_data)));
+#else
+    const char *result = crypt_r(phrase.constData(), settings.constData(), data.get());
+#endif
+
+    // failure is either a null pointer or, with some implementations, a string starting with "*"
+    if (Q_UNLIKELY(!result || result[0] == '*')) {
+        return QByteArray();
+    }
+
+    return QByteArray(result);
+}
+
+/*!
+ * \internal
+ * \brief Returns the same hash as the PASSWORD() function of MySQL 4.1 and newer.
+ *
+ * This is the uppercase hex encoded SHA1 hash of the binary SHA1 hash of \a phrase,
+ * prefixed by an asterisk. An empty \a phrase results in an empty hash.
+ */
+QByteArray mysqlNewPassword(const QByteArray &phrase)
+{
+    if (phrase.isEmpty()) {
+        return QByteArray();
+    }
+
+    const QByteArray stage1 = QCryptographicHash::hash(phrase, QCryptographicHash::Sha1);
+    QByteArray hash = QByteArrayLiteral("*");
+    hash.append(QCryptographicHash::hash(stage1, QCryptographicHash::Sha1).toHex().toUpper());
+    return hash;
+}
+
+/*!
+ * \internal
+ * \brief Returns the same hash as the OLD_PASSWORD() function of MySQL.
+ *
+ * Spaces and tabs in \a phrase are ignored like MySQL does. An empty \a phrase
+ * results in an empty hash.
+ */
+QByteArray mysqlOldPassword(const QByteArray &phrase)
+{
+    if (phrase.isEmpty()) {
+        return QByteArray();
+    }
+
+    quint32 nr = 1345345333U;
+    quint32 add = 7U;
+    quint32 nr2 = 0x12345671U;
+
+    for (const char ch : phrase) {
+        if (ch == ' ' || ch == '\t') {
+            continue;
+        }
+        const auto tmp = static_cast<quint32>(static_cast<uchar>(ch));
+        nr ^= (((nr & 63U) + add) * tmp) + (nr << 8);
+        nr2 += (nr2 << 8) ^ nr;
+        add += tmp;
+    }
+
+    QByteArray hash = QByteArray::number(nr & 0x7fffffffU, 16).rightJustified(8, '0');
+    hash.append(QByteArray::number(nr2 & 0x7fffffffU, 16).rightJustified(8, '0'));
+    return hash;
+}
+
+}
+
 Password::Password(const QString &pw) :
     m_password(pw)
 {
@@ -45,12 +127,10 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
     } else if (method == Crypt) {
 
         QByteArray settings;
-        uint pwSize = 0;
 
         if (algo == CryptDES) {
 
-            settings = Password::requestSalt(2, QByteArrayLiteral("./0123456789ABCDEFGHIJKLMNJOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"));
-            pwSize = 13;
+            settings = Password::requestSalt(2);
             qCWarning(SK_PASSWORD) << "Do not use weak hashing/encryption methods for passwords!";
 
         } else if (algo == CryptMD5) {
@@ -58,7 +138,6 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
             settings = QByteArrayLiteral("$1$");
             settings.append(Password::requestSalt(8));
             settings.append(QByteArrayLiteral("$"));
-            pwSize = (settings.size() + 22);
             qCWarning(SK_PASSWORD) << "Do not use weak hashing/encryption methods for passwords!";
 
         } else if ((algo == CryptSHA256) || (algo == CryptSHA512) || (algo == Default)) {
@@ -77,18 +156,11 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
 
             settings.append(QByteArray::number(rounds));
             settings.append(QByteArrayLiteral("$"));
-            settings.append(Password::requestSalt(16, QByteArrayLiteral("./0123456789ABCDEFGHIJKLMNJOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz")));
+            settings.append(Password::requestSalt(16));
             settings.append(QByteArrayLiteral("$"));
 
-            if (algo == CryptSHA512) {
-                pwSize = (settings.size() + 86);
-            } else {
-                pwSize = (settings.size() + 43);
-            }
-
         } else if (algo == CryptBcrypt) {
 
-            pwSize = 60;
             settings = QByteArrayLiteral("$2y$");
             if (rounds < 4) {
                 rounds = 4;
@@ -101,7 +173,7 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
             }
             settings.append(QByteArray::number(rounds));
             settings.append(QByteArrayLiteral("$"));
-            settings.append(Password::requestSalt(22, QByteArrayLiteral("./0123456789ABCDEFGHIJKLMNJOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz")));
+            settings.append(Password::requestSalt(22));
             settings.append(QByteArrayLiteral("$"));
 
         } else {
@@ -111,21 +183,17 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
 
         }
 
-        pw = QByteArray(crypt(m_password.toUtf8().constData(), settings.constData()), pwSize);
+        pw = cryptThreadSafe(m_password.toUtf8(), settings);
+        if (Q_UNLIKELY(pw.isEmpty())) {
+            qCCritical(SK_PASSWORD) << "Failed to encrypt password with crypt(3) and algorithm" << algo;
+        }
 
     } else if (method == MySQL) {
 
-        QSqlQuery q;
         if (algo == MySQLOld) {
-            q = CPreparedSqlQueryThread(QStringLiteral("SELECT OLD_PASSWORD(:pw)"));
-        } else {
-            q = CPreparedSqlQueryThread(QStringLiteral("SELECT PASSWORD(:pw)"));
-        }
-        q.bindValue(QStringLiteral(":pw"), m_password);
-        if (q.exec() && q.next()) {
-            pw = q.value(0).toString().toUtf8();
+            pw = mysqlOldPassword(m_password.toUtf8());
         } else {
-            qCCritical(SK_PASSWORD) << "Failed to use MySQL password function.";
+            pw = mysqlNewPassword(m_password.toUtf8());
         }
         qCWarning(SK_PASSWORD) << "Do not use weak hashing/encryption methods for passwords!";
 
@@ -148,8 +216,6 @@ QByteArray Password::encrypt(Method method, Algorithm algo, quint32 rounds) cons
     return pw;
 }
 
-
-
 bool Password::check(const QByteArray &savedPw)
 {
     bool ret = false;
@@ -215,29 +281,31 @@ QString Password::algorithmToString(quint8 algorithm)
 
 QByteArray Password::requestSalt(quint16 length, const QByteArray &allowedChars)
 {
-    QByteArray salt;
+    // the alphabet used by crypt(3) for salts
+    static const QByteArray cryptChars = QByteArrayLiteral("./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
 
-    QFile random(QStringLiteral("/dev/urandom"));
-    if (Q_UNLIKELY(!random.open(QIODevice::ReadOnly))) {
-    }
+    const QByteArray &chars = allowedChars.isEmpty() ? cryptChars : allowedChars;
+    Q_ASSERT_X(chars.size() <= 256, "request salt", "more than 256 allowed characters");
 
-    if (allowedChars.isEmpty()) {
-        salt = random.read(length).toBase64();
-    } else {
-        const QByteArray rand = random.read(4 * length).toBase64();
-        int i = 0;
-        while ((salt.size() < length) && (i < (4 * length))) {
-            char part = rand.at(i);
-            if (allowedChars.contains(part)) {
-                salt.append(part);
+    QByteArray salt;
+    salt.reserve(length);
+
+    // random bytes above the largest multiple of the alphabet size are
+    // rejected, otherwise the first characters would be more likely
+    const int charsCount = chars.size();
+    const int limit = 256 - (256 % charsCount);
+
+    QRandomGenerator *rand = QRandomGenerator::system();
+    quint32 buf[8];
+    while (salt.size() < length) {
+        rand->fillRange(buf);
+        const auto bytes = reinterpret_cast<const uchar*>(buf);
+        for (std::size_t i = 0; i < sizeof(buf) && salt.size() < length; ++i) {
+            if (bytes[i] < limit) {
+                salt.append(chars.at(bytes[i] % charsCount));
             }
-            ++i;
         }
     }
 
-    if (salt.size() > length) {
-        salt.chop(salt.size() - length);
-    }
-
     return salt;
 }
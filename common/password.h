@@ -45,7 +45,7 @@ public:
     enum Method : quint8 {
         PlainText       = 0,    /**< No encryption, passwords stored in plaintext. (HIGHLY DISCOURAGED) */
         Crypt           = 1,    /**< Use crypt(3) function. */
-        MySQL           = 2,    /**< Use MySQL PASSWORD() function. */
+        MySQL           = 2,    /**< Use the hashing of the MySQL PASSWORD() function, computed locally. */
         MD5             = 3,    /**< Use plain hex MD5. Not recommended.*/
         SHA1            = 4     /**< Use plain hex SHA1. */
     };
@@ -124,10 +124,10 @@ private:
     /*!
      * \brief Requests a salt value of given \a length and with the \a allowed characters.
      *
-     * This uses \c /dev/urandom to request pseudo random numbers.
+     * This uses QRandomGenerator::system() to request cryptographically secure random numbers.
      *
      * \param length        Length of the salt value.
-     * \param allowedChars  Array of allowed characters.
+     * \param allowedChars  Array of allowed characters, if empty, the crypt(3) salt characters are used.
      * \return              Byte array that can be used as salt.
      */
     static QByteArray requestSalt(quint16 length, const QByteArray &allowedChars = QByteArray());
@@ -26,6 +26,7 @@
 #include "objects/helpentry.h"
 #include "utils/skaffariconfig.h"
 #include "utils/utils.h"
+#include "utils/listversion.h"
 #include "validators/skvalidatordomainexists.h"
 #include "../common/global.h"
 
@@ -1020,6 +1021,9 @@ void AccountEditor::list(Context *c)
     const dbid_t domainId = Utils::strToDbid(c->req()->queryParam(QStringLiteral("domainId"), QStringLiteral("0")), &ok);
     if (Q_LIKELY(ok)) {
         const QString searchString = c->req()->queryParam(QStringLiteral("searchString"));
+        if (ListVersion::notModified(c, ListVersion::accountsTag(c, domainId, searchString.toUtf8()))) {
+            return;
+        }
         SkaffariError e(c);
         const QJsonArray accounts = SimpleAccount::listJson(c, e, AdminAccount::getUserType(c), AdminAccount::getUserId(c), domainId, searchString);
         QJsonObject o({{QStringLiteral("accounts"), accounts}});
@@ -18,6 +18,8 @@
 
 #include "autoconfig.h"
 #include "utils/skaffariconfig.h"
+#include "utils/autoconfigcache.h"
+#include "utils/aliasfilter.h"
 #include "objects/autoconfigserver.h"
 #include "objects/skaffarierror.h"
 #include <Cutelyst/Plugins/Utils/validatoremail.h>
@@ -25,10 +27,7 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QUrl>
-#include <QDomDocument>
-#include <QDomElement>
-#include <QDomAttr>
-#include <QDomText>
+#include <QXmlStreamWriter>
 
 Q_LOGGING_CATEGORY(SK_AUTOCONFIG, "skaffari.autoconfig")
 
@@ -63,6 +62,13 @@ void Autoconfig::index(Context *c)
         return;
     }
 
+    if (!AliasFilter::mightExist(email)) {
+        qCWarning(SK_AUTOCONFIG, "Autoconfiguration requested for unknown email address %s from %s", qUtf8Printable(email), qUtf8Printable(c->req()->addressString()));
+        c->res()->setBody(c->translate("Autoconfig", "Email address not found."));
+        c->res()->setStatus(Response::NotFound);
+        return;
+    }
+
     QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("SELECT username FROM virtual WHERE alias = :alias"));
     q.bindValue(QStringLiteral(":alias"), email);
 
@@ -76,6 +82,7 @@ void Autoconfig::index(Context *c)
     const QString username = q.next() ? q.value(0).toString() : QString();
 
     if (username.isEmpty()) {
+        AliasFilter::addMiss(email);
         qCWarning(SK_AUTOCONFIG, "Autoconfiguration requested for unknown email address %s from %s", qUtf8Printable(email), qUtf8Printable(c->req()->addressString()));
         c->res()->setBody(c->translate("Autoconfig", "Email address not found."));
         c->res()->setStatus(Response::NotFound);
@@ -84,6 +91,12 @@ void Autoconfig::index(Context *c)
 
     const QString mailDomain = email.mid(email.lastIndexOf(QLatin1Char('@')) + 1);
 
+    const QString cacheKey = QLatin1String("autoconfig\n") + mailDomain + QLatin1Char('\n') + username;
+    if (const auto cached = AutoconfigCache::value(cacheKey)) {
+        AutoconfigCache::send(c, *cached, QStringLiteral("text/xml; charset=utf-8"));
+        return;
+    }
+
     q = CPreparedSqlQueryThread(QStringLiteral("SELECT id, autoconfig FROM domain WHERE domain_name = :domain_name"));
     q.bindValue(QStringLiteral(":domain_name"), mailDomain);
 
@@ -126,106 +139,88 @@ void Autoconfig::index(Context *c)
         return;
     }
 
-    QStringList providerDomains{SkaffariConfig::autoconfigId()};
-    if (SkaffariConfig::autoconfigId() != mailDomain) {
-        providerDomains.push_back(mailDomain);
-    }
+    const QString providerId = SkaffariConfig::autoconfigId();
 
-    QDomDocument xml;
+    QByteArray body;
+    QXmlStreamWriter xml(&body);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(2);
 
-    auto root = xml.createElement(QStringLiteral("clientConfig"));
-    root.setAttribute(QStringLiteral("version"), QStringLiteral("1.1"));
-    xml.appendChild(root);
+    xml.writeStartDocument();
+    xml.writeStartElement(QStringLiteral("clientConfig"));
+    xml.writeAttribute(QStringLiteral("version"), QStringLiteral("1.1"));
 
-    auto provider = xml.createElement(QStringLiteral("emailProvider"));
-    provider.setAttribute(QStringLiteral("id"), SkaffariConfig::autoconfigId());
-    root.appendChild(provider);
+    xml.writeStartElement(QStringLiteral("emailProvider"));
+    xml.writeAttribute(QStringLiteral("id"), providerId);
 
-    for (const QString &d : providerDomains) {
-        auto providerDomain = xml.createElement(QStringLiteral("domain"));
-        provider.appendChild(providerDomain);
-        providerDomain.appendChild(xml.createTextNode(d));
+    xml.writeTextElement(QStringLiteral("domain"), providerId);
+    if (providerId != mailDomain) {
+        xml.writeTextElement(QStringLiteral("domain"), mailDomain);
     }
 
-    auto displayName = xml.createElement(QStringLiteral("displayName"));
-    provider.appendChild(displayName);
-    displayName.appendChild(xml.createTextNode(SkaffariConfig::autoconfigDisplayName()));
-
-    auto displayShortName = xml.createElement(QStringLiteral("displayShortName"));
-    provider.appendChild(displayShortName);
-    displayShortName.appendChild(xml.createTextNode(SkaffariConfig::autoconfigDisplayNameShort()));
+    xml.writeTextElement(QStringLiteral("displayName"), SkaffariConfig::autoconfigDisplayName());
+    xml.writeTextElement(QStringLiteral("displayShortName"), SkaffariConfig::autoconfigDisplayNameShort());
 
     for (const AutoconfigServer &server : servers) {
-        QDomElement s;
         switch (server.type()) {
         case AutoconfigServer::Imap:
-            s = xml.createElement(QStringLiteral("incomingServer"));
-            s.setAttribute(QStringLiteral("type"), QStringLiteral("imap"));
+            xml.writeStartElement(QStringLiteral("incomingServer"));
+            xml.writeAttribute(QStringLiteral("type"), QStringLiteral("imap"));
             break;
         case AutoconfigServer::Pop3:
-            s = xml.createElement(QStringLiteral("incomingServer"));
-            s.setAttribute(QStringLiteral("type"), QStringLiteral("pop3"));
+            xml.writeStartElement(QStringLiteral("incomingServer"));
+            xml.writeAttribute(QStringLiteral("type"), QStringLiteral("pop3"));
             break;
         case AutoconfigServer::Smtp:
-            s = xml.createElement(QStringLiteral("outgoingServer"));
-            s.setAttribute(QStringLiteral("type"), QStringLiteral("smtp"));
+            xml.writeStartElement(QStringLiteral("outgoingServer"));
+            xml.writeAttribute(QStringLiteral("type"), QStringLiteral("smtp"));
             break;
         }
-        provider.appendChild(s);
-
-        auto host = xml.createElement(QStringLiteral("hostname"));
-        s.appendChild(host);
-        host.appendChild(xml.createTextNode(server.hostname()));
 
-        auto port = xml.createElement(QStringLiteral("port"));
-        s.appendChild(port);
-        port.appendChild(xml.createTextNode(QString::number(server.port())));
+        xml.writeTextElement(QStringLiteral("hostname"), server.hostname());
+        xml.writeTextElement(QStringLiteral("port"), QString::number(server.port()));
 
-        auto socketType = xml.createElement(QStringLiteral("socketType"));
-        s.appendChild(socketType);
         switch (server.socketType()) {
         case AutoconfigServer::Plain:
-            socketType.appendChild(xml.createTextNode(QStringLiteral("plain")));
+            xml.writeTextElement(QStringLiteral("socketType"), QStringLiteral("plain"));
             break;
         case AutoconfigServer::StartTls:
-            socketType.appendChild(xml.createTextNode(QStringLiteral("STARTTLS")));
+            xml.writeTextElement(QStringLiteral("socketType"), QStringLiteral("STARTTLS"));
             break;
         case AutoconfigServer::Ssl:
-            socketType.appendChild(xml.createTextNode(QStringLiteral("SSL")));
+            xml.writeTextElement(QStringLiteral("socketType"), QStringLiteral("SSL"));
             break;
         }
 
-        auto authentication = xml.createElement(QStringLiteral("authentication"));
-        s.appendChild(authentication);
         switch (server.authentication()) {
         case AutoconfigServer::Cleartext:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("password-cleartext")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("password-cleartext"));
             break;
         case AutoconfigServer::Encrypted:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("password-encrypted")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("password-encrypted"));
             break;
         case AutoconfigServer::Ntlm:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("NTLM")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("NTLM"));
             break;
         case AutoconfigServer::Gssapi:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("GSSAPI")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("GSSAPI"));
             break;
         case AutoconfigServer::ClientIpAddress:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("client-IP-address")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("client-IP-address"));
             break;
         case AutoconfigServer::TlsClientCert:
-            authentication.appendChild(xml.createTextNode(QStringLiteral("TLS-client-cert")));
+            xml.writeTextElement(QStringLiteral("authentication"), QStringLiteral("TLS-client-cert"));
             break;
         }
 
-        auto user = xml.createElement(QStringLiteral("username"));
-        s.appendChild(user);
-        user.appendChild(xml.createTextNode(username));
+        xml.writeTextElement(QStringLiteral("username"), username);
 
+        xml.writeEndElement();
     }
 
-    c->res()->setBody(xml.toString(2));
-    c->res()->setContentType(QStringLiteral("text/xml; charset=utf-8"));
+    xml.writeEndDocument();
+
+    AutoconfigCache::send(c, AutoconfigCache::insert(cacheKey, body), QStringLiteral("text/xml; charset=utf-8"));
 }
 
 #include "moc_autoconfig.cpp"
@@ -18,6 +18,8 @@
 
 #include "autodiscover.h"
 #include "utils/skaffariconfig.h"
+#include "utils/autoconfigcache.h"
+#include "utils/aliasfilter.h"
 #include "objects/autoconfigserver.h"
 #include "objects/skaffarierror.h"
 #include <Cutelyst/Plugins/Utils/validatoremail.h>
@@ -25,16 +27,16 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QUrl>
-#include <QDomDocument>
-#include <QDomElement>
-#include <QDomAttr>
-#include <QDomText>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include <QTime>
 #include <QDateTime>
 #include <QCryptographicHash>
 
 Q_LOGGING_CATEGORY(SK_AUTODISCOVER, "skaffari.autoconfig")
 
+#define SK_AUTODISCOVER_MAX_REQUEST_SIZE 16384
+
 using namespace Cutelyst;
 
 Autodiscover::Autodiscover(QObject *parent)
@@ -62,6 +64,13 @@ void Autodiscover::index(Context *c)
 //        return;
 //    }
 
+    // Outlook requests are only a few hundred bytes, reject larger ones by their announced size
+    if (c->req()->headers().contentLength() > SK_AUTODISCOVER_MAX_REQUEST_SIZE) {
+        qCWarning(SK_AUTODISCOVER, "Autodiscover request from %s announces a body that exceeds the size limit.", qUtf8Printable(c->req()->addressString()));
+        setError(c, Response::RequestEntityTooLarge, c->translate("Autodiscover", "Request is too large."), 600);
+        return;
+    }
+
     QString email;
 //    const int mapiCapable = c->req()->header(QStringLiteral("X-MapiHttpCapability")).toInt();
 //    if (mapiCapable > 0) {
@@ -69,24 +78,43 @@ void Autodiscover::index(Context *c)
 //    }
 
     if (email.isEmpty() && c->req()->body()) {
-        if (!c->req()->body()->open(QIODevice::ReadOnly)) {
+        QIODevice *body = c->req()->body();
+
+        // fallback for requests without Content-Length, like chunked ones
+        if (body->size() > SK_AUTODISCOVER_MAX_REQUEST_SIZE) {
+            qCWarning(SK_AUTODISCOVER, "Autodiscover request body from %s exceeds the size limit.", qUtf8Printable(c->req()->addressString()));
+            setError(c, Response::RequestEntityTooLarge, c->translate("Autodiscover", "Request is too large."), 600);
+            return;
+        }
+
+        if (!body->open(QIODevice::ReadOnly)) {
             qCWarning(SK_AUTODISCOVER, "%s", "Failed to parse autodiscover request xml.");
             setError(c, Response::InternalServerError, c->translate("Autodiscover", "Internal server error."), 603);
             return;
         }
 
-        QDomDocument xml;
-        QString errorMsg;
+        QXmlStreamReader xml(body);
+        bool inRequest = false;
+        while (!xml.atEnd()) {
+            const QXmlStreamReader::TokenType token = xml.readNext();
+            if (token == QXmlStreamReader::StartElement) {
+                if (xml.name() == QLatin1String("Request")) {
+                    inRequest = true;
+                } else if (inRequest && xml.name() == QLatin1String("EMailAddress")) {
+                    email = xml.readElementText().trimmed();
+                    break;
+                }
+            } else if (token == QXmlStreamReader::EndElement && xml.name() == QLatin1String("Request")) {
+                inRequest = false;
+            }
+        }
+        body->close();
 
-        if (!xml.setContent(c->req()->body(), &errorMsg)) {
+        if (xml.hasError()) {
             qCWarning(SK_AUTODISCOVER, "%s", "Failed to parse autodiscover request xml.");
-            setError(c, Response::BadRequest, c->translate("Autodiscover", "Failed to parse request XML: %1").arg(errorMsg), 600);
-            c->req()->body()->close();
+            setError(c, Response::BadRequest, c->translate("Autodiscover", "Failed to parse request XML: %1").arg(xml.errorString()), 600);
             return;
         }
-        c->req()->body()->close();
-
-        email = xml.documentElement().firstChildElement(QStringLiteral("Request")).firstChildElement(QStringLiteral("EMailAddress")).text();
     }
 
     if (email.isEmpty()) {
@@ -101,6 +129,12 @@ void Autodiscover::index(Context *c)
         return;
     }
 
+    if (!AliasFilter::mightExist(email)) {
+        qCWarning(SK_AUTODISCOVER, "Autoconfiguration requested for unknown email address %s from %s", qUtf8Printable(email), qUtf8Printable(c->req()->addressString()));
+        setError(c, Response::NotFound, c->translate("Autodiscover", "Email address not found."), 500);
+        return;
+    }
+
     QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("SELECT username FROM virtual WHERE alias = :alias"));
     q.bindValue(QStringLiteral(":alias"), email);
 
@@ -113,6 +147,7 @@ void Autodiscover::index(Context *c)
     const QString username = q.next() ? q.value(0).toString() : QString();
 
     if (username.isEmpty()) {
+        AliasFilter::addMiss(email);
         qCWarning(SK_AUTODISCOVER, "Autoconfiguration requested for unknown email address %s from %s", qUtf8Printable(email), qUtf8Printable(c->req()->addressString()));
         setError(c, Response::NotFound, c->translate("Autodiscover", "Email address not found."), 500);
         return;
@@ -122,6 +157,13 @@ void Autodiscover::index(Context *c)
 
     const QString mailDomain = email.mid(email.lastIndexOf(QLatin1Char('@')) + 1);
 
+    const QString cacheKey = QLatin1String("autodiscover\n") + mailDomain + QLatin1Char('\n') + username;
+    if (const auto cached = AutoconfigCache::value(cacheKey)) {
+        c->res()->setBody(cached->body);
+        c->res()->setContentType(QStringLiteral("application/xml"));
+        return;
+    }
+
     q = CPreparedSqlQueryThread(QStringLiteral("SELECT id, autoconfig FROM domain WHERE domain_name = :domain_name"));
     q.bindValue(QStringLiteral(":domain_name"), mailDomain);
 
@@ -159,104 +201,70 @@ void Autodiscover::index(Context *c)
         return;
     }
 
-    QDomDocument xml;
-    auto autodiscover = xml.createElement(QStringLiteral("Autodiscover"));
-    autodiscover.setAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/responseschema/2006"));
-    xml.appendChild(autodiscover);
+    QByteArray body;
+    QXmlStreamWriter xml(&body);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(4);
 
-    auto response = xml.createElement(QStringLiteral("Response"));
-    response.setAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/outlook/responseschema/2006a"));
-    autodiscover.appendChild(response);
+    xml.writeStartDocument();
+    xml.writeStartElement(QStringLiteral("Autodiscover"));
+    xml.writeDefaultNamespace(QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/responseschema/2006"));
 
-    auto account = xml.createElement(QStringLiteral("Account"));
-    response.appendChild(account);
+    xml.writeStartElement(QStringLiteral("Response"));
+    xml.writeDefaultNamespace(QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/outlook/responseschema/2006a"));
 
-    auto accountType = xml.createElement(QStringLiteral("AccountType"));
-    account.appendChild(accountType);
-    accountType.appendChild(xml.createTextNode(QStringLiteral("email")));
-
-    auto action = xml.createElement(QStringLiteral("Action"));
-    account.appendChild(action);
-    action.appendChild(xml.createTextNode(QStringLiteral("settings")));
+    xml.writeStartElement(QStringLiteral("Account"));
+    xml.writeTextElement(QStringLiteral("AccountType"), QStringLiteral("email"));
+    xml.writeTextElement(QStringLiteral("Action"), QStringLiteral("settings"));
 
     for (const AutoconfigServer &server : servers) {
-        auto proto = xml.createElement(QStringLiteral("Protocol"));
-        account.appendChild(proto);
+        xml.writeStartElement(QStringLiteral("Protocol"));
 
-        auto serverType = xml.createElement(QStringLiteral("Type"));
-        proto.appendChild(serverType);
         switch(server.type()) {
         case AutoconfigServer::Imap:
-            serverType.appendChild(xml.createTextNode(QStringLiteral("IMAP")));
+            xml.writeTextElement(QStringLiteral("Type"), QStringLiteral("IMAP"));
             break;
         case AutoconfigServer::Pop3:
-            serverType.appendChild(xml.createTextNode(QStringLiteral("POP3")));
+            xml.writeTextElement(QStringLiteral("Type"), QStringLiteral("POP3"));
             break;
         case AutoconfigServer::Smtp:
-            serverType.appendChild(xml.createTextNode(QStringLiteral("SMTP")));
+            xml.writeTextElement(QStringLiteral("Type"), QStringLiteral("SMTP"));
             break;
         }
 
-        auto hostname = xml.createElement(QStringLiteral("Server"));
-        proto.appendChild(hostname);
-        hostname.appendChild(xml.createTextNode(server.hostname()));
-
-        auto port = xml.createElement(QStringLiteral("Port"));
-        proto.appendChild(port);
-        port.appendChild(xml.createTextNode(QString::number(server.port())));
-
-        auto loginName = xml.createElement(QStringLiteral("LoginName"));
-        proto.appendChild(loginName);
-        loginName.appendChild(xml.createTextNode(username));
-
-        auto domainRequired = xml.createElement(QStringLiteral("DomainRequired"));
-        proto.appendChild(domainRequired);
-        domainRequired.appendChild(xml.createTextNode(QStringLiteral("off")));
+        xml.writeTextElement(QStringLiteral("Server"), server.hostname());
+        xml.writeTextElement(QStringLiteral("Port"), QString::number(server.port()));
+        xml.writeTextElement(QStringLiteral("LoginName"), username);
+        xml.writeTextElement(QStringLiteral("DomainRequired"), QStringLiteral("off"));
+        xml.writeTextElement(QStringLiteral("SPA"), QStringLiteral("off"));
 
-        auto spa = xml.createElement(QStringLiteral("SPA"));
-        proto.appendChild(spa);
-        spa.appendChild(xml.createTextNode(QStringLiteral("off")));
-
-        auto ssl = xml.createElement(QStringLiteral("SSL"));
-        proto.appendChild(ssl);
         switch (server.socketType()) {
         case AutoconfigServer::Plain:
-            ssl.appendChild(xml.createTextNode(QStringLiteral("off")));
+            xml.writeTextElement(QStringLiteral("SSL"), QStringLiteral("off"));
             break;
         case AutoconfigServer::Ssl:
-            ssl.appendChild(xml.createTextNode(QStringLiteral("on")));
+            xml.writeTextElement(QStringLiteral("SSL"), QStringLiteral("on"));
+            xml.writeTextElement(QStringLiteral("Encryption"), QStringLiteral("SSL"));
             break;
         case AutoconfigServer::StartTls:
-            ssl.appendChild(xml.createTextNode(QStringLiteral("on")));
+            xml.writeTextElement(QStringLiteral("SSL"), QStringLiteral("on"));
+            xml.writeTextElement(QStringLiteral("Encryption"), QStringLiteral("TLS"));
             break;
         }
 
-        if (server.socketType() != AutoconfigServer::Plain) {
-            auto encryption = xml.createElement(QStringLiteral("Encryption"));
-            proto.appendChild(encryption);
-            if (server.socketType() == AutoconfigServer::StartTls) {
-                encryption.appendChild(xml.createTextNode(QStringLiteral("TLS")));
-            } else {
-                encryption.appendChild(xml.createTextNode(QStringLiteral("SSL")));
-            }
-        }
-
-        auto authRequired = xml.createElement(QStringLiteral("AuthRequired"));
-        proto.appendChild(authRequired);
-        authRequired.appendChild(xml.createTextNode(QStringLiteral("on")));
+        xml.writeTextElement(QStringLiteral("AuthRequired"), QStringLiteral("on"));
 
         if (server.type() == AutoconfigServer::Smtp) {
-            auto usepopauth = xml.createElement(QStringLiteral("UsePOPAuth"));
-            proto.appendChild(usepopauth);
-            usepopauth.appendChild(xml.createTextNode(QStringLiteral("on")));
-
-            auto smtplast = xml.createElement(QStringLiteral("SMTPLast"));
-            proto.appendChild(smtplast);
-            smtplast.appendChild(xml.createTextNode(QStringLiteral("off")));
+            xml.writeTextElement(QStringLiteral("UsePOPAuth"), QStringLiteral("on"));
+            xml.writeTextElement(QStringLiteral("SMTPLast"), QStringLiteral("off"));
         }
+
+        xml.writeEndElement();
     }
 
-    c->res()->setBody(xml.toString(4));
+    xml.writeEndDocument();
+
+    c->res()->setBody(AutoconfigCache::insert(cacheKey, body).body);
     c->res()->setContentType(QStringLiteral("application/xml"));
 }
 
@@ -267,31 +275,28 @@ void Autodiscover::setError(Context *c, Response::HttpStatus status, const QStri
 //    c->res()->setStatus(status);
     Q_UNUSED(status)
 
-    QDomDocument xml;
-    auto autodiscover = xml.createElement(QStringLiteral("Autodiscover"));
-    autodiscover.setAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/responseschema/2006"));
-    xml.appendChild(autodiscover);
+    QByteArray body;
+    QXmlStreamWriter xml(&body);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(4);
 
-    auto response = xml.createElement(QStringLiteral("Response"));
-    autodiscover.appendChild(response);
+    xml.writeStartDocument();
+    xml.writeStartElement(QStringLiteral("Autodiscover"));
+    xml.writeDefaultNamespace(QStringLiteral("http://schemas.microsoft.com/exchange/autodiscover/responseschema/2006"));
 
-    auto error = xml.createElement(QStringLiteral("Error"));
-    error.setAttribute(QStringLiteral("Time"), QDateTime::currentDateTimeUtc().time().toString(Qt::ISODateWithMs));
-    error.setAttribute(QStringLiteral("Id"), QString::fromLatin1(QCryptographicHash::hash(c->req()->uri().host().toUtf8(), QCryptographicHash::Md5).toHex()));
-    response.appendChild(error);
+    xml.writeStartElement(QStringLiteral("Response"));
 
-    auto code = xml.createElement(QStringLiteral("ErrorCode"));
-    error.appendChild(code);
-    code.appendChild(xml.createTextNode(QString::number(errorCode)));
+    xml.writeStartElement(QStringLiteral("Error"));
+    xml.writeAttribute(QStringLiteral("Time"), QDateTime::currentDateTimeUtc().time().toString(Qt::ISODateWithMs));
+    xml.writeAttribute(QStringLiteral("Id"), QString::fromLatin1(QCryptographicHash::hash(c->req()->uri().host().toUtf8(), QCryptographicHash::Md5).toHex()));
 
-    auto message = xml.createElement(QStringLiteral("Message"));
-    error.appendChild(message);
-    message.appendChild(xml.createTextNode(msg));
+    xml.writeTextElement(QStringLiteral("ErrorCode"), QString::number(errorCode));
+    xml.writeTextElement(QStringLiteral("Message"), msg);
+    xml.writeEmptyElement(QStringLiteral("DebugData"));
 
-    auto debugdata = xml.createElement(QStringLiteral("DebugData"));
-    error.appendChild(debugdata);
+    xml.writeEndDocument();
 
-    c->res()->setBody(xml.toString(4));
+    c->res()->setBody(body);
     c->res()->setContentType(QStringLiteral("application/xml"));
 }
 
@@ -0,0 +1,18 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "assetfilter.h"
+#include "../plugins/staticassets.h"
+#include <cutelee/util.h>
+
+QVariant AssetFilter::doFilter(const QVariant &input, const QVariant &argument, bool autoescape) const
+{
+    Q_UNUSED(argument)
+    Q_UNUSED(autoescape)
+
+    QVariant ret;
+    ret.setValue<Cutelee::SafeString>(Cutelee::SafeString(StaticAssets::assetPath(Cutelee::getSafeString(input).get()), true));
+    return ret;
+}
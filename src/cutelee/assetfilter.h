@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef ASSETFILTER_H
+#define ASSETFILTER_H
+
+#include <cutelee/filter.h>
+
+/*!
+ * \ingroup skaffaricuteleefilters
+ * \brief Cutelee template filter to get the content hashed path of a static file.
+ *
+ * This filter can be used as \c sk_asset in your cutelee templates. It returns
+ * the path of the content hashed copy of a static file created by the build step
+ * or the input path, if there is no such copy. See StaticAssets.
+ *
+ * \par example
+ * \code
+ * <link href="{{ "/css/style.css"|sk_asset }}" rel="stylesheet"/>
+ * \endcode
+ */
+class AssetFilter : public Cutelee::Filter // clazy:exclude=copyable-polymorphic
+{
+public:
+    bool isSafe() const override { return true; }
+
+    QVariant doFilter(const QVariant &input, const QVariant &argument = QVariant(), bool autoescape = false) const override;
+};
+
+#endif // ASSETFILTER_H
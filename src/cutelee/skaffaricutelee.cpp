@@ -25,6 +25,7 @@
 #include "stringlistsortfilter.h"
 #include "splitfilter.h"
 #include "stringformatfilter.h"
+#include "assetfilter.h"
 
 SkaffariCutelee::SkaffariCutelee(QObject *parent) : QObject(parent)
 {
@@ -56,6 +57,7 @@ QHash<QString, Cutelee::Filter *> SkaffariCutelee::filters(const QString &name)
     ret.insert(QStringLiteral("sk_stringlistsort"), new StringListSortFilter());
     ret.insert(QStringLiteral("sk_split"), new SplitFilter());
     ret.insert(QStringLiteral("sk_stringformat"), new StringformatFilter());
+    ret.insert(QStringLiteral("sk_asset"), new AssetFilter());
 
     return ret;
 }
@@ -1,58 +1,79 @@
 #include "stringformatfilter.h"
 #include <cutelee/util.h>
 #include <cutelee/exception.h>
+#include <QHash>
+#include <cmath>
 #include <limits>
 
+#define SK_STRINGFORMAT_CACHE_SIZE 128
+
 QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &argument, bool autoescape) const
 {
-    QVariant ret;
-
     Q_UNUSED(autoescape);
 
     if (input.isNull() || !input.isValid()) {
         qWarning("%s", "sk_stringformat: invalid input value");
-        return ret;
+        return QVariant();
     }
 
-    ret = input;
+    // Cutelee filters are shared by the templates of an engine, format strings
+    // are mostly literals, so the parsed specs are cached per thread
+    thread_local QHash<QString,FormatSpec> specs;
 
-    QString format = Cutelee::getSafeString(argument).get();
+    const QString formatStr = Cutelee::getSafeString(argument).get();
 
-    if (format.size() > 1 && format.startsWith(QLatin1Char('%'))) {
-        format.remove(0, 1);
+    auto it = specs.constFind(formatStr);
+    if (it == specs.constEnd()) {
+        if (specs.size() >= SK_STRINGFORMAT_CACHE_SIZE) {
+            specs.clear();
+        }
+        it = specs.insert(formatStr, parse(formatStr));
     }
 
-    if (format.isEmpty()) {
+    if (!it.value().isValid()) {
+        return input;
+    }
+
+    bool ok = true;
+    const QString str = format(input, it.value(), &ok);
+    if (!ok) {
+        return input;
+    }
+
+    return QVariant::fromValue<QString>(str);
+}
+
+StringformatFilter::FormatSpec StringformatFilter::parse(const QString &format)
+{
+    FormatSpec spec;
+
+    QStringRef fmt(&format);
+    if (fmt.size() > 1 && fmt.startsWith(QLatin1Char('%'))) {
+        fmt = fmt.mid(1);
+    }
+
+    if (fmt.isEmpty()) {
         qWarning("%s", "sk_stringformat: empty format string");
-        return ret;
+        return spec;
     }
 
-    static const QString flags{QStringLiteral("-+ #0")};
     static const QString convSpecs{QStringLiteral("csdioxXufFeEaAgG")};
     static const QString lengthMods{QStringLiteral("hljztL")};
 
-    bool leftJustified = false;
-    bool forceSign = false;
-    bool prependSpace = false;
-    bool altForm = false;
-    bool leadingZeroPad = false;
-
     QChar conversionSpecifier;
-    LengthModifier lengthModifier = None;
-
     QString fieldWidthStr;
     QString precisionStr;
+    bool hasPrecision = false;
 
     FormatPosition fPos = Start;
-    const QString constFormat = format;
 
-    for (const QChar &c : constFormat) {
+    for (const QChar &c : fmt) {
 
         switch(c.unicode()) {
         case 32: // space sign
         {
             if (fPos <= Flags) {
-                prependSpace = true;
+                spec.prependSpace = true;
                 fPos = Flags;
             } else {
                 qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
@@ -62,7 +83,7 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         case 35: // hash tag
         {
             if (fPos <= Flags) {
-                altForm = true;
+                spec.altForm = true;
                 fPos = Flags;
             } else {
                 qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
@@ -72,7 +93,7 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         case 43: // plus sign
         {
             if (fPos <= Flags) {
-                forceSign = true;
+                spec.forceSign = true;
                 fPos = Flags;
             } else {
                 qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
@@ -82,7 +103,7 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         case 45: // minus sign
         {
             if (fPos <= Flags) {
-                leftJustified = true;
+                spec.leftJustified = true;
                 fPos = Flags;
             } else {
                 qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
@@ -92,6 +113,7 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         case 46: // dot (.)
         {
             if (fPos < Precision) {
+                hasPrecision = true;
                 fPos = Precision;
             } else {
                 qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
@@ -101,7 +123,7 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         case 48: // 0
         {
             if (fPos <= Flags) {
-                leadingZeroPad = true;
+                spec.leadingZeroPad = true;
                 fPos = Flags;
             } else if (fPos == MinFieldWidth) {
                 fieldWidthStr.append(c);
@@ -130,13 +152,15 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
             } else if (fPos == Precision) {
                 precisionStr.append(c);
                 fPos = Precision;
+            } else {
+                qWarning("sk_stringformat: invalid format modifier (at this position): %s", qUtf8Printable(QString(c)));
             }
         }
             break;
         default:
         {
             if (fPos <= LengthMod && lengthMods.contains(c)) {
-                lengthModifier = getLengthModifier(c, lengthModifier);
+                spec.lengthModifier = getLengthModifier(c, spec.lengthModifier);
                 fPos = LengthMod;
             } else if (fPos <= ConvSpec && conversionSpecifier.isNull() && convSpecs.contains(c)) {
                 conversionSpecifier = c;
@@ -149,263 +173,260 @@ QVariant StringformatFilter::doFilter(const QVariant &input, const QVariant &arg
         }
     }
 
+    if (conversionSpecifier.isNull()) {
+        qWarning("sk_stringformat: missing conversion specifier: %s", qUtf8Printable(format));
+        return spec;
+    }
+
     bool ok = true;
 
-    const int fieldWidth = fieldWidthStr.isEmpty() ? 0 : fieldWidthStr.toInt(&ok);
+    spec.fieldWidth = fieldWidthStr.isEmpty() ? 0 : fieldWidthStr.toInt(&ok);
     if (!ok) {
         qWarning("sk_stringformat: invalid field width: %s", qUtf8Printable(fieldWidthStr));
+        spec.fieldWidth = 0;
     }
 
-    const int precision = precisionStr.isEmpty() ? 0 : precisionStr.toInt(&ok);
-    if (!ok) {
-        qWarning("sk_stringformat: invalid precision: %s", qUtf8Printable(fieldWidthStr));
+    if (hasPrecision) {
+        spec.precision = precisionStr.isEmpty() ? 0 : precisionStr.toInt(&ok);
+        if (!ok) {
+            qWarning("sk_stringformat: invalid precision: %s", qUtf8Printable(precisionStr));
+            spec.precision = -1;
+        }
     }
 
-    QString str;
-    QTextStream out(&str, QIODevice::WriteOnly);
+    spec.conversion = conversionSpecifier;
 
-    if (leftJustified) {
-        out.setFieldAlignment(QTextStream::AlignLeft);
-    } else {
-        out.setFieldAlignment(QTextStream::AlignRight);
+    return spec;
+}
+
+template< typename T >
+T StringformatFilter::convertUNumber(const QVariant &input, bool *ok)
+{
+    T ret = 0;
+
+    const qulonglong u = input.toULongLong(ok);
+
+    if (!*ok) {
+        qWarning("%s", "sk_stringformat: failed to convert input value to unsigned integer value");
+        return ret;
     }
 
-    out.setFieldWidth(fieldWidth);
+    if (u > std::numeric_limits<T>::max()) {
+        qWarning("%s", "sk_stringformat: failed to convert input value to unsigned integer value");
+        *ok = false;
+        return ret;
+    }
 
-    QTextStream::NumberFlags numberFlags;
-    numberFlags.setFlag(QTextStream::ForceSign, forceSign);
+    ret = static_cast<T>(u);
 
-    if (conversionSpecifier == QLatin1Char('c')) {
+    return ret;
+}
 
-        out << input.toChar();
+template< typename T >
+T StringformatFilter::convertNumber(const QVariant &input, bool *ok)
+{
+    T ret = 0;
 
-    } else if (conversionSpecifier == QLatin1Char('s')) {
+    const qlonglong i = input.toLongLong(ok);
 
-        if (precision > 0) {
-            out << input.toString().left(precision);
-        } else {
-            out << input.toString();
+    if (!*ok) {
+        qWarning("%s", "sk_stringformat: failed to convert input value to signed integer value");
+        return ret;
+    }
+
+    if (i < std::numeric_limits<T>::min() || i > std::numeric_limits<T>::max()) {
+        qWarning("%s", "sk_stringformat: failed to convert input value to signed integer value");
+        *ok = false;
+        return ret;
+    }
+
+    ret = static_cast<T>(i);
+
+    return ret;
+}
+
+QString StringformatFilter::format(const QVariant &input, const FormatSpec &spec, bool *ok)
+{
+    bool _ok = true;
+    QString prefix;
+    QString digits;
+    bool zeroPadAllowed = false;
+
+    const char16_t conv = spec.conversion.unicode();
+
+    switch (conv) {
+    case u'c':
+        digits = input.toChar();
+        break;
+    case u's':
+        digits = input.toString();
+        if (spec.precision > -1) {
+            digits.truncate(spec.precision);
+        }
+        break;
+    case u'd':
+    case u'i':
+    {
+        qlonglong v = 0;
+        switch (spec.lengthModifier) {
+        case hh:
+            v = convertNumber<signed char>(input, &_ok);
+            break;
+        case h:
+            v = convertNumber<short>(input, &_ok);
+            break;
+        case None:
+            v = convertNumber<int>(input, &_ok);
+            break;
+        case l:
+            v = convertNumber<long>(input, &_ok);
+            break;
+        default:
+            v = convertNumber<qlonglong>(input, &_ok);
+            break;
+        }
+        if (!_ok) {
+            break;
         }
 
-    } else if (conversionSpecifier == QLatin1Char('d') || conversionSpecifier == QLatin1Char('i')) {
+        if (v < 0) {
+            prefix = QStringLiteral("-");
+        } else if (spec.forceSign) {
+            prefix = QStringLiteral("+");
+        } else if (spec.prependSpace) {
+            prefix = QStringLiteral(" ");
+        }
 
-        if (leadingZeroPad) {
-            out.setPadChar(QLatin1Char('0'));
+        const qulonglong magnitude = v < 0 ? 0ULL - static_cast<qulonglong>(v) : static_cast<qulonglong>(v);
+        if (spec.precision != 0 || magnitude != 0) {
+            digits = QString::number(magnitude);
+        }
+        if (digits.size() < spec.precision) {
+            digits.prepend(QString(spec.precision - digits.size(), QLatin1Char('0')));
+        }
+        zeroPadAllowed = (spec.precision < 0);
+    }
+        break;
+    case u'u':
+    case u'o':
+    case u'x':
+    case u'X':
+    {
+        qulonglong v = 0;
+        switch (spec.lengthModifier) {
+        case hh:
+            v = convertUNumber<uchar>(input, &_ok);
+            break;
+        case h:
+            v = convertUNumber<ushort>(input, &_ok);
+            break;
+        case None:
+            v = convertUNumber<uint>(input, &_ok);
+            break;
+        case l:
+            v = convertUNumber<ulong>(input, &_ok);
+            break;
+        default:
+            v = convertUNumber<qulonglong>(input, &_ok);
+            break;
+        }
+        if (!_ok) {
+            break;
+        }
+
+        const int base = (conv == u'u') ? 10 : (conv == u'o') ? 8 : 16;
+        if (spec.precision != 0 || v != 0) {
+            digits = QString::number(v, base);
+        }
+        if (digits.size() < spec.precision) {
+            digits.prepend(QString(spec.precision - digits.size(), QLatin1Char('0')));
         }
 
+        if (spec.altForm) {
+            if (conv == u'o' && !digits.startsWith(QLatin1Char('0'))) {
+                digits.prepend(QLatin1Char('0'));
+            } else if (conv == u'x' && v != 0) {
+                prefix = QStringLiteral("0x");
+            } else if (conv == u'X' && v != 0) {
+                prefix = QStringLiteral("0X");
+            }
+        }
+
+        if (conv == u'X') {
+            digits = digits.toUpper();
+        }
+        zeroPadAllowed = (spec.precision < 0);
     }
+        break;
+    default:
+    {
+        const double v = input.toDouble(&_ok);
+        if (!_ok) {
+            qWarning("%s", "sk_stringformat: failed to convert input value to floating point value");
+            break;
+        }
 
-//    const QChar conversionSpecifier = format.at(format.size() - 1);
-//    format.chop(1);
-
-//    QString str;
-//    QTextStream out(&str, QIODevice::WriteOnly);
-
-//    if (conversionSpecifier == QLatin1Char('s')) {
-
-//        int precision = 0;
-
-//        if (!format.isEmpty()) {
-//            if (format.startsWith(QLatin1Char('-'))) {
-//                out.setFieldAlignment(QTextStream::AlignLeft);
-//                format.remove(0, 1);
-//            } else {
-//                out.setFieldAlignment(QTextStream::AlignRight);
-//            }
-//            if (!format.isEmpty()) {
-//                QString fieldWidthStr;
-//                QString precisionStr;
-//                bool atPrecisionPart = false;
-//                for (const QChar &c : format) {
-//                    if (c.isDigit() && !atPrecisionPart) {
-//                        fieldWidthStr.append(c);
-//                    } else if (c.isDigit() && atPrecisionPart) {
-//                        precisionStr.append(c);
-//                    } else if (!c.isDigit() && c == QLatin1Char('.')) {
-//                        atPrecisionPart = true;
-//                    } else {
-//                        qWarning("sk_stringformat: invalid string format specifier: %s", qUtf8Printable(QString(c)));
-//                    }
-//                }
-
-//                bool ok = true;
-
-//                const int fieldWidth = fieldWidthStr.isEmpty() ? 0 : fieldWidthStr.toInt(&ok);
-//                if (!ok) {
-//                    qWarning("%s", "sk_stringformat: invalid string field with");
-//                }
-//                out.setFieldWidth(fieldWidth);
-
-//                precision = precisionStr.isEmpty() ? 0 : precisionStr.toInt(&ok);
-//                if (!ok) {
-//                    qWarning("%s", "sk_stringformat: invalid string precision");
-//                }
-//            }
-//        }
-
-//        if (precision > 0) {
-//            out << input.toString().left(precision);
-//        } else {
-//            out << input.toString();
-//        }
-
-//    } else if (conversionSpecifier == QLatin1Char('c')) {
-
-//        out << input.toChar();
-
-//    } else if (conversionSpecifier == QLatin1Char('i') || conversionSpecifier == QLatin1Char('d') || conversionSpecifier == QLatin1Char('u')) {
-
-//        out.setIntegerBase(10);
-
-//        LengthModifier lm = None;
-//        QString fieldWidthString;
-//        bool useZeroAsPad = false;
-
-//        for (const QChar &c : format) {
-//            if (c == QLatin1Char('-')) {
-//                out.setFieldAlignment(QTextStream::AlignLeft);
-//            } else if (c == QLatin1Char('+')) {
-//                out.setNumberFlags(QTextStream::ForceSign);
-//            } else if (c.isDigit()) {
-//                if (c == QLatin1Char('0')) {
-//                    if (fieldWidthString.isEmpty()) {
-//                        useZeroAsPad = true;
-//                    } else {
-//                        fieldWidthString.append(c);
-//                    }
-//                } else {
-//                    fieldWidthString.append(c);
-//                }
-//            } else {
-//                lm = getLengthModifier(c, lm);
-//            }
-//        }
-
-//        bool ok = true;
-
-//        const int fieldWidth = fieldWidthString.isEmpty() ? 0 : fieldWidthString.toInt(&ok);
-//        if (ok) {
-//            out.setFieldWidth(fieldWidth);
-//        } else {
-//            qWarning("%s", "sk_stringformat: invalid field width");
-//        }
-
-//        if (useZeroAsPad) {
-//            out.setPadChar(QLatin1Char('0'));
-//        }
-
-//        if (conversionSpecifier != QLatin1Char('u')) {
-//            if (lm == h || lm == hh || lm == None) {
-//                const int i = input.toInt(&ok);
-//                if (!ok) {
-//                    qWarning("%s", "sk_stringformat: failed to convert input value to int");
-//                    return ret;
-//                }
-//                if (lm == None) {
-//                    out << i;
-//                } else if (lm == h) {
-//                    if (i < std::numeric_limits<short>::min() || i > std::numeric_limits<short>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to short");
-//                        return ret;
-//                    }
-//                    out << static_cast<short>(i);
-//                } else if (lm == hh) {
-//                    if (i < std::numeric_limits<char>::min() || i > std::numeric_limits<char>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to char");
-//                        return ret;
-//                    }
-//                    out << static_cast<char>(i);
-//                }
-//            } else {
-//                const qlonglong qll = input.toLongLong(&ok);
-//                if (!ok) {
-//                    qWarning("%s", "sk_stringformat: failed to convert input value to long long");
-//                    return ret;
-//                }
-//                if (lm == ll) {
-//                    out << qll;
-//                } else if (lm == l) {
-//                    if (qll < std::numeric_limits<long>::min() || qll > std::numeric_limits<long>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to long");
-//                        return ret;
-//                    }
-//                    out << static_cast<long>(qll);
-//                } else if (lm == j) {
-//                    if (qll < std::numeric_limits<intmax_t>::min() || qll > std::numeric_limits<intmax_t>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to intmax_t");
-//                        return ret;
-//                    }
-//                    out << static_cast<intmax_t>(qll);
-//                } else if (lm == z) {
-//                    if (qll < std::numeric_limits<ssize_t>::min() || qll > std::numeric_limits<ssize_t>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to invalid signed size_t");
-//                        return ret;
-//                    }
-//                    out << static_cast<ssize_t>(qll);
-//                } else if (lm == t) {
-//                    if (qll < std::numeric_limits<ptrdiff_t>::min() || qll > std::numeric_limits<ptrdiff_t>::max()) {
-//                        qWarning("%s", "sk_stringformat: failed to convert input value to intmax_t");
-//                        return ret;
-//                    }
-//                    out << static_cast<ptrdiff_t>(qll);
-//                }
-//            }
-//        } else {
-//            if (lm == hh) {
-//                const uchar v = convertUNumber<uchar>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == h) {
-//                const ushort v = convertUNumber<ushort>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == None) {
-//                const uint v = convertUNumber<uint>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == l) {
-//                const ulong v = convertUNumber<ulong>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == ll) {
-//                const qulonglong v = convertUNumber<qulonglong>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == j) {
-//                const uintmax_t v = convertUNumber<uintmax_t>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else if (lm == z) {
-//                const size_t v = convertUNumber<size_t>(input, &ok);
-//                if (!ok) {
-//                    return ret;
-//                }
-//                out << v;
-//            } else {
-//                qWarning("%s", "sk_stringformat: invalid length modifier");
-//                return ret;
-//            }
-//        }
-//    }
-
-    ret = QVariant::fromValue<QString>(str);
+        if (std::signbit(v)) {
+            prefix = QStringLiteral("-");
+        } else if (spec.forceSign) {
+            prefix = QStringLiteral("+");
+        } else if (spec.prependSpace) {
+            prefix = QStringLiteral(" ");
+        }
 
-    return ret;
+        const double magnitude = std::fabs(v);
+        const int precision = spec.precision > -1 ? spec.precision : 6;
+        const char16_t lowerConv = spec.conversion.toLower().unicode();
+
+        if (lowerConv == u'a') {
+            digits = spec.precision > -1 ? QString::asprintf("%.*a", precision, magnitude) : QString::asprintf("%a", magnitude);
+            if (digits.startsWith(QLatin1String("0x"))) {
+                prefix.append(QLatin1String("0x"));
+                digits.remove(0, 2);
+            }
+        } else if (lowerConv == u'g') {
+            digits = QString::number(magnitude, 'g', precision > 0 ? precision : 1);
+        } else {
+            digits = QString::number(magnitude, static_cast<char>(lowerConv), precision);
+        }
+
+        if (spec.conversion.isUpper()) {
+            prefix = prefix.toUpper();
+            digits = digits.toUpper();
+        }
+        zeroPadAllowed = std::isfinite(v);
+    }
+        break;
+    }
+
+    if (ok) {
+        *ok = _ok;
+    }
+
+    if (!_ok) {
+        return QString();
+    }
+
+    return pad(spec, prefix, digits, zeroPadAllowed);
+}
+
+QString StringformatFilter::pad(const FormatSpec &spec, const QString &prefix, const QString &digits, bool zeroPadAllowed)
+{
+    const int fill = spec.fieldWidth - prefix.size() - digits.size();
+    if (fill <= 0) {
+        return prefix + digits;
+    }
+
+    if (spec.leftJustified) {
+        return prefix + digits + QString(fill, QLatin1Char(' '));
+    } else if (spec.leadingZeroPad && zeroPadAllowed) {
+        return prefix + QString(fill, QLatin1Char('0')) + digits;
+    } else {
+        return QString(fill, QLatin1Char(' ')) + prefix + digits;
+    }
 }
 
-StringformatFilter::LengthModifier StringformatFilter::getLengthModifier(const QChar &c, LengthModifier current) const
+StringformatFilter::LengthModifier StringformatFilter::getLengthModifier(const QChar &c, LengthModifier current)
 {
     if (c == QLatin1Char('h') && current != h) {
         return h;
@@ -427,25 +448,3 @@ StringformatFilter::LengthModifier StringformatFilter::getLengthModifier(const Q
         return current;
     }
 }
-
-template< typename T >
-T StringformatFilter::convertUNumber(const QVariant &input, bool *ok) const
-{
-    T ret = 0;
-
-    const qulonglong u = input.toULongLong(ok);
-
-    if (!*ok) {
-        qWarning("%s", "sk_stringformat: failed to convert input value to unsigned integer value");
-        return ret;
-    }
-
-    if (u < std::numeric_limits<T>::min() || u > std::numeric_limits<T>::max()) {
-        qWarning("%s", "sk_stringformat: failed to convert input value to unsigned integer value");
-        return ret;
-    }
-
-    ret = static_cast<T>(u);
-
-    return ret;
-}
@@ -28,27 +28,66 @@
  * Formats the variable according to the argument, a string formatting specifier.
  * This specifier uses the printf-style String Formatting syntax, with the exception
  * that the leading “%” is dropped.
+ *
+ * Parsed format specifiers are cached per thread by their format string, so a
+ * format string used in a loop is only parsed once and only the conversion of
+ * the value runs for every element.
  */
 class StringformatFilter : public Cutelee::Filter
 {
 public:
+    enum LengthModifier {
+        hh, h, None, l, ll, j, z, t, L
+    };
+
+    /*!
+     * \brief Parsed printf-style conversion specification.
+     */
+    struct FormatSpec {
+        QChar conversion;
+        LengthModifier lengthModifier = None;
+        int fieldWidth = 0;
+        int precision = -1;
+        bool leftJustified = false;
+        bool forceSign = false;
+        bool prependSpace = false;
+        bool altForm = false;
+        bool leadingZeroPad = false;
+
+        bool isValid() const { return !conversion.isNull(); }
+    };
+
     bool isSafe() const override { return true; }
 
     QVariant doFilter(const QVariant &input, const QVariant &argument = QVariant(), bool autoescape = false) const override;
 
-private:
-    enum LengthModifier {
-        hh, h, None, l, ll, j, z, t, L
-    };
+    /*!
+     * \brief Parses the printf-style \a format string, the leading “%” is optional.
+     */
+    static FormatSpec parse(const QString &format);
+
+    /*!
+     * \brief Formats \a input according to \a spec.
+     *
+     * If \a ok is not a \c nullptr, it will be set to \c false if \a input
+     * could not be converted.
+     */
+    static QString format(const QVariant &input, const FormatSpec &spec, bool *ok = nullptr);
 
+private:
     enum FormatPosition {
         Start, Flags, MinFieldWidth, Precision, LengthMod, ConvSpec
     };
 
-    LengthModifier getLengthModifier(const QChar &c, LengthModifier current) const;
+    static LengthModifier getLengthModifier(const QChar &c, LengthModifier current);
+
+    template< typename T >
+    static T convertUNumber(const QVariant &input, bool *ok);
 
     template< typename T >
-    T convertUNumber(const QVariant &input, bool *ok) const;
+    static T convertNumber(const QVariant &input, bool *ok);
+
+    static QString pad(const FormatSpec &spec, const QString &prefix, const QString &digits, bool zeroPadAllowed);
 };
 
 #endif // STRINGFORMATFILTER_H
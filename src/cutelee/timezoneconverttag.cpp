@@ -33,6 +33,21 @@
 
 Q_DECLARE_METATYPE(QTimeZone)
 
+/*!
+ * \internal
+ * \brief Locale and time zone of the current user, resolved once per request.
+ */
+struct TimeZoneConvertFormat
+{
+    QLocale locale;
+    QTimeZone timeZone;
+    bool convert = false;
+};
+
+Q_DECLARE_METATYPE(TimeZoneConvertFormat)
+
+#define SK_TZC_STASH_KEY "_sk_tzc_format"
+
 TimeZoneConvertTag::TimeZoneConvertTag(QObject *parent) : Cutelee::AbstractNodeFactory(parent)
 {
 
@@ -118,21 +133,31 @@ void TimeZoneConvert::render(Cutelee::OutputStream *stream, Cutelee::Context *gc
         }
     }
 
+    // the session stores the time zone as serialized QTimeZone, so resolve it only once per request
+    TimeZoneConvertFormat fmt;
+    const QVariant fmtVar = c->stash(QStringLiteral(SK_TZC_STASH_KEY));
+    if (fmtVar.userType() == qMetaTypeId<TimeZoneConvertFormat>()) {
+        fmt = fmtVar.value<TimeZoneConvertFormat>();
+    } else {
+        fmt.locale = c->locale();
+        fmt.timeZone = Cutelyst::Session::value(c, QStringLiteral("timeZone"), QVariant::fromValue<QTimeZone>(QTimeZone::utc())).value<QTimeZone>();
+        fmt.convert = fmt.timeZone != QTimeZone::utc();
+        c->setStash(QStringLiteral(SK_TZC_STASH_KEY), QVariant::fromValue<TimeZoneConvertFormat>(fmt));
+    }
+
     if (dtVarType == QVariant::DateTime) {
 
         QDateTime dtVal = dtVar.toDateTime();
 
-        const QTimeZone userTz = Cutelyst::Session::value(c, QStringLiteral("timeZone"), QVariant::fromValue<QTimeZone>(QTimeZone::utc())).value<QTimeZone>();
-
-        if (userTz != QTimeZone::utc()) {
+        if (fmt.convert) {
             dtVal.setTimeSpec(Qt::UTC);
-            dtVal = dtVal.toTimeZone(userTz);
+            dtVal = dtVal.toTimeZone(fmt.timeZone);
         }
 
         if (formatString.isEmpty()) {
-            *stream << c->locale().toString(dtVal, QLocale::ShortFormat);
+            *stream << fmt.locale.toString(dtVal, QLocale::ShortFormat);
         } else {
-            *stream << c->locale().toString(dtVal, formatString);
+            *stream << fmt.locale.toString(dtVal, formatString);
         }
 
     } else if (dtVarType == QVariant::Date) {
@@ -140,9 +165,9 @@ void TimeZoneConvert::render(Cutelee::OutputStream *stream, Cutelee::Context *gc
         const QDate dateVal = dtVar.toDate();
 
         if (formatString.isEmpty()) {
-            *stream << c->locale().toString(dateVal, QLocale::ShortFormat);
+            *stream << fmt.locale.toString(dateVal, QLocale::ShortFormat);
         } else {
-            *stream << c->locale().toString(dateVal, formatString);
+            *stream << fmt.locale.toString(dateVal, formatString);
         }
 
     } else if (dtVarType == QVariant::Time) {
@@ -150,9 +175,9 @@ void TimeZoneConvert::render(Cutelee::OutputStream *stream, Cutelee::Context *gc
         const QTime timeVal = dtVar.toTime();
 
         if (formatString.isEmpty()) {
-            *stream << c->locale().toString(timeVal, QLocale::ShortFormat);
+            *stream << fmt.locale.toString(timeVal, QLocale::ShortFormat);
         } else {
-            *stream << c->locale().toString(timeVal, formatString);
+            *stream << fmt.locale.toString(timeVal, formatString);
         }
 
     }
@@ -23,6 +23,7 @@
 #include "objects/helpentry.h"
 #include "utils/skaffariconfig.h"
 #include "utils/utils.h"
+#include "utils/listversion.h"
 #include "validators/skvalidatoruniquedb.h"
 #include "validators/skvalidatoraccountexists.h"
 #include "validators/skvalidatordomainexists.h"
@@ -76,6 +77,13 @@ DomainEditor::~DomainEditor()
 
 void DomainEditor::index(Context *c)
 {
+    // status messages are only shown once
+    if (!c->stash().contains(QStringLiteral("status_msg")) && !c->stash().contains(QStringLiteral("error_msg"))) {
+        if (ListVersion::notModified(c, ListVersion::domainsTag(c))) {
+            return;
+        }
+    }
+
     SkaffariError e(c);
     const auto doms = Domain::list(c, e, Authentication::user(c));
     if (e.type() != SkaffariError::NoError) {
@@ -294,17 +302,24 @@ void DomainEditor::accounts(Context* c)
     const bool isAjax = c->req()->xhr();
     const bool loadAccounts = (!SkaffariConfig::tmplAsyncAccountList() || isAjax);
 
-    SkaffariError e(c);
-    if (loadAccounts) {
-        pag = Account::list(c, e, dom, pag, sortBy, sortOrder, searchRole, searchString);
-    }
-
     const QString newCookieData = accountsPerPage + QLatin1Char(';') + currentPage + QLatin1Char(';') + sortBy + QLatin1Char(';') + sortOrder + QLatin1Char(';') + searchRole + QLatin1Char(';') + searchString;
     QNetworkCookie newCookie(QByteArrayLiteral(SK_DOM_FILTER_COOKIE_NAME), newCookieData.toLatin1().toBase64());
     const QString path = QLatin1String("/domain/") + QString::number(dom.id()) + QLatin1String("/accounts");
     newCookie.setPath(path);
     c->res()->setCookie(newCookie);
 
+    if (isAjax && ListVersion::notModified(c, ListVersion::accountsTag(c, dom.id(), newCookieData.toUtf8()))) {
+        return;
+    }
+
+    SkaffariError e(c);
+    std::vector<AccountListRow> rows;
+    if (isAjax) {
+        pag = Account::listRows(c, e, dom, pag, rows, sortBy, sortOrder, searchRole, searchString);
+    } else if (loadAccounts) {
+        pag = Account::list(c, e, dom, pag, sortBy, sortOrder, searchRole, searchString);
+    }
+
     if (isAjax) {
         QJsonObject json;
 
@@ -317,15 +332,6 @@ void DomainEditor::accounts(Context* c)
 
         } else {
 
-            const std::vector<Account> lst = pag.value(QStringLiteral("accounts")).value<std::vector<Account>>();
-
-            QJsonArray accounts;
-            if (!lst.empty()) {
-                for (const Account &a : lst) {
-                    accounts.push_back(a.toJson());
-                }
-            }
-            json.insert(QStringLiteral("accounts"), accounts);
             json.insert(QStringLiteral("searchString"), searchString);
             json.insert(QStringLiteral("searchRole"), searchRole);
             json.insert(QStringLiteral("sortOrder"), sortOrder);
@@ -344,7 +350,18 @@ void DomainEditor::accounts(Context* c)
             }
             json.insert(QStringLiteral("pages"), QJsonArray::fromVariantList(pagesList));
 
-            c->res()->setJsonBody(QJsonDocument(json));
+            // the account rows are written directly into the body, the remaining
+            // small object is appended after them
+            const QByteArray meta = QJsonDocument(json).toJson(QJsonDocument::Compact);
+            QByteArray body;
+            body.reserve(static_cast<int>(rows.size()) * 512 + meta.size() + 16);
+            body.append("{\"accounts\":");
+            AccountListRow::writeJsonArray(body, rows, dom.id());
+            body.append(',');
+            body.append(meta.constData() + 1, meta.size() - 1);
+
+            c->res()->setContentType(QStringLiteral("application/json"));
+            c->res()->setBody(body);
         }
 
     } else {
@@ -5,17 +5,21 @@
 
 #include "imap.h"
 #include "imapparser.h"
+#include "imaplimiter.h"
 #include "../utils/skaffariconfig.h"
 
 #include <Cutelyst/Context>
 
 #include <QLoggingCategory>
 #include <QMessageAuthenticationCode>
+#include <QElapsedTimer>
+#include <QScopeGuard>
+#include <QSslCipher>
+#include <QSslConfiguration>
 
-#include <unicode/ucnv_err.h>
-#include <unicode/uenum.h>
-#include <unicode/localpointer.h>
-#include <unicode/ucnv.h>
+#include <zlib.h>
+
+#include <array>
 
 Q_LOGGING_CATEGORY(SK_IMAP, "skaffari.imap")
 
@@ -24,10 +28,86 @@ consteval std::size_t _strlen(const char *s, std::size_t padding = 0)
     return std::char_traits<char>::length(s) + padding;
 }
 
+/*!
+ * \internal
+ * \brief Raw deflate streams for the COMPRESS=DEFLATE extension, see RFC 4978.
+ */
+struct Imap::Compression
+{
+    Compression()
+    {
+        deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        inflateInit2(&inflater, -15);
+    }
+
+    ~Compression()
+    {
+        deflateEnd(&deflater);
+        inflateEnd(&inflater);
+    }
+
+    Q_DISABLE_COPY(Compression)
+
+    QByteArray compress(const QByteArray &data)
+    {
+        QByteArray out;
+        char buf[4096];
+        deflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+        deflater.avail_in = static_cast<uInt>(data.size());
+        do {
+            deflater.next_out = reinterpret_cast<Bytef*>(buf);
+            deflater.avail_out = sizeof(buf);
+            if (Q_UNLIKELY(deflate(&deflater, Z_SYNC_FLUSH) == Z_STREAM_ERROR)) {
+                return {};
+            }
+            out.append(buf, static_cast<int>(sizeof(buf) - deflater.avail_out));
+        } while (deflater.avail_out == 0);
+        return out;
+    }
+
+    bool decompress(const QByteArray &data)
+    {
+        char buf[16384];
+        inflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+        inflater.avail_in = static_cast<uInt>(data.size());
+        do {
+            inflater.next_out = reinterpret_cast<Bytef*>(buf);
+            inflater.avail_out = sizeof(buf);
+            const int ret = inflate(&inflater, Z_SYNC_FLUSH);
+            if (Q_UNLIKELY(ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)) {
+                return false;
+            }
+            inflated.append(buf, static_cast<int>(sizeof(buf) - inflater.avail_out));
+        } while (inflater.avail_out == 0);
+        return true;
+    }
+
+    z_stream deflater{};
+    z_stream inflater{};
+    QByteArray inflated;
+};
+
 Imap::Imap(Cutelyst::Context *c, QObject *parent)
     : QSslSocket{parent}
     , m_c{c}
 {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    // TLS 1.3 servers send the session ticket after the handshake has finished
+    connect(this, &QSslSocket::newSessionTicketReceived, this, &Imap::storeTlsSession);
+#endif
+}
+
+Imap::~Imap()
+{
+    releaseAdminSlot();
+    if (!m_metrics.isEmpty()) {
+        qCDebug(SK_IMAP).noquote() << "IMAP commands:" << m_metrics.summary();
+    }
+}
+
+QString Imap::translate(const char *context, const char *sourceText) const
+{
+    return m_c ? m_c->translate(context, sourceText) : QString::fromUtf8(sourceText);
 }
 
 ImapError Imap::lastError() const noexcept
@@ -41,10 +121,17 @@ bool Imap::login(const QString &user, const QString &password)
         return true;
     }
 
+    if (Q_UNLIKELY(!ImapCircuitBreaker::allowRequest())) {
+        qCWarning(SK_IMAP) << "Skipping login to IMAP server" << SkaffariConfig::imapHost() << "after repeated connection timeouts";
+        m_lastError = ImapError{ImapError::ConnectionTimeout, translate("SkaffariIMAP", "The IMAP server is temporarily not available because of repeated connection timeouts.")};
+        return false;
+    }
+
     qCDebug(SK_IMAP) << "Start login to IMAP server" << SkaffariConfig::imapHost() << "on port"
                      << SkaffariConfig::imapPort() << "as user" << user;
 
     m_lastError.clear();
+    m_compression.reset();
 
     const EncryptionType encType = SkaffariConfig::imapEncryption();
 
@@ -56,10 +143,15 @@ bool Imap::login(const QString &user, const QString &password)
         }
     } else {
         setPeerVerifyName(SkaffariConfig::imapPeername());
+        const bool resume = prepareTlsSession();
+        QElapsedTimer handshakeTimer;
+        handshakeTimer.start();
         connectToHostEncrypted(SkaffariConfig::imapHost(), SkaffariConfig::imapPort(), ReadWrite, SkaffariConfig::imapProtocol());
         if (Q_UNLIKELY(!waitForEncrypted())) {
             const QList<QSslError> sslErrors = sslHandshakeErrors();
             if (!sslErrors.empty()) {
+                // the server is reachable, only the handshake failed
+                ImapCircuitBreaker::recordSuccess();
                 m_lastError = ImapError{sslErrors.first()};
                 abort();
             } else {
@@ -67,18 +159,36 @@ bool Imap::login(const QString &user, const QString &password)
             }
             return false;
         }
+        logTlsHandshake(handshakeTimer.elapsed(), resume);
+        storeTlsSession();
     }
 
     ImapResponse r = checkResponse2(QStringLiteral("*"));
 
+    // only connection failures and missing greetings count for the circuit breaker,
+    // every answer of the server shows that it is reachable
+    if (!r && r.error().type() == ImapError::ConnectionTimeout) {
+        ImapCircuitBreaker::recordTimeout();
+    } else {
+        ImapCircuitBreaker::recordSuccess();
+    }
+
     if (!r) {
         disconnectOnError(r.error());
         return false;
     }
 
+    if (encType == IMAPS) {
+        // a TLS 1.3 session ticket has most likely arrived together with the greeting
+        storeTlsSession();
+    }
+
+    // the greeting might already contain the capabilities as response code
+    bool haveCaps = updateCapabilities(r);
+
     if (encType == StartTLS) {
-        if (!hasCapability(QStringLiteral("STARTTLS"), true)) {
-            disconnectOnError(ImapError{ImapError::EncryptionError, m_c->translate("SkaffariIMAP", "STARTTLS is not supported.")});
+        if (!hasCapability(QStringLiteral("STARTTLS"), !haveCaps)) {
+            disconnectOnError(ImapError{ImapError::EncryptionError, translate("SkaffariIMAP", "STARTTLS is not supported.")});
             return false;
         }
 
@@ -97,6 +207,11 @@ bool Imap::login(const QString &user, const QString &password)
             return false;
         }
 
+        const bool resume = prepareTlsSession();
+
+        QElapsedTimer handshakeTimer;
+        handshakeTimer.start();
+
         startClientEncryption();
 
         waitForEncrypted();
@@ -104,13 +219,22 @@ bool Imap::login(const QString &user, const QString &password)
         if (mode() != QSslSocket::SslClientMode || !isEncrypted()) {
             const QList<QSslError> sslErrors = sslHandshakeErrors();
             const QString sslErrorString = sslErrors.empty() ? QString() : sslErrors.constFirst().errorString();
-            m_lastError = ImapError{ImapError::EncryptionError, m_c->translate("SkaffariIMAP", "Failed to initiate STARTTLS: %1").arg(sslErrorString)};
+            m_lastError = ImapError{ImapError::EncryptionError, translate("SkaffariIMAP", "Failed to initiate STARTTLS: %1").arg(sslErrorString)};
             abort();
             return false;
         }
+
+        logTlsHandshake(handshakeTimer.elapsed(), resume);
+        storeTlsSession();
+
+        // capabilities received before STARTTLS have to be discarded, see RFC 3501 section 6.2.1
+        haveCaps = false;
     }
 
-    const QStringList caps = getCapabilities(true);
+    const QStringList caps = haveCaps ? m_capabilites : getCapabilities(true);
+
+    // auth methods will set this if the tagged OK response contains the capabilities
+    m_capsAfterAuth = false;
 
     if (caps.contains(QStringLiteral("AUTH=CRAM-MD5"))) {
         qCDebug(SK_IMAP) << "Using AUTH=CRAM-MD5";
@@ -143,12 +267,24 @@ bool Imap::login(const QString &user, const QString &password)
             return false;
         }
 
+        m_capsAfterAuth = updateCapabilities(r);
+
         qCDebug(SK_IMAP) << "User" << user << "successfully logged in using LOGIN";
     }
 
     m_loggedIn = true;
 
-    if (hasCapability(QStringLiteral("ID"), true)) {
+    // capabilities might change after authentication, only request them
+    // if the server did not already send them together with the tagged OK
+    if (!m_capsAfterAuth) {
+        getCapabilities(true);
+    }
+
+    if (SkaffariConfig::imapCompress() && hasCapability(QStringLiteral("COMPRESS=DEFLATE"))) {
+        startCompression();
+    }
+
+    if (hasCapability(QStringLiteral("ID"))) {
         sendId();
     }
 
@@ -161,7 +297,34 @@ bool Imap::login(const QString &user, const QString &password)
 
 bool Imap::login()
 {
-    return login(SkaffariConfig::imapUser(), SkaffariConfig::imapPassword());
+    if (m_loggedIn) {
+        return true;
+    }
+
+    // do not queue for a slot if the login will fail anyway
+    if (m_adminSlot < 0 && !ImapCircuitBreaker::isOpen()) {
+        m_adminSlot = ImapSessionLimiter::instance().acquire(SkaffariConfig::imapAdminQueueTimeout());
+        if (Q_UNLIKELY(m_adminSlot < 0)) {
+            qCWarning(SK_IMAP) << "Timed out waiting for a free IMAP admin session";
+            m_lastError = ImapError{ImapError::ConnectionTimeout, translate("SkaffariIMAP", "All connections to the IMAP server are busy, please try again later.")};
+            return false;
+        }
+    }
+
+    const bool loggedIn = login(SkaffariConfig::imapUser(), SkaffariConfig::imapPassword());
+    if (!loggedIn) {
+        releaseAdminSlot();
+    }
+
+    return loggedIn;
+}
+
+void Imap::releaseAdminSlot()
+{
+    if (m_adminSlot > -1) {
+        ImapSessionLimiter::instance().release(m_adminSlot);
+        m_adminSlot = -1;
+    }
 }
 
 void Imap::logout()
@@ -170,6 +333,8 @@ void Imap::logout()
         return;
     }
 
+    const auto releaseSlot = qScopeGuard([this]{ releaseAdminSlot(); });
+
     m_lastError.clear();
     m_loggedIn = false;
     m_tagSequence = 0;
@@ -178,6 +343,9 @@ void Imap::logout()
         return;
     }
 
+    // last chance to get a session ticket that has been sent after the handshake
+    storeTlsSession();
+
     const QString tag = getTag();
 
     if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("LOGOUT")))) {
@@ -230,20 +398,12 @@ bool Imap::createFolder(const QString &user, const QString &folder, SpecialUse s
 
     qCDebug(SK_IMAP) << "Start creating folder" << folder << "of type" << specialUse << "for user" << user;
 
-    const QString _folder = Imap::toUtf7Imap(folder);
-
-    if (Q_UNLIKELY(_folder.isEmpty())) {
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+    const QString cmd = createFolderCommand(user, folder, specialUse);
+    if (Q_UNLIKELY(cmd.isEmpty())) {
         return false;
     }
 
     const QString tag = getTag();
-    const QString delimeter = getDelimeter(NamespaceType::Others);
-    QString cmd = QLatin1String(R"(CREATE ")") + getUserMailboxName({user}, false) + delimeter + _folder + QLatin1Char('"');
-
-    if (hasCapability(QStringLiteral("CREATE-SPECIAL-USE"))) {
-        cmd += getCreateFolderSpecialUse(specialUse);
-    }
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
         return false;
@@ -266,7 +426,7 @@ bool Imap::createFolder(const QString &folder, Imap::SpecialUse specialUse)
     const QString _folder = Imap::toUtf7Imap(folder);
 
     if (Q_UNLIKELY(!_folder.isEmpty())) {
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
         return false;
     }
 
@@ -307,7 +467,7 @@ bool Imap::createMailbox(const QString &user)
     m_lastError.clear();
 
     const QString tag = getTag();
-    const QString cmd = QLatin1String("CREATE ") + getUserMailboxName({user});
+    const QString cmd = createMailboxCommand(user);
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
         return false;
@@ -328,6 +488,17 @@ bool Imap::deleteMailbox(const QString &user)
 
     m_lastError.clear();
 
+    // Cyrus IMAP deletes all sub folders together with the user's top
+    // level mailbox if the command is issued by an admin
+    if (isCyrus()) {
+        qCDebug(SK_IMAP) << "Using recursive delete of Cyrus IMAP";
+        if (runBatchChecked({setAclCommand(user, SkaffariConfig::imapUser())}) && runBatchChecked({deleteCommand(user, {})})) {
+            return true;
+        }
+        qCWarning(SK_IMAP) << "Recursive delete of mailbox" << user << "failed, trying to delete every folder:" << m_lastError.text();
+        m_lastError.clear();
+    }
+
     QList<std::pair<int, QString>> folders = getUserFolders(user);
 
     if (folders.empty() && m_lastError) {
@@ -335,55 +506,34 @@ bool Imap::deleteMailbox(const QString &user)
     }
 
     const QString delimeter = getDelimeter(NamespaceType::Others);
-    const QString userRoot = getUserMailboxName({user}, false);
 
     if (!folders.empty()) {
+        // delete children before their parents
         std::sort(folders.begin(), folders.end(), [](const std::pair<int, QString> &a, const std::pair<int, QString> &b) {
             return a.first > b.first;
         });
 
         qCDebug(SK_IMAP) << "Folders to delete:" << folders;
 
-        for (const auto &f : std::as_const(folders)) {
-            const QString mb = user + delimeter + f.second;
-
-            if (!setAcl(mb, SkaffariConfig::imapUser())) {
-                return false;
+        // folders of the same depth do not depend on each other and are pipelined together,
+        // a level is only deleted if the admin got the permissions for all of its folders and
+        // the parents are only deleted if all their children have been deleted
+        auto it = folders.cbegin();
+        while (it != folders.cend()) {
+            const int depth = it->first;
+            QStringList aclCommands;
+            QStringList deleteCommands;
+            for (; it != folders.cend() && it->first == depth; ++it) {
+                aclCommands << setAclCommand(user + delimeter + it->second, SkaffariConfig::imapUser());
+                deleteCommands << deleteCommand(user, it->second);
             }
-
-            const QString utf7fName = Imap::toUtf7Imap(f.second);
-            const QString tag = getTag();
-            const QString cmd = QLatin1String("DELETE \"") + userRoot + delimeter + utf7fName + QLatin1Char('"');
-            if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
-                return false;
-            }
-
-            const ImapResponse r = checkResponse2(tag);
-            if (!r) {
-                m_lastError = r.error();
+            if (!runBatchChecked(aclCommands) || !runBatchChecked(deleteCommands)) {
                 return false;
             }
         }
     }
 
-    if (!setAcl(user, SkaffariConfig::imapUser())) {
-        return false;
-    }
-
-    const QString tag = getTag();
-    const QString cmd = QLatin1String("DELETE \"") + userRoot + QLatin1Char('"');
-
-    if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
-        return false;
-    }
-
-    const ImapResponse r = checkResponse2(tag);
-    if (!r) {
-        m_lastError = r.error();
-        return false;
-    }
-
-    return true;
+    return runBatchChecked({setAclCommand(user, SkaffariConfig::imapUser())}) && runBatchChecked({deleteCommand(user, {})});
 }
 
 QStringList Imap::getCapabilities(bool reload)
@@ -402,27 +552,50 @@ QStringList Imap::getCapabilities(bool reload)
             return m_capabilites;
         }
 
-        if (r.lines().empty()) {
-            return m_capabilites;
-        }
+        updateCapabilities(r);
+    }
 
-        m_capabilites.clear();
+    return m_capabilites;
+}
 
-        const QStringList lines = r.lines();
-        for (const auto &l : lines) {
-            const QStringList caps = l.split(QChar(QChar::Space), Qt::SkipEmptyParts);
-            for (const auto &cap : caps) {
-                const auto c = cap.toUpper();
-                if (c != QLatin1String("CAPABILITY")) {
-                    m_capabilites << c;
-                }
+bool Imap::updateCapabilities(const ImapResponse &response)
+{
+    QString capsString;
+
+    // capabilities as response code like: OK [CAPABILITY IMAP4rev1 ...] Ready
+    const QString statusLine = response.statusLine();
+    if (statusLine.startsWith(QLatin1String("[CAPABILITY "), Qt::CaseInsensitive)) {
+        const int end = statusLine.indexOf(QLatin1Char(']'));
+        if (end > 0) {
+            capsString = statusLine.mid(_strlen("[CAPABILITY "), end - _strlen("[CAPABILITY "));
+        }
+    }
+
+    // untagged capability response like: * CAPABILITY IMAP4rev1 ...
+    if (capsString.isEmpty()) {
+        const QStringList lines = response.lines();
+        for (const QString &l : lines) {
+            if (l.startsWith(QLatin1String("CAPABILITY "), Qt::CaseInsensitive)) {
+                capsString = l.mid(_strlen("CAPABILITY "));
+                break;
             }
         }
+    }
 
-        qCDebug(SK_IMAP) << "Requested capabilities:" << m_capabilites;
+    if (capsString.isEmpty()) {
+        return false;
     }
 
-    return m_capabilites;
+    m_capabilites.clear();
+
+    const QStringList caps = capsString.split(QChar(QChar::Space), Qt::SkipEmptyParts);
+    for (const auto &cap : caps) {
+        m_capabilites << cap.toUpper();
+    }
+
+    qCDebug(SK_IMAP) << "Received capabilities:" << m_capabilites;
+
+    return true;
 }
 
 QString Imap::getDelimeter(NamespaceType nsType)
@@ -507,7 +680,7 @@ QStringList Imap::getMailboxes()
 
     const QStringList lines = r.lines();
     if (lines.empty()) {
-        m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to get mailboxes from IMAP server: empty response")};
+        m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to get mailboxes from IMAP server: empty response")};
         return {};
     }
 
@@ -541,14 +714,12 @@ bool Imap::setAcl(const QString &mailbox, const QString &user, const QString &ac
 {
     m_lastError.clear();
 
-    QString _mb = Imap::toUtf7Imap(mailbox);
-    if (Q_UNLIKELY(_mb.isEmpty())) {
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+    const QString cmd = setAclCommand(mailbox, user, acl);
+    if (Q_UNLIKELY(cmd.isEmpty())) {
         return false;
     }
 
     const QString tag = getTag();
-    const QString cmd = QLatin1String("SETACL ") + getUserMailboxName({_mb}) + QLatin1String(" \"") + user + QLatin1String("\" ") + acl;
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
         return false;
@@ -570,7 +741,7 @@ bool Imap::deleteAcl(const QString &mailbox, const QString &user)
 
     QString _mb = Imap::toUtf7Imap(mailbox);
     if (Q_UNLIKELY(_mb.isEmpty())) {
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
         return false;
     }
 
@@ -596,7 +767,7 @@ bool Imap::setQuota(const QString &user, quota_size_t quota)
     m_lastError.clear();
 
     const QString tag = getTag();
-    const QString cmd = QLatin1String("SETQUOTA ") + getUserMailboxName({user}) + QLatin1String(" (STORAGE ") + QString::number(quota) + QLatin1Char(')');
+    const QString cmd = setQuotaCommand(user, quota);
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
         return false;
@@ -618,40 +789,11 @@ bool Imap::setSpecialUse(const QString &folder, Imap::SpecialUse specialUse)
 
     m_lastError.clear();
 
-    const QString _folder = Imap::toUtf7Imap(folder);
-    if (Q_UNLIKELY(!_folder.isEmpty())) {
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+    const QString cmd = specialUseCommand(folder, specialUse);
+    if (Q_UNLIKELY(cmd.isEmpty())) {
         return false;
     }
 
-    QString cmd = QLatin1String("SETMETADATA ") + getInboxFolder({folder}) + QLatin1String(" (/private/specialuse ");
-
-    switch(specialUse) {
-    case SpecialUse::Archive:
-        cmd += QLatin1String(R"("\\Archive")");
-        break;
-    case SpecialUse::Drafts:
-        cmd += QLatin1String(R"("\\Drafts")");
-        break;
-    case SpecialUse::Junk:
-        cmd += QLatin1String(R"("\\Junk")");
-        break;
-    case SpecialUse::Sent:
-        cmd += QLatin1String(R"("\\Sent")");
-        break;
-    case SpecialUse::Trash:
-        cmd += QLatin1String(R"("\\Trash")");
-        break;
-    case SpecialUse::None:
-        cmd += QLatin1String("NIL");
-        break;
-    default:
-        Q_ASSERT_X(false, "set special use", "invalid special use type");
-        m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Invalid special use type.")};
-        return false;
-    }
-
-    cmd += QLatin1Char(')');
     const QString tag = getTag();
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
@@ -670,27 +812,14 @@ bool Imap::setSpecialUse(const QString &folder, Imap::SpecialUse specialUse)
 
 bool Imap::subscribeFolder(const QString &folder)
 {
-    Q_ASSERT_X(!folder.isEmpty(), "subscribe folder", "empty folder name");
-
     m_lastError.clear();
 
-    QString _folder;
-    if (!folder.isEmpty()) {
-        _folder = Imap::toUtf7Imap(folder);
-        if (Q_UNLIKELY(_folder.isEmpty())) {
-            m_lastError = ImapError{ImapError::InternalError, m_c->translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
-            return false;
-        }
-    }
-
-    if (_folder.isEmpty()) {
-        _folder = QStringLiteral("INBOX");
-    } else {
-        _folder = getInboxFolder({_folder}, false);
+    const QString cmd = subscribeCommand(folder);
+    if (Q_UNLIKELY(cmd.isEmpty())) {
+        return false;
     }
 
     const QString tag = getTag();
-    const QString cmd = QLatin1String(R"(SUBSCRIBE ")") + _folder + QLatin1Char('"');
 
     if (Q_UNLIKELY(!sendCommand(tag, cmd))) {
         return false;
@@ -706,68 +835,430 @@ bool Imap::subscribeFolder(const QString &folder)
     return true;
 }
 
-QString Imap::toUtf7Imap(const QString &str)
+Imap::BatchResults Imap::provisionMailboxes(const QList<MailboxProvisioning> &mailboxes)
 {
-    if (str.isEmpty()) {
-        return str;
+    m_lastError.clear();
+
+    // build all commands first, as building them might require
+    // requests to the server, like for the namespaces
+    QStringList commands;
+    for (const MailboxProvisioning &mb : mailboxes) {
+        qCDebug(SK_IMAP) << "Start provisioning mailbox for user" << mb.user << "with folders" << mb.folders;
+        commands << createMailboxCommand(mb.user);
+        commands << setQuotaCommand(mb.user, mb.quota);
+        for (const auto &f : mb.folders) {
+            commands << createFolderCommand(mb.user, f.second, f.first);
+        }
     }
 
-    const QByteArray utf8 = str.toUtf8();
+    return runBatch(commands);
+}
 
-    const int32_t bufSize = utf8.size() * 3;
-    auto buf = static_cast<char*>(malloc(sizeof(char) * bufSize));
+Imap::BatchResults Imap::provisionFolders(const FolderList &folders)
+{
+    m_lastError.clear();
 
-    if (Q_UNLIKELY(!buf)) {
-        qCCritical(SK_IMAP) << "Failed to convert UTF-8 string" << str << "to UTF7-IMAP (RFC2060 5.1.3): failed to allocate buffer of size" << bufSize;
-        return {};
+    QStringList commands;
+    commands << subscribeCommand({});
+    for (const auto &f : folders) {
+        commands << subscribeCommand(f.second);
     }
 
-    UErrorCode uec = U_ZERO_ERROR;
+    // if the server does not support CREATE-SPECIAL-USE, special use has to be set via METADATA
+    if (!hasCapability(QStringLiteral("CREATE-SPECIAL-USE")) && hasCapability(QStringLiteral("SPECIAL-USE")) && hasCapability(QStringLiteral("METADATA"))) {
+        for (const auto &f : folders) {
+            if (f.first != SpecialUse::None) {
+                commands << specialUseCommand(f.second, f.first);
+            }
+        }
+    }
 
-    const int32_t size = ucnv_convert("imap-mailbox-name", "utf-8", buf, bufSize, utf8.constData(), utf8.size(), &uec);
+    return runBatch(commands);
+}
 
-    QString utf7;
-    if ((size > 0) && (uec == U_ZERO_ERROR)) {
-        utf7 = QString::fromLatin1(buf, size);
-    } else {
-        qCCritical(SK_IMAP) << "Failed to convert UTF-8 string" << str << "to UTF7-IMAP (RFC2060 5.1.3):" << u_errorName(uec);
+namespace {
+
+/*!
+ * \internal
+ * \brief Modified base64 alphabet of RFC 3501 section 5.1.3, uses ',' instead of '/'.
+ */
+constexpr char utf7ImapB64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+,";
+
+/*!
+ * \internal
+ * \brief Maps ASCII characters to their modified base64 value, -1 for characters outside the alphabet.
+ */
+constexpr std::array<qint8, 128> utf7ImapB64Values = []() {
+    std::array<qint8, 128> values{};
+    for (auto &v : values) {
+        v = -1;
+    }
+    for (int i = 0; i < 64; ++i) {
+        values[static_cast<uchar>(utf7ImapB64Chars[i])] = static_cast<qint8>(i);
+    }
+    return values;
+}();
+
+/*!
+ * \internal
+ * \brief Returns \c true if \a c can be represented as itself in modified UTF-7.
+ * The ampersand is direct too, but has to be escaped as \c "&-".
+ */
+constexpr bool isUtf7ImapDirect(ushort c) noexcept
+{
+    return c >= 0x20 && c <= 0x7e;
+}
+
+}
+
+QString Imap::toUtf7Imap(const QString &str)
+{
+    const ushort *in = str.utf16();
+    const int inSize = str.size();
+
+    // first pass: check if the string can be used as is and calculate the exact output size
+    int outSize = 0;
+    bool plain = true;
+    int i = 0;
+    while (i < inSize) {
+        const ushort c = in[i];
+        if (isUtf7ImapDirect(c)) {
+            if (c == u'&') {
+                outSize += 2;
+                plain = false;
+            } else {
+                ++outSize;
+            }
+            ++i;
+        } else {
+            plain = false;
+            int run = 0;
+            while (i < inSize && !isUtf7ImapDirect(in[i])) {
+                ++run;
+                ++i;
+            }
+            // shift character, base64 encoded UTF-16BE without padding, end character
+            outSize += 2 + (run * 16 + 5) / 6;
+        }
+    }
+
+    if (plain) {
+        return str;
     }
 
-    free(buf);
+    QString utf7(outSize, Qt::Uninitialized);
+    auto out = reinterpret_cast<ushort*>(utf7.data());
+
+    i = 0;
+    while (i < inSize) {
+        const ushort c = in[i];
+        if (isUtf7ImapDirect(c)) {
+            *out++ = c;
+            if (c == u'&') {
+                *out++ = u'-';
+            }
+            ++i;
+        } else {
+            *out++ = u'&';
+            quint32 bits = 0;
+            int bitCount = 0;
+            while (i < inSize && !isUtf7ImapDirect(in[i])) {
+                bits = (bits << 16) | in[i++];
+                bitCount += 16;
+                while (bitCount >= 6) {
+                    bitCount -= 6;
+                    *out++ = static_cast<ushort>(utf7ImapB64Chars[(bits >> bitCount) & 0x3f]);
+                }
+            }
+            if (bitCount > 0) {
+                *out++ = static_cast<ushort>(utf7ImapB64Chars[(bits << (6 - bitCount)) & 0x3f]);
+            }
+            *out++ = u'-';
+        }
+    }
 
     return utf7;
 }
 
 QString Imap::fromUtf7Imap(const QString &str)
 {
-    if (str.isEmpty()) {
+    const int firstShift = str.indexOf(QLatin1Char('&'));
+    if (firstShift < 0) {
         return str;
     }
 
-    const QByteArray utf7 = str.toLatin1();
+    const ushort *in = str.utf16();
+    const int inSize = str.size();
+
+    // the decoded string is never longer than the encoded one
+    QString utf16(inSize, Qt::Uninitialized);
+    const auto begin = reinterpret_cast<ushort*>(utf16.data());
+    auto out = std::copy(in, in + firstShift, begin);
+
+    int i = firstShift;
+    while (i < inSize) {
+        const ushort c = in[i++];
+        if (c != u'&') {
+            *out++ = c;
+            continue;
+        }
+
+        if (i < inSize && in[i] == u'-') {
+            *out++ = u'&';
+            ++i;
+            continue;
+        }
+
+        quint32 bits = 0;
+        int bitCount = 0;
+        bool terminated = false;
+        while (i < inSize) {
+            const ushort b = in[i++];
+            if (b == u'-') {
+                terminated = true;
+                break;
+            }
+            const int value = b < 128 ? utf7ImapB64Values[b] : -1;
+            if (Q_UNLIKELY(value < 0)) {
+                qCCritical(SK_IMAP) << "Failed to convert UTF7-IMAP (RFC2060 5.1.3) string" << str << "to UTF-8: invalid character in base64 sequence";
+                return {};
+            }
+            bits = (bits << 6) | static_cast<quint32>(value);
+            bitCount += 6;
+            if (bitCount >= 16) {
+                bitCount -= 16;
+                *out++ = static_cast<ushort>(bits >> bitCount);
+            }
+        }
+
+        if (Q_UNLIKELY(!terminated || bitCount >= 6 || (bits & ((1u << bitCount) - 1)) != 0)) {
+            qCCritical(SK_IMAP) << "Failed to convert UTF7-IMAP (RFC2060 5.1.3) string" << str << "to UTF-8: malformed base64 sequence";
+            return {};
+        }
+    }
+
+    utf16.truncate(static_cast<int>(out - begin));
+
+    return utf16;
+}
+
+QString Imap::createMailboxCommand(const QString &user)
+{
+    return QLatin1String("CREATE ") + getUserMailboxName({user});
+}
+
+QString Imap::createFolderCommand(const QString &user, const QString &folder, SpecialUse specialUse)
+{
+    const QString _folder = Imap::toUtf7Imap(folder);
+
+    if (Q_UNLIKELY(_folder.isEmpty())) {
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+        return {};
+    }
+
+    const QString delimeter = getDelimeter(NamespaceType::Others);
+    QString cmd = QLatin1String(R"(CREATE ")") + getUserMailboxName({user}, false) + delimeter + _folder + QLatin1Char('"');
+
+    if (hasCapability(QStringLiteral("CREATE-SPECIAL-USE"))) {
+        cmd += getCreateFolderSpecialUse(specialUse);
+    }
+
+    return cmd;
+}
+
+QString Imap::deleteCommand(const QString &user, const QString &folder)
+{
+    if (folder.isEmpty()) {
+        return QLatin1String("DELETE ") + getUserMailboxName({user});
+    }
+
+    const QString _folder = Imap::toUtf7Imap(folder);
+    if (Q_UNLIKELY(_folder.isEmpty())) {
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+        return {};
+    }
+
+    return QLatin1String("DELETE \"") + getUserMailboxName({user}, false) + getDelimeter(NamespaceType::Others) + _folder + QLatin1Char('"');
+}
+
+QString Imap::setAclCommand(const QString &mailbox, const QString &user, const QString &acl)
+{
+    const QString _mb = Imap::toUtf7Imap(mailbox);
+    if (Q_UNLIKELY(_mb.isEmpty())) {
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+        return {};
+    }
+
+    return QLatin1String("SETACL ") + getUserMailboxName({_mb}) + QLatin1String(" \"") + user + QLatin1String("\" ") + acl;
+}
 
-    const int32_t bufSize = utf7.size() + 1;
-    auto buf = static_cast<char*>(malloc(sizeof(char) * bufSize));
+QString Imap::setQuotaCommand(const QString &user, quota_size_t quota)
+{
+    return QLatin1String("SETQUOTA ") + getUserMailboxName({user}) + QLatin1String(" (STORAGE ") + QString::number(quota) + QLatin1Char(')');
+}
 
-    if (Q_UNLIKELY(!buf)) {
-        qCCritical(SK_IMAP) << "Failed to convert UTF7-IMAP (RFC2060 5.1.3) string" << str << "to UTF-8: failed to allocate buffer of size" << bufSize;
+QString Imap::specialUseCommand(const QString &folder, SpecialUse specialUse)
+{
+    const QString _folder = Imap::toUtf7Imap(folder);
+    if (Q_UNLIKELY(_folder.isEmpty())) {
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
         return {};
     }
 
-    UErrorCode uec = U_ZERO_ERROR;
+    QString cmd = QLatin1String("SETMETADATA ") + getInboxFolder({_folder}) + QLatin1String(" (/private/specialuse ");
 
-    const int32_t size = ucnv_convert("utf-8", "imap-mailbox-name", buf, bufSize, utf7.constData(), utf7.size(), &uec);
+    switch(specialUse) {
+    case SpecialUse::Archive:
+        cmd += QLatin1String(R"("\\Archive")");
+        break;
+    case SpecialUse::Drafts:
+        cmd += QLatin1String(R"("\\Drafts")");
+        break;
+    case SpecialUse::Junk:
+        cmd += QLatin1String(R"("\\Junk")");
+        break;
+    case SpecialUse::Sent:
+        cmd += QLatin1String(R"("\\Sent")");
+        break;
+    case SpecialUse::Trash:
+        cmd += QLatin1String(R"("\\Trash")");
+        break;
+    case SpecialUse::None:
+        cmd += QLatin1String("NIL");
+        break;
+    default:
+        Q_ASSERT_X(false, "set special use", "invalid special use type");
+        m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Invalid special use type.")};
+        return {};
+    }
+
+    cmd += QLatin1Char(')');
+
+    return cmd;
+}
+
+QString Imap::subscribeCommand(const QString &folder)
+{
+    QString _folder;
+    if (!folder.isEmpty()) {
+        _folder = Imap::toUtf7Imap(folder);
+        if (Q_UNLIKELY(_folder.isEmpty())) {
+            m_lastError = ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to convert folder name into UTF-7-IMAP.")};
+            return {};
+        }
+    }
 
-    QString utf8;
-    if ((size > 0) && (uec == U_ZERO_ERROR)) {
-        utf8 = QString::fromUtf8(buf, size);
+    if (_folder.isEmpty()) {
+        _folder = QStringLiteral("INBOX");
     } else {
-        qCCritical(SK_IMAP) << "Failed to convert UTF7-IMAP (RFC2060 5.1.3) string" << str << "to UTF-8:" << u_errorName(uec);
+        _folder = getInboxFolder({_folder}, false);
     }
 
-    free(buf);
+    return QLatin1String(R"(SUBSCRIBE ")") + _folder + QLatin1Char('"');
+}
+
+Imap::BatchResults Imap::runBatch(const QStringList &commands, int msecs)
+{
+    BatchResults results;
+    results.reserve(commands.size());
+
+    QHash<QString,int> pending;
+    QList<CommandStats> stats;
+    stats.reserve(commands.size());
+    QByteArray out;
+
+    for (const QString &command : commands) {
+        BatchResult result;
+        result.command = command;
+        if (Q_UNLIKELY(command.isEmpty())) {
+            result.response = ImapResponse{ImapResponse::Undefined, ImapError{ImapError::InternalError, translate("SkaffariIMAP", "Failed to build IMAP command.")}};
+            // keep the indices in line with results
+            stats << CommandStats{};
+        } else {
+            const QString tag = getTag();
+            pending.insert(tag, results.size());
+            qCDebug(SK_IMAP) << "Pipelining command:" << tag << command;
+            const QByteArray line = tag.toLatin1() + ' ' + command.toLatin1() + QByteArrayLiteral("\r\n");
+            out += line;
+            CommandStats cs;
+            cs.verb = commandVerb(command.toLatin1(), false);
+            cs.bytesOut = line.size();
+            stats << cs;
+        }
+        results << result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // records all commands that are still pending as failed
+    auto failPending = [&]() {
+        for (const int idx : std::as_const(pending)) {
+            results[idx].response = ImapResponse{ImapResponse::Undefined, m_lastError};
+            recordCommand(stats.at(idx).verb, timer.nsecsElapsed(), stats.at(idx).bytesOut, stats.at(idx).bytesIn, true);
+        }
+    };
 
-    return utf8;
+    if (pending.empty()) {
+        return results;
+    }
+
+    if (Q_UNLIKELY(writeCommandData(out) != out.size())) {
+        qCCritical(SK_IMAP) << "Failed to send pipelined commands to the IMAP server:" << errorString();
+        m_lastError = ImapError(ImapError::SocketError, translate("SkaffariIMAP", "Failed to send command to IMAP server: %1").arg(errorString()));
+        failPending();
+        return results;
+    }
+
+    // untagged data belongs to the next command that gets completed
+    QStringList lines;
+    qint64 bytesIn = 0;
+    while (!pending.empty()) {
+        if (!canReadResponseLine() && Q_UNLIKELY(!waitForResponseData(msecs))) {
+            m_lastError = ImapError{ImapError::ConnectionTimeout, translate("SkaffariIMAP", "Connection to the IMAP server timed out.")};
+            failPending();
+            break;
+        }
+        while (!pending.empty() && canReadResponseLine()) {
+            const QByteArray rawLine = readResponseLine();
+            bytesIn += rawLine.size();
+            const QString line = QString::fromLatin1(rawLine.trimmed());
+            const QString tag = line.section(QChar(QChar::Space), 0, 0);
+            const int idx = pending.value(tag, -1);
+            if (idx > -1) {
+                results[idx].response = responseFromStatusLine(line.mid(tag.size() + 1), lines);
+                recordCommand(stats.at(idx).verb, timer.nsecsElapsed(), stats.at(idx).bytesOut, bytesIn, !results[idx].response);
+                bytesIn = 0;
+                lines.clear();
+                pending.remove(tag);
+            } else {
+                lines.push_back(line.mid(2));
+            }
+        }
+    }
+
+    return results;
+}
+
+bool Imap::runBatchChecked(const QStringList &commands)
+{
+    const BatchResults results = runBatch(commands);
+    bool ok = true;
+    for (const BatchResult &result : results) {
+        if (!result.response) {
+            qCWarning(SK_IMAP) << "Pipelined command" << result.command << "failed:" << result.response.error().text();
+            if (ok) {
+                m_lastError = result.response.error();
+                ok = false;
+            }
+        }
+    }
+
+    return ok;
+}
+
+bool Imap::isCyrus() const
+{
+    return m_serverId.value(QStringLiteral("name")).contains(QLatin1String("Cyrus"), Qt::CaseInsensitive);
 }
 
 QString Imap::getTag()
@@ -792,21 +1283,64 @@ bool Imap::sendCommand(const QByteArray &command)
 
     const QByteArray cmd = command + QByteArrayLiteral("\r\n");
 
-    if (Q_UNLIKELY(write(cmd) != cmd.size())) {
+    // continuation data belongs to the command that is already running
+    if (!m_commandStats.timer.isValid()) {
+        m_commandStats.verb = commandVerb(command);
+        m_commandStats.bytesOut = 0;
+        m_commandStats.bytesIn = 0;
+        m_commandStats.timer.start();
+    }
+    m_commandStats.bytesOut += cmd.size();
+
+    if (Q_UNLIKELY(writeCommandData(cmd) != cmd.size())) {
         qCCritical(SK_IMAP) << "Failed to send command" << command << "to the IMAP server:"
                             << errorString();
-        m_lastError = ImapError(ImapError::SocketError, m_c->translate("SkaffariIMAP", "Failed to send command to IMAP server: %1").arg(errorString()));
+        m_lastError = ImapError(ImapError::SocketError, translate("SkaffariIMAP", "Failed to send command to IMAP server: %1").arg(errorString()));
+        finishCommandStats(true);
         return false;
     }
 
     return true;
 }
 
+QByteArray Imap::commandVerb(const QByteArray &command, bool tagged)
+{
+    int start = 0;
+    if (tagged) {
+        start = command.indexOf(' ') + 1;
+        if (start == 0) {
+            return QByteArrayLiteral("UNKNOWN");
+        }
+    }
+
+    const int end = command.indexOf(' ', start);
+    const QByteArray verb = command.mid(start, end < 0 ? -1 : end - start).toUpper();
+    return verb.isEmpty() ? QByteArrayLiteral("UNKNOWN") : verb;
+}
+
+void Imap::finishCommandStats(bool failed)
+{
+    if (!m_commandStats.timer.isValid()) {
+        return;
+    }
+
+    recordCommand(m_commandStats.verb, m_commandStats.timer.nsecsElapsed(), m_commandStats.bytesOut, m_commandStats.bytesIn, failed);
+    m_commandStats.timer.invalidate();
+}
+
+void Imap::recordCommand(const QByteArray &verb, qint64 nsecs, qint64 bytesOut, qint64 bytesIn, bool failed)
+{
+    m_metrics.record(verb, nsecs, bytesOut, bytesIn, failed);
+    ImapMetrics::global().record(verb, nsecs, bytesOut, bytesIn, failed);
+}
+
 void Imap::disconnectOnError(const ImapError &error)
 {
     if (error) {
         m_lastError = error;
     }
+    // the running command will never be completed, do not charge its time to the next one
+    finishCommandStats(true);
     disconnectFromHost();
     if (state() != QSslSocket::UnconnectedState) {
         if (Q_UNLIKELY(!waitForDisconnected())) {
@@ -814,22 +1348,183 @@ void Imap::disconnectOnError(const ImapError &error)
         }
     }
     m_loggedIn = false;
+    m_compression.reset();
+    releaseAdminSlot();
+}
+
+void Imap::startCompression()
+{
+    const QString tag = getTag();
+
+    if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("COMPRESS DEFLATE")))) {
+        m_lastError.clear();
+        return;
+    }
+
+    const ImapResponse r = checkResponse2(tag);
+    if (!r) {
+        qCWarning(SK_IMAP) << "Failed to enable COMPRESS=DEFLATE, continuing uncompressed:" << r.error().text();
+        return;
+    }
+
+    m_compression = std::make_unique<Compression>();
+
+    qCDebug(SK_IMAP) << "Enabled COMPRESS=DEFLATE";
+}
+
+qint64 Imap::writeCommandData(const QByteArray &data)
+{
+    if (!m_compression) {
+        return write(data);
+    }
+
+    const QByteArray compressed = m_compression->compress(data);
+    if (Q_UNLIKELY(compressed.isEmpty() || write(compressed) != compressed.size())) {
+        return -1;
+    }
+
+    return data.size();
+}
+
+bool Imap::waitForResponseData(int msecs)
+{
+    if (!m_compression) {
+        return waitForReadyRead(msecs);
+    }
+
+    // a compressed block might not contain a complete line
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_compression->inflated.contains('\n')) {
+        const int remaining = msecs - static_cast<int>(timer.elapsed());
+        if (remaining <= 0 || !waitForReadyRead(remaining)) {
+            return false;
+        }
+        if (Q_UNLIKELY(!m_compression->decompress(readAll()))) {
+            qCCritical(SK_IMAP) << "Failed to decompress data received from the IMAP server";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Imap::canReadResponseLine() const
+{
+    return m_compression ? m_compression->inflated.contains('\n') : canReadLine();
+}
+
+QByteArray Imap::readResponseLine()
+{
+    if (!m_compression) {
+        return readLine();
+    }
+
+    const int idx = m_compression->inflated.indexOf('\n');
+    const QByteArray line = m_compression->inflated.left(idx + 1);
+    m_compression->inflated.remove(0, line.size());
+    return line;
 }
 
 void Imap::connectionTimedOut()
 {
     qCWarning(SK_IMAP) << "Connection to IMAP server timed out.";
-    m_lastError = ImapError{ImapError::ConnectionTimeout, m_c->translate("SkaffariIMAP", "Connection to IMAP server timed out.")};
+    ImapCircuitBreaker::recordTimeout();
+    m_lastError = ImapError{ImapError::ConnectionTimeout, translate("SkaffariIMAP", "Connection to IMAP server timed out.")};
     abort();
 }
 
+bool Imap::prepareTlsSession()
+{
+    bool resume = false;
+
+    QSslConfiguration conf = sslConfiguration();
+    // session persistence is required to get the session ticket after the handshake
+    conf.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    conf.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    m_offeredTlsTicket.clear();
+
+    const TlsSession &session = tlsSession();
+    if (!session.ticket.isEmpty() && session.host == SkaffariConfig::imapHost() && session.port == SkaffariConfig::imapPort()) {
+        if (session.expires.hasExpired()) {
+            qCDebug(SK_IMAP) << "Cached TLS session ticket has expired";
+        } else {
+            conf.setSessionTicket(session.ticket);
+            m_offeredTlsTicket = session.ticket;
+            resume = true;
+        }
+    }
+
+    setSslConfiguration(conf);
+
+    return resume;
+}
+
+void Imap::logTlsHandshake(qint64 handshakeMsecs, bool resume) const
+{
+    const QSslConfiguration conf = sslConfiguration();
+    const QByteArray ticket = conf.sessionTicket();
+
+    // TLS 1.2 servers keep the offered ticket if they accept the session, TLS 1.3
+    // servers send new tickets only after the handshake, they are logged in storeTlsSession()
+    const char *ticketState = "none";
+    if (!ticket.isEmpty()) {
+        ticketState = (resume && ticket == m_offeredTlsTicket) ? "offered ticket kept" : "new ticket";
+    }
+
+    qCDebug(SK_IMAP).nospace() << "TLS handshake finished in " << handshakeMsecs << "ms using "
+                               << conf.sessionCipher().protocolString() << " and " << conf.sessionCipher().name()
+                               << ", cached ticket offered: " << resume << ", session ticket after handshake: " << ticketState;
+}
+
+void Imap::storeTlsSession()
+{
+    if (!isEncrypted()) {
+        return;
+    }
+
+    const QSslConfiguration conf = sslConfiguration();
+    const QByteArray ticket = conf.sessionTicket();
+
+    if (ticket.isEmpty()) {
+        return;
+    }
+
+    TlsSession &session = tlsSession();
+    if (ticket == session.ticket) {
+        return;
+    }
+
+    session.ticket = ticket;
+    session.host = SkaffariConfig::imapHost();
+    session.port = SkaffariConfig::imapPort();
+    const int lifetime = conf.sessionTicketLifeTimeHint();
+    if (lifetime > 0) {
+        session.expires.setRemainingTime(static_cast<qint64>(lifetime) * 1000);
+    } else {
+        session.expires = QDeadlineTimer{QDeadlineTimer::Forever};
+    }
+
+    qCDebug(SK_IMAP) << "Cached TLS session ticket of" << ticket.size() << "bytes with a lifetime hint of" << lifetime << "seconds";
+}
+
+Imap::TlsSession &Imap::tlsSession()
+{
+    // session data is cached per worker thread, sockets are not shared between threads
+    static thread_local TlsSession session;
+    return session;
+}
+
 bool Imap::waitForResponse(bool disCon, const QString &errorString, int msecs)
 {
-    if (Q_LIKELY(waitForReadyRead(msecs))) {
+    if (Q_LIKELY(waitForResponseData(msecs))) {
         return true;
     }
 
-    ImapError e{ImapError::ConnectionTimeout, errorString.isEmpty() ? m_c->translate("SkaffariIMAP", "Connection to the IMAP server timed out.") : errorString};
+    finishCommandStats(true);
+
+    ImapError e{ImapError::ConnectionTimeout, errorString.isEmpty() ? translate("SkaffariIMAP", "Connection to the IMAP server timed out.") : errorString};
 
     if (disCon) {
         disconnectOnError(e);
@@ -840,18 +1535,33 @@ bool Imap::waitForResponse(bool disCon, const QString &errorString, int msecs)
     return false;
 }
 
+bool Imap::readContinuation(QByteArray &line, int msecs)
+{
+    while (!canReadResponseLine()) {
+        if (Q_UNLIKELY(!waitForResponse(true, {}, msecs))) {
+            return false;
+        }
+    }
+
+    const QByteArray rawLine = readResponseLine();
+    m_commandStats.bytesIn += rawLine.size();
+    line = rawLine.trimmed();
+
+    return true;
+}
+
 // ImapResponse Imap::checkResponse(const QByteArray &data, const QString &tag)
 // {
 //     if (Q_UNLIKELY(data.isEmpty())) {
 //         qCWarning(SK_IMAP) << "The IMAP response is empty.";
-//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, m_c->translate("SkaffariIMAP", "The IMAP response is empty.")}};
+//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, translate("SkaffariIMAP", "The IMAP response is empty.")}};
 //     }
 
 //     const QString dataStr = QString::fromLatin1(data);
 //     const QStringList dataLines = dataStr.split(QStringLiteral("\r\n"), Qt::SkipEmptyParts);
 //     if (Q_UNLIKELY(dataLines.empty())) {
 //         qCWarning(SK_IMAP) << "The IMAP response is empty.";
-//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, m_c->translate("SkaffariIMAP", "The IMAP response is empty.")}};
+//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, translate("SkaffariIMAP", "The IMAP response is empty.")}};
 //     }
 
 //     QString statusLine;
@@ -882,20 +1592,20 @@ bool Imap::waitForResponse(bool disCon, const QString &errorString, int msecs)
 
 //     if (Q_UNLIKELY(statusLine.isEmpty())) {
 //         qCWarning(SK_IMAP) << "The IMAP response is undefined.";
-//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, m_c->translate("SkaffariIMAP", "The IMAP response is undefined.")}};
+//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, translate("SkaffariIMAP", "The IMAP response is undefined.")}};
 //     }
 
 //     if (statusLine.startsWith(QLatin1String("OK"), Qt::CaseInsensitive)) {
 //         return {ImapResponse::OK, statusLine.mid(3), lines};
 //     } else if (statusLine.startsWith(QLatin1String("BAD"), Qt::CaseInsensitive)) {
 //         qCCritical(SK_IMAP) << "We received a BAD response from the IMAP server:" << statusLine.mid(4);
-//         return {ImapResponse::BAD, ImapError{ImapError::BadResponse, m_c->translate("SkaffariIMAP", "We received a BAD response from the IMAP server: %1").arg(statusLine.mid(4))}};
+//         return {ImapResponse::BAD, ImapError{ImapError::BadResponse, translate("SkaffariIMAP", "We received a BAD response from the IMAP server: %1").arg(statusLine.mid(4))}};
 //     } else if (statusLine.startsWith(QLatin1String("NO"), Qt::CaseInsensitive)) {
 //         qCCritical(SK_IMAP) << "We received a NO response from the IMAP server:" << statusLine.mid(3);
-//         return {ImapResponse::NO, ImapError{ImapError::NoResponse, m_c->translate("SkaffariIMAP", "We received a NO response from the IMAP server: %1").arg(statusLine.mid(3))}};
+//         return {ImapResponse::NO, ImapError{ImapError::NoResponse, translate("SkaffariIMAP", "We received a NO response from the IMAP server: %1").arg(statusLine.mid(3))}};
 //     } else {
 //         qCCritical(SK_IMAP) << "The IMAP response is undefined";
-//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, m_c->translate("SkaffariIMAP", "The IMAP response is undefined.")}};
+//         return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, translate("SkaffariIMAP", "The IMAP response is undefined.")}};
 //     }
 // }
 
@@ -905,11 +1615,13 @@ ImapResponse Imap::checkResponse2(const QString &tag, int msecs)
     QStringList lines;
     QString statusLine;
     while (!finished) {
-        if (Q_UNLIKELY(!waitForReadyRead(msecs))) {
-            return {ImapResponse::Undefined, ImapError{ImapError::ConnectionTimeout, m_c->translate("SkaffariIMAP", "Connection to the IMAP server timed out.")}};
+        if (Q_UNLIKELY(!waitForResponseData(msecs))) {
+            finishCommandStats(true);
+            return {ImapResponse::Undefined, ImapError{ImapError::ConnectionTimeout, translate("SkaffariIMAP", "Connection to the IMAP server timed out.")}};
         }
-        while (canReadLine()) {
-            const QByteArray rawLine = readLine();
+        while (canReadResponseLine()) {
+            const QByteArray rawLine = readResponseLine();
+            m_commandStats.bytesIn += rawLine.size();
             const QString line = QString::fromLatin1(rawLine.trimmed());
             if (!tag.isEmpty() && line.startsWith(tag)) {
                 statusLine = line.mid(tag.size() + 1);
@@ -921,9 +1633,16 @@ ImapResponse Imap::checkResponse2(const QString &tag, int msecs)
         }
     }
 
+    ImapResponse r = responseFromStatusLine(statusLine, lines);
+    finishCommandStats(!r);
+    return r;
+}
+
+ImapResponse Imap::responseFromStatusLine(const QString &statusLine, const QStringList &lines)
+{
     if (SK_IMAP().isDebugEnabled()) {
         int i = 1;
-        for (const QString &l : std::as_const(lines)) {
+        for (const QString &l : lines) {
             qCDebug(SK_IMAP).nospace() << "Response data (" << i << "): " << l;
             i++;
         }
@@ -935,13 +1654,13 @@ ImapResponse Imap::checkResponse2(const QString &tag, int msecs)
         return {ImapResponse::OK, statusLine.mid(3), lines};
     } else if (statusLine.startsWith(QLatin1String("BAD"), Qt::CaseInsensitive)) {
         qCCritical(SK_IMAP) << "We received a BAD response from the IMAP server:" << statusLine.mid(4);
-        return {ImapResponse::BAD, ImapError{ImapError::BadResponse, m_c->translate("SkaffariIMAP", "We received a BAD response from the IMAP server: %1").arg(statusLine.mid(4))}};
+        return {ImapResponse::BAD, ImapError{ImapError::BadResponse, translate("SkaffariIMAP", "We received a BAD response from the IMAP server: %1").arg(statusLine.mid(4))}};
     } else if (statusLine.startsWith(QLatin1String("NO"), Qt::CaseInsensitive)) {
         qCCritical(SK_IMAP) << "We received a NO response from the IMAP server:" << statusLine.mid(3);
-        return {ImapResponse::NO, ImapError{ImapError::NoResponse, m_c->translate("SkaffariIMAP", "We received a NO response from the IMAP server: %1").arg(statusLine.mid(3))}};
+        return {ImapResponse::NO, ImapError{ImapError::NoResponse, translate("SkaffariIMAP", "We received a NO response from the IMAP server: %1").arg(statusLine.mid(3))}};
     } else {
         qCCritical(SK_IMAP) << "The IMAP response is undefined";
-        return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, m_c->translate("SkaffariIMAP", "The IMAP response is undefined.")}};
+        return {ImapResponse::Undefined, ImapError{ImapError::UndefinedResponse, translate("SkaffariIMAP", "The IMAP response is undefined.")}};
     }
 }
 
@@ -949,31 +1668,44 @@ bool Imap::authLogin(const QString &user, const QString &password)
 {
     const QString tag = getTag();
 
-    if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("AUTHENTICATE LOGIN")))) {
-        disconnectOnError();
-        return false;
-    }
+    // with SASL-IR the user name can be sent as initial response, see RFC 4959
+    const bool saslIr = hasCapability(QStringLiteral("SASL-IR"));
 
-    if (Q_UNLIKELY(!waitForResponse(true))) {
-        return false;
-    }
+    if (saslIr) {
+        const QByteArray cmd = tag.toLatin1() + QByteArrayLiteral(" AUTHENTICATE LOGIN ") + user.toUtf8().toBase64();
+        if (Q_UNLIKELY(!sendCommand(cmd))) {
+            disconnectOnError();
+            return false;
+        }
+    } else {
+        if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("AUTHENTICATE LOGIN")))) {
+            disconnectOnError();
+            return false;
+        }
 
-    if (Q_UNLIKELY(!readAll().startsWith('+'))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Invalid response after AUTHENTICATE LOGIN.")});
-        return false;
-    }
+        QByteArray continuation;
+        if (Q_UNLIKELY(!readContinuation(continuation))) {
+            return false;
+        }
 
-    if (Q_UNLIKELY(!sendCommand(user.toUtf8().toBase64()))) {
-        disconnectOnError();
-        return false;
+        if (Q_UNLIKELY(!continuation.startsWith('+'))) {
+            disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Invalid response after AUTHENTICATE LOGIN.")});
+            return false;
+        }
+
+        if (Q_UNLIKELY(!sendCommand(user.toUtf8().toBase64()))) {
+            disconnectOnError();
+            return false;
+        }
     }
 
-    if (Q_UNLIKELY(!waitForResponse(true))) {
+    QByteArray continuation;
+    if (Q_UNLIKELY(!readContinuation(continuation))) {
         return false;
     }
 
-    if (Q_UNLIKELY(!readAll().startsWith('+'))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Invalid response after AUTHENTICATE LOGIN.")});
+    if (Q_UNLIKELY(!continuation.startsWith('+'))) {
+        disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Invalid response after AUTHENTICATE LOGIN.")});
         return false;
     }
 
@@ -988,7 +1720,9 @@ bool Imap::authLogin(const QString &user, const QString &password)
         return false;
     }
 
-    qCDebug(SK_IMAP) << "User" << user << "successfully logged in using AUTH=LOGIN";
+    m_capsAfterAuth = updateCapabilities(r);
+
+    qCDebug(SK_IMAP) << "User" << user << "successfully logged in using AUTH=LOGIN" << (saslIr ? "with SASL-IR" : "");
 
     return true;
 }
@@ -997,24 +1731,38 @@ bool Imap::authPlain(const QString &user, const QString &password)
 {
     const QString tag = getTag();
 
-    if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("AUTHENTICATE PLAIN")))) {
-        disconnectOnError();
-        return false;
-    }
+    const QByteArray plain = QByteArrayLiteral("\0") + user.toUtf8() + QByteArrayLiteral("\0") + password.toUtf8();
+    const QByteArray credentials = plain.toBase64();
 
-    if (Q_UNLIKELY(!waitForResponse(true))) {
-        return false;
-    }
+    // with SASL-IR the credentials can be sent together with the command, see RFC 4959
+    const bool saslIr = hasCapability(QStringLiteral("SASL-IR"));
 
-    if (Q_UNLIKELY(!readAll().startsWith('+'))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Invalid response after AUTHENTICATE PLAIN.")});
-        return false;
-    }
+    if (saslIr) {
+        const QByteArray cmd = tag.toLatin1() + QByteArrayLiteral(" AUTHENTICATE PLAIN ") + credentials;
+        if (Q_UNLIKELY(!sendCommand(cmd))) {
+            disconnectOnError();
+            return false;
+        }
+    } else {
+        if (Q_UNLIKELY(!sendCommand(tag, QStringLiteral("AUTHENTICATE PLAIN")))) {
+            disconnectOnError();
+            return false;
+        }
 
-    const QByteArray cmd = QByteArrayLiteral("\0") + user.toUtf8() + QByteArrayLiteral("\0") + password.toUtf8();
-    if (Q_UNLIKELY(!sendCommand(cmd.toBase64()))) {
-        disconnectOnError();
-        return false;
+        QByteArray continuation;
+        if (Q_UNLIKELY(!readContinuation(continuation))) {
+            return false;
+        }
+
+        if (Q_UNLIKELY(!continuation.startsWith('+'))) {
+            disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Invalid response after AUTHENTICATE PLAIN.")});
+            return false;
+        }
+
+        if (Q_UNLIKELY(!sendCommand(credentials))) {
+            disconnectOnError();
+            return false;
+        }
     }
 
     const ImapResponse r = checkResponse2(tag);
@@ -1023,7 +1771,9 @@ bool Imap::authPlain(const QString &user, const QString &password)
         return false;
     }
 
-    qCDebug(SK_IMAP) << "User" << user << "successfully logged in using AUTH=PLAIN";
+    m_capsAfterAuth = updateCapabilities(r);
+
+    qCDebug(SK_IMAP) << "User" << user << "successfully logged in using AUTH=PLAIN" << (saslIr ? "with SASL-IR" : "");
 
     return true;
 }
@@ -1037,13 +1787,13 @@ bool Imap::authCramMd5(const QString &user, const QString &password)
         return false;
     }
 
-    if (Q_UNLIKELY(!waitForResponse(true))) {
+    QByteArray challenge;
+    if (Q_UNLIKELY(!readContinuation(challenge))) {
         return false;
     }
 
-    QByteArray challenge = readAll();
     if (Q_UNLIKELY(!challenge.startsWith('+'))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Invalid response from the IMAP server to %1.").arg(QStringLiteral("AUTHENTICATE CRAM-MD5"))});
+        disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Invalid response from the IMAP server to %1.").arg(QStringLiteral("AUTHENTICATE CRAM-MD5"))});
         return false;
     }
 
@@ -1051,7 +1801,7 @@ bool Imap::authCramMd5(const QString &user, const QString &password)
     challenge = QByteArray::fromBase64(challenge);
 
     if (Q_UNLIKELY(!(challenge.startsWith('<') && challenge.endsWith('>')))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Invalid challenge format for CRAM-MD5 authentication mechanism.")});
+        disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Invalid challenge format for CRAM-MD5 authentication mechanism.")});
         return false;
     }
 
@@ -1059,7 +1809,7 @@ bool Imap::authCramMd5(const QString &user, const QString &password)
     const QByteArray cmd = user.toUtf8() + ' ' + challenge;
 
     if (Q_UNLIKELY(!sendCommand(cmd.toBase64()))) {
-        disconnectOnError(ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to send challenge response for CRAM-MD5 to the IMAP server: %1").arg(errorString())});
+        disconnectOnError(ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to send challenge response for CRAM-MD5 to the IMAP server: %1").arg(errorString())});
         return false;
     }
 
@@ -1069,6 +1819,8 @@ bool Imap::authCramMd5(const QString &user, const QString &password)
         return false;
     }
 
+    m_capsAfterAuth = updateCapabilities(r);
+
     qCDebug(SK_IMAP) << "User" << user << "successfully logged in using AUTH=CRAM-MD5";
 
     return true;
@@ -1165,7 +1917,7 @@ quota_pair Imap::getQuota(const QString &user)
 
     if (Q_UNLIKELY(r.lines().empty())) {
         qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-        m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+        m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
         return quota;
     }
 
@@ -1174,14 +1926,14 @@ quota_pair Imap::getQuota(const QString &user)
     const QVariantList parsed = parser.parse(r.lines().constFirst().mid(_strlen("QUOTA ")));
     if (Q_UNLIKELY(parsed.size() < 2)) {
         qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-        m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+        m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
         return quota;
     }
 
     const QVariantList quotaLst = parsed.at(1).toList();
     if (quotaLst.empty() || quotaLst.size() % 3 != 0) {
         qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-        m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+        m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
         return quota;
     }
 
@@ -1194,7 +1946,7 @@ quota_pair Imap::getQuota(const QString &user)
                 const auto q = quotaLst.at(i + 2).toString().toULongLong(&qOk);
                 if (!sOk || !qOk) {
                     qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-                    m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+                    m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
                     return quota;
                 }
                 quota.first = s;
@@ -1203,14 +1955,14 @@ quota_pair Imap::getQuota(const QString &user)
 
             } else {
                 qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-                m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+                m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
                 return quota;
             }
         }
     }
 
     qCCritical(SK_IMAP) << "Failed to request storage quota for user" << user << ": invalid response";
-    m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
+    m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to request storage quota for user %1: invalid response").arg(user)};
     return quota;
 }
 
@@ -1241,7 +1993,7 @@ QList<std::pair<int,QString>> Imap::getUserFolders(const QString &user)
         // start after "LIST "
         const QVariantList parsed = parser.parse(l.mid(_strlen("LIST ")));
         if (parsed.size() != 3) {
-            m_lastError = ImapError{ImapError::ResponseError, m_c->translate("SkaffariIMAP", "Failed to get folders for user %1: invalid response").arg(user)};
+            m_lastError = ImapError{ImapError::ResponseError, translate("SkaffariIMAP", "Failed to get folders for user %1: invalid response").arg(user)};
             return {};
         }
         const QString folder = Imap::fromUtf7Imap(parsed.at(2).toString().mid(umn.size()));
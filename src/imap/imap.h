@@ -8,8 +8,13 @@
 
 #include <QSslSocket>
 #include <QLoggingCategory>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+
+#include <memory>
 
 #include "imap/imapresponse.h"
+#include "imap/imapmetrics.h"
 #include "../../common/global.h"
 
 Q_DECLARE_LOGGING_CATEGORY(SK_IMAP)
@@ -51,14 +56,45 @@ public:
     };
     Q_ENUM(SpecialUse);
 
-    explicit Imap(Cutelyst::Context *, QObject *parent = nullptr);
+    using FolderList = QList<std::pair<SpecialUse,QString>>;
+
+    /*!
+     * \brief Data to create a new mailbox with quota and default folders.
+     */
+    struct MailboxProvisioning {
+        QString user;
+        FolderList folders;
+        quota_size_t quota{0};
+    };
+
+    /*!
+     * \brief Result of a single command that has been sent in a pipelined batch.
+     */
+    struct BatchResult {
+        QString command;
+        ImapResponse response;
+    };
+    using BatchResults = QList<BatchResult>;
+
+    /*!
+     * \brief Constructs a new Imap object.
+     *
+     * The context \a c is used to translate error messages. It might be \c nullptr,
+     * for example in tests, error messages will not be translated then.
+     */
+    explicit Imap(Cutelyst::Context *c, QObject *parent = nullptr);
 
-    ~Imap() override = default;
+    ~Imap() override;
 
     [[nodiscard]] ImapError lastError() const noexcept;
 
     [[nodiscard]] bool login(const QString &user, const QString &password);
 
+    /*!
+     * \brief Logs in as the configured IMAP admin user.
+     *
+     * Admin sessions are limited by ImapSessionLimiter, the slot is given back on logout.
+     */
     [[nodiscard]] bool login();
 
     void logout();
@@ -95,11 +131,48 @@ public:
 
     [[nodiscard]] bool subscribeFolder(const QString &folder = {});
 
+    /*!
+     * \brief Pipelines the commands to create the \a mailboxes.
+     *
+     * Has to be called as IMAP admin. For every mailbox, the results contain the responses
+     * for CREATE of the mailbox, SETQUOTA and CREATE of every folder, in this order.
+     */
+    [[nodiscard]] BatchResults provisionMailboxes(const QList<MailboxProvisioning> &mailboxes);
+
+    /*!
+     * \brief Pipelines the commands to subscribe the INBOX and the \a folders and to set the special use flags.
+     *
+     * Has to be called as the owner of the mailbox. The results contain the responses for SUBSCRIBE
+     * of the INBOX, SUBSCRIBE of every folder and, if the server does not support CREATE-SPECIAL-USE but
+     * SPECIAL-USE and METADATA, SETMETADATA for every folder with a special use.
+     */
+    [[nodiscard]] BatchResults provisionFolders(const FolderList &folders);
+
     static QString toUtf7Imap(const QString &str);
 
     static QString fromUtf7Imap(const QString &str);
 
 private:
+    struct TlsSession {
+        QByteArray ticket;
+        QString host;
+        QDeadlineTimer expires{QDeadlineTimer::Forever};
+        quint16 port{0};
+    };
+
+    struct Compression;
+
+    /*!
+     * \internal
+     * \brief Statistics of the command that is currently waiting for its tagged response.
+     */
+    struct CommandStats {
+        QByteArray verb;
+        QElapsedTimer timer;
+        qint64 bytesOut{0};
+        qint64 bytesIn{0};
+    };
+
     QString getTag();
 
     bool sendCommand(const QString &command);
@@ -114,12 +187,83 @@ private:
 
     void connectionTimedOut();
 
+    void startCompression();
+
+    qint64 writeCommandData(const QByteArray &data);
+
+    bool waitForResponseData(int msecs);
+
+    [[nodiscard]] bool canReadResponseLine() const;
+
+    QByteArray readResponseLine();
+
+    bool prepareTlsSession();
+
+    void logTlsHandshake(qint64 handshakeMsecs, bool resume) const;
+
+    /*!
+     * \internal
+     * \brief Caches the current session ticket for the next connection of this thread.
+     *
+     * Called after the handshake, when a new ticket has been received, after the greeting
+     * and before logout, as TLS 1.3 servers send their tickets after the handshake.
+     */
+    void storeTlsSession();
+
+    static TlsSession &tlsSession();
+
     bool waitForResponse(bool disCon = false, const QString &errorString = {}, int msecs = 30'000);
 
+    /*!
+     * \internal
+     * \brief Reads the next response line of a running command into \a line, for example a continuation request.
+     *
+     * Returns \c false and disconnects if no complete line has been received within \a msecs.
+     */
+    bool readContinuation(QByteArray &line, int msecs = 30'000);
+
     // ImapResponse checkResponse(const QByteArray &data, const QString &tag = {});
 
     ImapResponse checkResponse2(const QString &tag, int msecs = 30'000);
 
+    ImapResponse responseFromStatusLine(const QString &statusLine, const QStringList &lines);
+
+    BatchResults runBatch(const QStringList &commands, int msecs = 30'000);
+
+    bool runBatchChecked(const QStringList &commands);
+
+    [[nodiscard]] bool isCyrus() const;
+
+    [[nodiscard]] QString createMailboxCommand(const QString &user);
+
+    [[nodiscard]] QString deleteCommand(const QString &user, const QString &folder);
+
+    [[nodiscard]] QString setAclCommand(const QString &mailbox, const QString &user, const QString &acl = QStringLiteral("lrswipkxtecda"));
+
+    [[nodiscard]] QString createFolderCommand(const QString &user, const QString &folder, SpecialUse specialUse);
+
+    [[nodiscard]] QString setQuotaCommand(const QString &user, quota_size_t quota);
+
+    [[nodiscard]] QString specialUseCommand(const QString &folder, SpecialUse specialUse);
+
+    [[nodiscard]] QString subscribeCommand(const QString &folder);
+
+    bool updateCapabilities(const ImapResponse &response);
+
+    /*!
+     * \internal
+     * \brief Returns the upper case verb of a \a command line, skipping the tag if \a tagged is \c true.
+     */
+    [[nodiscard]] static QByteArray commandVerb(const QByteArray &command, bool tagged = true);
+
+    void finishCommandStats(bool failed);
+
+    void releaseAdminSlot();
+
+    [[nodiscard]] QString translate(const char *context, const char *sourceText) const;
+
+    void recordCommand(const QByteArray &verb, qint64 nsecs, qint64 bytesOut, qint64 bytesIn, bool failed);
+
     bool authLogin(const QString &user, const QString &password);
 
     bool authPlain(const QString &user, const QString &password);
@@ -137,13 +281,19 @@ private:
     void sendId();
 
     ImapError m_lastError;
+    std::unique_ptr<Compression> m_compression;
+    CommandStats m_commandStats;
+    ImapMetrics m_metrics;
     QList<NsList> m_namespaces;
+    QByteArray m_offeredTlsTicket;
     QMap<QString,QString> m_serverId;
     Cutelyst::Context *m_c{nullptr};
     quint32 m_tagSequence{0};
+    int m_adminSlot{-1};
     QStringList m_capabilites;
     QString m_delimeter;
     bool m_loggedIn{false};
+    bool m_capsAfterAuth{false};
     bool m_namespaceQueried{false};
 };
 
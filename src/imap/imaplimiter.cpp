@@ -0,0 +1,241 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "imaplimiter.h"
+#include "imap.h"
+#include "../utils/skaffariconfig.h"
+
+#include <QCryptographicHash>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QGlobalStatic>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+Q_GLOBAL_STATIC(ImapSessionLimiter, imapSessionLimiter)
+
+ImapSessionLimiter &ImapSessionLimiter::instance()
+{
+    return *imapSessionLimiter;
+}
+
+ImapSessionLimiter::ImapSessionLimiter()
+    : m_max{static_cast<int>(SkaffariConfig::imapMaxAdminSessions())}
+{
+    if (m_max <= 0) {
+        return;
+    }
+
+    if (SkaffariConfig::imapSharedAdminLimit()) {
+        if (openSlotFiles()) {
+            qCDebug(SK_IMAP) << "Limiting IMAP admin sessions of all processes to" << m_max << "using lock files at" << lockFileBase();
+            return;
+        }
+        qCWarning(SK_IMAP) << "Falling back to a per process limit of IMAP admin sessions";
+    } else {
+        qCDebug(SK_IMAP) << "Limiting IMAP admin sessions of this process to" << m_max;
+    }
+
+    m_local.release(m_max);
+}
+
+ImapSessionLimiter::~ImapSessionLimiter()
+{
+    closeSlotFiles();
+}
+
+QString ImapSessionLimiter::lockFileBase()
+{
+    // systemd sets this if RuntimeDirectory is used, like in the shipped service file
+    QString dir = QFile::decodeName(qgetenv("RUNTIME_DIRECTORY")).section(QLatin1Char(':'), 0, 0);
+    if (dir.isEmpty()) {
+        dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    }
+    if (dir.isEmpty()) {
+        dir = QDir::tempPath();
+    }
+
+    const QString instance = SkaffariConfig::imapHost() + QLatin1Char(':') + QString::number(SkaffariConfig::imapPort()) + QLatin1Char(':') + SkaffariConfig::imapUser();
+    const QByteArray id = QCryptographicHash::hash(instance.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+
+    return dir + QLatin1String("/skaffari-imap-admin-") + QString::fromLatin1(id);
+}
+
+bool ImapSessionLimiter::openSlotFiles()
+{
+    const QByteArray base = QFile::encodeName(lockFileBase());
+
+    m_slotFiles.resize(static_cast<std::size_t>(m_max));
+    for (int i = 0; i < m_max; ++i) {
+        const QByteArray path = base + '.' + QByteArray::number(i);
+        const int fd = ::open(path.constData(), O_RDWR|O_CREAT|O_CLOEXEC|O_NOFOLLOW, 0600);
+        if (Q_UNLIKELY(fd < 0)) {
+            qCWarning(SK_IMAP) << "Failed to open IMAP admin session lock file" << path << ":" << std::strerror(errno);
+            closeSlotFiles();
+            return false;
+        }
+        m_slotFiles[static_cast<std::size_t>(i)].fd = fd;
+    }
+
+    return true;
+}
+
+void ImapSessionLimiter::closeSlotFiles()
+{
+    // closing the file also releases its lock
+    for (const SlotFile &slot : m_slotFiles) {
+        if (slot.fd > -1) {
+            ::close(slot.fd);
+        }
+    }
+    m_slotFiles.clear();
+}
+
+int ImapSessionLimiter::tryLockSlot()
+{
+    QMutexLocker locker(&m_slotsMutex);
+
+    for (std::size_t i = 0; i < m_slotFiles.size(); ++i) {
+        SlotFile &slot = m_slotFiles[i];
+        // the threads of a process share the file descriptors, so the lock does not
+        // exclude them from each other and has to be tracked here
+        if (slot.locked) {
+            continue;
+        }
+        if (::flock(slot.fd, LOCK_EX|LOCK_NB) == 0) {
+            slot.locked = true;
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+int ImapSessionLimiter::acquire(int msecs)
+{
+    if (m_max <= 0) {
+        return 0;
+    }
+
+    if (m_slotFiles.empty()) {
+        return m_local.tryAcquire(1, msecs) ? 0 : -1;
+    }
+
+    // flock() can not wait with a timeout, so the slots are polled with a growing delay
+    const QDeadlineTimer deadline(std::max(msecs, 0));
+    qint64 delay = 2;
+    for (;;) {
+        const int slot = tryLockSlot();
+        if (slot > -1) {
+            return slot;
+        }
+        const qint64 remaining = deadline.remainingTime();
+        if (remaining <= 0) {
+            return -1;
+        }
+        QThread::msleep(static_cast<unsigned long>(std::min(delay, remaining)));
+        delay = std::min<qint64>(delay * 2, 50);
+    }
+}
+
+void ImapSessionLimiter::release(int slot)
+{
+    if (m_max <= 0) {
+        return;
+    }
+
+    if (m_slotFiles.empty()) {
+        m_local.release();
+        return;
+    }
+
+    QMutexLocker locker(&m_slotsMutex);
+
+    if (Q_UNLIKELY(slot < 0 || static_cast<std::size_t>(slot) >= m_slotFiles.size())) {
+        return;
+    }
+
+    SlotFile &sf = m_slotFiles[static_cast<std::size_t>(slot)];
+    if (sf.locked) {
+        ::flock(sf.fd, LOCK_UN);
+        sf.locked = false;
+    }
+}
+
+std::atomic<quint32> ImapCircuitBreaker::s_failures{0};
+std::atomic<qint64> ImapCircuitBreaker::s_openUntil{0};
+std::atomic<bool> ImapCircuitBreaker::s_trialRunning{false};
+
+bool ImapCircuitBreaker::allowRequest()
+{
+    const qint64 openUntil = s_openUntil.load(std::memory_order_acquire);
+    if (openUntil == 0) {
+        return true;
+    }
+
+    if (QDeadlineTimer::current().deadline() < openUntil) {
+        return false;
+    }
+
+    // half-open, only a single trial attempt is let through
+    bool expected = false;
+    return s_trialRunning.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+}
+
+bool ImapCircuitBreaker::isOpen()
+{
+    const qint64 openUntil = s_openUntil.load(std::memory_order_acquire);
+    if (openUntil == 0) {
+        return false;
+    }
+
+    return QDeadlineTimer::current().deadline() < openUntil || s_trialRunning.load(std::memory_order_acquire);
+}
+
+void ImapCircuitBreaker::recordSuccess()
+{
+    s_failures.store(0, std::memory_order_relaxed);
+    if (s_openUntil.exchange(0, std::memory_order_acq_rel) != 0) {
+        qCInfo(SK_IMAP) << "IMAP server is reachable again, resuming connection attempts";
+    }
+    s_trialRunning.store(false, std::memory_order_release);
+}
+
+void ImapCircuitBreaker::recordTimeout()
+{
+    const quint32 threshold = SkaffariConfig::imapBreakerThreshold();
+    if (threshold == 0) {
+        return;
+    }
+
+    const quint32 failures = s_failures.fetch_add(1, std::memory_order_relaxed) + 1;
+    const bool trialFailed = s_trialRunning.load(std::memory_order_acquire);
+    if (trialFailed || failures >= threshold) {
+        const quint32 cooldown = SkaffariConfig::imapBreakerCooldown();
+        s_openUntil.store(QDeadlineTimer::current().deadline() + static_cast<qint64>(cooldown) * 1000, std::memory_order_release);
+        s_trialRunning.store(false, std::memory_order_release);
+        if (trialFailed) {
+            qCWarning(SK_IMAP) << "IMAP server is still not reachable, pausing connection attempts for another" << cooldown << "seconds";
+        } else {
+            qCWarning(SK_IMAP) << "IMAP server timed out" << failures << "times in a row, pausing connection attempts for" << cooldown << "seconds";
+        }
+    }
+}
+
+void ImapCircuitBreaker::reset()
+{
+    s_failures.store(0, std::memory_order_relaxed);
+    s_openUntil.store(0, std::memory_order_release);
+    s_trialRunning.store(false, std::memory_order_release);
+}
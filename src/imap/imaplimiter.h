@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_IMAPLIMITER_H
+#define SKAFFARI_IMAPLIMITER_H
+
+#include <QMutex>
+#include <QSemaphore>
+#include <QString>
+
+#include <atomic>
+#include <vector>
+
+/*!
+ * \brief Limits the number of concurrent IMAP sessions of the IMAP admin user.
+ *
+ * Sessions exceeding the limit are queued until a slot gets available or the
+ * queue timeout is reached. The limit is applied to all threads of the current
+ * process. If IMAP/sharedadminlimit is enabled, the limit is applied to all
+ * processes of the application together by one lock file per slot that is locked
+ * with flock(2). The kernel releases these locks if a process dies, so slots of
+ * crashed workers do not get lost.
+ */
+class ImapSessionLimiter
+{
+public:
+    /*!
+     * \brief Returns the limiter instance, configured from SkaffariConfig on first use.
+     */
+    static ImapSessionLimiter &instance();
+
+    ImapSessionLimiter();
+    ~ImapSessionLimiter();
+
+    /*!
+     * \brief Returns \c true if the number of sessions is limited.
+     */
+    [[nodiscard]] bool isEnabled() const noexcept { return m_max > 0; }
+
+    /*!
+     * \brief Returns \c true if the limit is applied to all processes together.
+     */
+    [[nodiscard]] bool isShared() const noexcept { return !m_slotFiles.empty(); }
+
+    /*!
+     * \brief Tries to get a session slot within \a msecs milliseconds.
+     *
+     * Returns the number of the slot on success, it has to be given back by release().
+     * Returns \c -1 if no slot got available in time. Always returns \c 0 if the limiter
+     * is disabled.
+     */
+    [[nodiscard]] int acquire(int msecs);
+
+    /*!
+     * \brief Gives back the \a slot acquired by acquire().
+     */
+    void release(int slot);
+
+    /*!
+     * \brief Returns the path of the lock files without the slot number.
+     *
+     * The name is derived from the IMAP host, port and admin user, so Skaffari instances
+     * with different IMAP configurations do not share their slots.
+     */
+    [[nodiscard]] static QString lockFileBase();
+
+private:
+    Q_DISABLE_COPY(ImapSessionLimiter)
+
+    struct SlotFile {
+        int fd{-1};
+        bool locked{false};
+    };
+
+    bool openSlotFiles();
+    void closeSlotFiles();
+    int tryLockSlot();
+
+    QSemaphore m_local;
+    QMutex m_slotsMutex;
+    std::vector<SlotFile> m_slotFiles;
+    int m_max{0};
+};
+
+/*!
+ * \brief Stops connection attempts to the IMAP server after repeated connection timeouts.
+ *
+ * Only failures to connect, to finish the TLS handshake or to receive the greeting count,
+ * slow commands on an established connection do not. If the number of consecutive
+ * connection failures reaches IMAP/breakerthreshold, the breaker opens and all login
+ * attempts fail immediately for IMAP/breakercooldown seconds. After the cool down, the
+ * breaker is half-open and lets a single trial attempt through while all others still
+ * fail. If the server answers the trial, the breaker closes, if the trial fails too, the
+ * breaker opens again for another cool down.
+ */
+class ImapCircuitBreaker
+{
+public:
+    /*!
+     * \brief Returns \c true if a connection attempt is allowed.
+     *
+     * If the breaker is half-open, only the first caller gets \c true and has to report
+     * the result by recordSuccess() or recordTimeout().
+     */
+    [[nodiscard]] static bool allowRequest();
+
+    /*!
+     * \brief Returns \c true if connection attempts are currently rejected.
+     *
+     * Unlike allowRequest() this does not take the trial attempt of a half-open breaker.
+     */
+    [[nodiscard]] static bool isOpen();
+
+    /*!
+     * \brief Closes the breaker after the IMAP server answered a connection attempt.
+     */
+    static void recordSuccess();
+
+    /*!
+     * \brief Records a failed connection attempt and opens the breaker if the threshold is reached.
+     */
+    static void recordTimeout();
+
+    /*!
+     * \brief Closes the breaker and resets all counters, used by tests.
+     */
+    static void reset();
+
+private:
+    static std::atomic<quint32> s_failures;
+    static std::atomic<qint64> s_openUntil;
+    static std::atomic<bool> s_trialRunning;
+};
+
+#endif // SKAFFARI_IMAPLIMITER_H
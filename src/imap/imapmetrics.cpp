@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "imapmetrics.h"
+
+#include <QGlobalStatic>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <algorithm>
+
+Q_GLOBAL_STATIC(ImapMetrics, globalImapMetrics)
+
+void ImapMetrics::record(const QByteArray &verb, qint64 nsecs, qint64 bytesOut, qint64 bytesIn, bool failed)
+{
+    const auto bucketIt = std::lower_bound(latencyBuckets.cbegin(), latencyBuckets.cend(), nsecs, [](qint64 bound, qint64 value){
+        return bound * 1'000'000 < value;
+    });
+    const auto bucket = static_cast<std::size_t>(std::distance(latencyBuckets.cbegin(), bucketIt));
+
+    QMutexLocker locker(&m_mutex);
+    Counters &c = m_counters[verb];
+    c.count++;
+    if (failed) {
+        c.errors++;
+    }
+    c.bytesOut += static_cast<quint64>(std::max<qint64>(bytesOut, 0));
+    c.bytesIn += static_cast<quint64>(std::max<qint64>(bytesIn, 0));
+    c.latencySum += nsecs;
+    c.buckets[bucket]++;
+}
+
+QMap<QByteArray,ImapMetrics::Counters> ImapMetrics::counters() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_counters;
+}
+
+bool ImapMetrics::isEmpty() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_counters.empty();
+}
+
+QString ImapMetrics::summary() const
+{
+    const auto counters = this->counters();
+
+    QStringList parts;
+    parts.reserve(counters.size());
+    for (auto it = counters.cbegin(); it != counters.cend(); ++it) {
+        const Counters &c = it.value();
+        QString part = QString::fromLatin1(it.key()) + QLatin1Char('=') + QString::number(c.count)
+                + QLatin1String(" (") + QString::number(static_cast<double>(c.latencySum) / 1'000'000.0, 'f', 2) + QLatin1String("ms");
+        if (c.errors > 0) {
+            part += QLatin1String(", ") + QString::number(c.errors) + QLatin1String(" failed");
+        }
+        part += QLatin1String(", ") + QString::number(c.bytesOut) + QLatin1String("B out, ") + QString::number(c.bytesIn) + QLatin1String("B in)");
+        parts << part;
+    }
+
+    return parts.join(QLatin1String(", "));
+}
+
+QByteArray ImapMetrics::toPrometheus(const QByteArray &labels) const
+{
+    const auto counters = this->counters();
+    // additional labels are put in front of the verb label
+    QByteArray labelStart = QByteArrayLiteral("{");
+    if (!labels.isEmpty()) {
+        labelStart += labels + ',';
+    }
+    labelStart += QByteArrayLiteral("verb=\"");
+
+    QByteArray out;
+    out.reserve(512 + counters.size() * 1024);
+
+    auto writeCounter = [&out, &counters, &labelStart](const char *name, const char *help, quint64 Counters::*member) {
+        out += QByteArrayLiteral("# HELP ") + name + ' ' + help + '\n';
+        out += QByteArrayLiteral("# TYPE ") + name + QByteArrayLiteral(" counter\n");
+        for (auto it = counters.cbegin(); it != counters.cend(); ++it) {
+            out += QByteArray(name) + labelStart + it.key() + QByteArrayLiteral("\"} ") + QByteArray::number(it.value().*member) + '\n';
+        }
+    };
+
+    writeCounter("skaffari_imap_commands_total", "Number of IMAP commands sent.", &Counters::count);
+    writeCounter("skaffari_imap_command_errors_total", "Number of IMAP commands that failed or did not return OK.", &Counters::errors);
+    writeCounter("skaffari_imap_sent_bytes_total", "Uncompressed bytes sent for IMAP commands.", &Counters::bytesOut);
+    writeCounter("skaffari_imap_received_bytes_total", "Uncompressed bytes received for IMAP commands.", &Counters::bytesIn);
+
+    out += QByteArrayLiteral("# HELP skaffari_imap_command_duration_seconds Time between sending an IMAP command and receiving its tagged response.\n");
+    out += QByteArrayLiteral("# TYPE skaffari_imap_command_duration_seconds histogram\n");
+    for (auto it = counters.cbegin(); it != counters.cend(); ++it) {
+        const Counters &c = it.value();
+        const QByteArray verbLabels = labelStart + it.key() + '"';
+        quint64 cumulative = 0;
+        for (std::size_t i = 0; i < latencyBuckets.size(); ++i) {
+            cumulative += c.buckets[i];
+            out += QByteArrayLiteral("skaffari_imap_command_duration_seconds_bucket") + verbLabels
+                    + QByteArrayLiteral(",le=\"") + QByteArray::number(static_cast<double>(latencyBuckets[i]) / 1'000.0) + QByteArrayLiteral("\"} ")
+                    + QByteArray::number(cumulative) + '\n';
+        }
+        out += QByteArrayLiteral("skaffari_imap_command_duration_seconds_bucket") + verbLabels + QByteArrayLiteral(",le=\"+Inf\"} ") + QByteArray::number(c.count) + '\n';
+        out += QByteArrayLiteral("skaffari_imap_command_duration_seconds_sum") + verbLabels + QByteArrayLiteral("} ") + QByteArray::number(static_cast<double>(c.latencySum) / 1'000'000'000.0, 'f', 6) + '\n';
+        out += QByteArrayLiteral("skaffari_imap_command_duration_seconds_count") + verbLabels + QByteArrayLiteral("} ") + QByteArray::number(c.count) + '\n';
+    }
+
+    return out;
+}
+
+ImapMetrics &ImapMetrics::global()
+{
+    return *globalImapMetrics;
+}
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_IMAPMETRICS_H
+#define SKAFFARI_IMAPMETRICS_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+#include <array>
+
+/*!
+ * \brief Collects counters and latency histograms for IMAP commands, grouped by command verb.
+ *
+ * Every Imap object has its own instance that is summarised in the debug log when the
+ * connection object gets destroyed. All commands are also recorded into the process wide
+ * instance returned by global(), that is exposed in the Prometheus text format on the
+ * metrics endpoint. Counters are not shared between worker processes, the endpoint adds
+ * the process ID as \c pid label to tell them apart.
+ */
+class ImapMetrics
+{
+public:
+    /*!
+     * \brief Upper bounds of the latency histogram buckets in milliseconds.
+     */
+    static constexpr std::array<qint64, 12> latencyBuckets{1, 5, 10, 25, 50, 100, 250, 500, 1'000, 2'500, 5'000, 10'000};
+
+    struct Counters {
+        quint64 count{0};
+        quint64 errors{0};
+        quint64 bytesOut{0};
+        quint64 bytesIn{0};
+        qint64 latencySum{0}; // nanoseconds
+        // the last bucket counts commands that took longer than the largest bound
+        std::array<quint64, latencyBuckets.size() + 1> buckets{};
+    };
+
+    ImapMetrics() = default;
+
+    /*!
+     * \brief Records a single command.
+     * \param verb      The command verb, like \c LOGIN or \c GETQUOTA.
+     * \param nsecs     Time in nanoseconds between sending the command and receiving the tagged response.
+     * \param bytesOut  Number of uncompressed bytes sent for the command.
+     * \param bytesIn   Number of uncompressed bytes received for the command.
+     * \param failed    \c true if the command failed or the response was not \c OK.
+     */
+    void record(const QByteArray &verb, qint64 nsecs, qint64 bytesOut, qint64 bytesIn, bool failed);
+
+    /*!
+     * \brief Returns a copy of the counters for all recorded verbs.
+     */
+    [[nodiscard]] QMap<QByteArray,Counters> counters() const;
+
+    /*!
+     * \brief Returns \c true if no command has been recorded yet.
+     */
+    [[nodiscard]] bool isEmpty() const;
+
+    /*!
+     * \brief Returns a short one line summary of the recorded commands suitable for logging.
+     */
+    [[nodiscard]] QString summary() const;
+
+    /*!
+     * \brief Returns the recorded metrics in the Prometheus text exposition format.
+     *
+     * \a labels are added to every sample in front of the verb label, for example \c pid="42".
+     * They have to be already escaped.
+     */
+    [[nodiscard]] QByteArray toPrometheus(const QByteArray &labels = {}) const;
+
+    /*!
+     * \brief Returns the process wide instance.
+     */
+    static ImapMetrics &global();
+
+private:
+    Q_DISABLE_COPY(ImapMetrics)
+
+    mutable QMutex m_mutex;
+    QMap<QByteArray,Counters> m_counters;
+};
+
+#endif // SKAFFARI_IMAPMETRICS_H
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "quotacache.h"
+
+#include <QDeadlineTimer>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include <atomic>
+
+struct QuotaCacheEntry
+{
+    quota_pair quota;
+    qint64 stored{0}; // monotonic clock in milliseconds
+};
+
+struct QuotaCacheData
+{
+    QReadWriteLock lock;
+    QHash<QString,QuotaCacheEntry> values;
+    std::atomic<bool> eventFed{false};
+};
+
+Q_GLOBAL_STATIC(QuotaCacheData, quotaCacheData)
+
+void QuotaCache::insert(const QString &user, quota_pair quota)
+{
+    QWriteLocker locker(&quotaCacheData->lock);
+    quotaCacheData->values.insert(user, QuotaCacheEntry{quota, QDeadlineTimer::current().deadline()});
+}
+
+std::optional<quota_pair> QuotaCache::value(const QString &user)
+{
+    QReadLocker locker(&quotaCacheData->lock);
+    const auto it = quotaCacheData->values.constFind(user);
+    if (it == quotaCacheData->values.cend()) {
+        return std::nullopt;
+    }
+    return it.value().quota;
+}
+
+std::optional<quota_pair> QuotaCache::current(const QString &user)
+{
+    if (!isEventFed()) {
+        return std::nullopt;
+    }
+
+    QReadLocker locker(&quotaCacheData->lock);
+    const auto it = quotaCacheData->values.constFind(user);
+    if (it == quotaCacheData->values.cend()) {
+        return std::nullopt;
+    }
+
+    // refresh from time to time in case events got lost
+    if (QDeadlineTimer::current().deadline() - it.value().stored > static_cast<qint64>(MEMC_QUOTA_EXP) * 1000) {
+        return std::nullopt;
+    }
+
+    return it.value().quota;
+}
+
+void QuotaCache::setEventFed(bool eventFed)
+{
+    quotaCacheData->eventFed.store(eventFed, std::memory_order_relaxed);
+}
+
+bool QuotaCache::isEventFed()
+{
+    return quotaCacheData->eventFed.load(std::memory_order_relaxed);
+}
+
+void QuotaCache::remove(const QString &user)
+{
+    QWriteLocker locker(&quotaCacheData->lock);
+    quotaCacheData->values.remove(user);
+}
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_QUOTACACHE_H
+#define SKAFFARI_QUOTACACHE_H
+
+#include "../../common/global.h"
+
+#include <QString>
+
+#include <optional>
+
+/*!
+ * \brief Prefix of the memcached keys that store the quota usage of an account, followed by the account ID.
+ */
+#define MEMC_QUOTA_KEY QLatin1String("sk_quotausage_")
+/*!
+ * \brief Expiration time in seconds of the quota usage values in memcached.
+ */
+#define MEMC_QUOTA_EXP 900
+
+/*!
+ * \brief Process wide store of the last known storage quota values of user mailboxes.
+ *
+ * Values are added whenever the quota has been requested from the IMAP server and
+ * when QuotaEventListener receives quota events. They are used as fallback when the
+ * IMAP server is not available, so that pages can show the last known values instead
+ * of waiting for the connection to time out.
+ *
+ * In the process that receives the event notifications of the IMAP server, the values
+ * are kept up to date by the events and current() returns them to be used instead of
+ * asking the IMAP server. The store is not shared between processes, other processes
+ * only get the event updates through memcached.
+ */
+class QuotaCache
+{
+public:
+    /*!
+     * \brief Stores the \a quota values (usage and limit in KiB) of the mailbox of \a user.
+     */
+    static void insert(const QString &user, quota_pair quota);
+
+    /*!
+     * \brief Returns the last known quota values of the mailbox of \a user, if any.
+     */
+    [[nodiscard]] static std::optional<quota_pair> value(const QString &user);
+
+    /*!
+     * \brief Returns the quota values of the mailbox of \a user if they are kept up to date by events.
+     *
+     * Returns \c std::nullopt if this process does not receive quota events or if the values
+     * are older than #MEMC_QUOTA_EXP seconds, like the values stored in memcached.
+     */
+    [[nodiscard]] static std::optional<quota_pair> current(const QString &user);
+
+    /*!
+     * \brief Set \a eventFed to \c true if this process receives the quota events of the IMAP server.
+     */
+    static void setEventFed(bool eventFed);
+
+    /*!
+     * \brief Returns \c true if this process receives the quota events of the IMAP server.
+     */
+    [[nodiscard]] static bool isEventFed();
+
+    /*!
+     * \brief Removes the values for the mailbox of \a user.
+     */
+    static void remove(const QString &user);
+};
+
+#endif // SKAFFARI_QUOTACACHE_H
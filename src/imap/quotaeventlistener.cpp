@@ -0,0 +1,317 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "quotaeventlistener.h"
+#include "imap.h"
+#include "quotacache.h"
+#include "../utils/skaffariconfig.h"
+#include "../utils/listversion.h"
+
+#include <Cutelyst/Plugins/Memcached/Memcached>
+#include <Cutelyst/Plugins/Utils/Sql>
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSocketNotifier>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUrl>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::optional<quota_size_t> quotaValue(const QJsonObject &o, QLatin1String key)
+{
+    const QJsonValue v = o.value(key);
+    if (v.isUndefined() || v.isNull()) {
+        return std::nullopt;
+    }
+    bool ok = false;
+    const quota_size_t value = v.toVariant().toULongLong(&ok);
+    if (!ok) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+bool fillAddress(const QString &path, sockaddr_un &addr)
+{
+    const QByteArray encoded = QFile::encodeName(path);
+    if (encoded.isEmpty() || static_cast<size_t>(encoded.size()) >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, encoded.constData(), static_cast<size_t>(encoded.size()));
+    return true;
+}
+
+/*
+ * Removes the socket file at addr if no other process is listening on it anymore.
+ */
+bool removeStaleSocket(const sockaddr_un &addr)
+{
+    const int probe = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        return false;
+    }
+    const bool stale = ::connect(probe, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 && errno == ECONNREFUSED;
+    ::close(probe);
+    return stale && ::unlink(addr.sun_path) == 0;
+}
+
+}
+
+bool QuotaEventListener::Event::isUserRoot() const
+{
+    return !user.isEmpty() && (mailbox.isEmpty() || mailbox.compare(QLatin1String("INBOX"), Qt::CaseInsensitive) == 0);
+}
+
+QuotaEventListener::QuotaEventListener(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+QuotaEventListener::~QuotaEventListener()
+{
+    close();
+}
+
+bool QuotaEventListener::listen(const QString &path)
+{
+    close();
+
+    sockaddr_un addr;
+    if (Q_UNLIKELY(!fillAddress(path, addr))) {
+        qCWarning(SK_IMAP) << "Invalid path for the IMAP event socket:" << path;
+        return false;
+    }
+
+    m_fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (Q_UNLIKELY(m_fd < 0)) {
+        qCWarning(SK_IMAP) << "Failed to create IMAP event socket:" << std::strerror(errno);
+        return false;
+    }
+
+    if (::bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        if (errno != EADDRINUSE) {
+            qCWarning(SK_IMAP) << "Failed to bind IMAP event socket" << path << ":" << std::strerror(errno);
+            close();
+            return false;
+        }
+        if (!removeStaleSocket(addr)) {
+            qCDebug(SK_IMAP) << "IMAP event socket" << path << "is already used by another process";
+            close();
+            return false;
+        }
+        if (Q_UNLIKELY(::bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)) {
+            qCWarning(SK_IMAP) << "Failed to bind IMAP event socket" << path << ":" << std::strerror(errno);
+            close();
+            return false;
+        }
+    }
+
+    // Cyrus usually runs as a different user
+    ::chmod(addr.sun_path, 0660);
+
+    m_path = path;
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &QuotaEventListener::readDatagrams);
+
+    QuotaCache::setEventFed(true);
+
+    qCInfo(SK_IMAP) << "Listening for IMAP event notifications on" << path;
+    if (!SkaffariConfig::useMemcached()) {
+        qCInfo(SK_IMAP) << "Memcached is disabled, quota events are only used by process" << ::getpid();
+    }
+
+    return true;
+}
+
+void QuotaEventListener::close()
+{
+    if (m_notifier) {
+        QuotaCache::setEventFed(false);
+    }
+
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    if (!m_path.isEmpty()) {
+        QFile::remove(m_path);
+        m_path.clear();
+    }
+}
+
+bool QuotaEventListener::isListening() const
+{
+    return m_notifier != nullptr;
+}
+
+void QuotaEventListener::readDatagrams()
+{
+    QByteArray buf(65536, Qt::Uninitialized);
+
+    for (;;) {
+        const ssize_t size = ::recv(m_fd, buf.data(), static_cast<size_t>(buf.size()), 0);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qCWarning(SK_IMAP) << "Failed to read from IMAP event socket:" << std::strerror(errno);
+            }
+            return;
+        }
+
+        const Event event = parse(QByteArray::fromRawData(buf.constData(), static_cast<int>(size)));
+        if (event.isValid()) {
+            apply(event);
+            Q_EMIT eventReceived(event);
+        } else {
+            qCDebug(SK_IMAP) << "Ignoring invalid IMAP event notification";
+        }
+    }
+}
+
+QuotaEventListener::Event QuotaEventListener::parse(const QByteArray &data)
+{
+    Event event;
+
+    QByteArray json;
+    if (data.startsWith('{')) {
+        json = data.trimmed();
+    } else {
+        // notifyd format: method, class, priority, user, mailbox, number of options,
+        // options, message and file name, separated by null characters
+        const QList<QByteArray> fields = data.split('\0');
+        for (const QByteArray &field : fields) {
+            if (field.startsWith('{')) {
+                json = field;
+                break;
+            }
+        }
+    }
+
+    if (json.isEmpty()) {
+        return event;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        return event;
+    }
+
+    const QJsonObject o = doc.object();
+    event.type = o.value(QLatin1String("event")).toString();
+    if (event.type.isEmpty()) {
+        return event;
+    }
+
+    // imap://user@host/mailbox;UIDVALIDITY=123
+    const QUrl uri(o.value(QLatin1String("uri")).toString());
+    if (uri.isValid()) {
+        event.user = uri.userName(QUrl::FullyDecoded);
+        QString mailbox = uri.path(QUrl::FullyDecoded);
+        const int paramIdx = mailbox.indexOf(QLatin1Char(';'));
+        if (paramIdx > -1) {
+            mailbox.truncate(paramIdx);
+        }
+        while (mailbox.startsWith(QLatin1Char('/'))) {
+            mailbox.remove(0, 1);
+        }
+        event.mailbox = mailbox;
+    }
+
+    event.used = quotaValue(o, QLatin1String("diskUsed"));
+    event.limit = quotaValue(o, QLatin1String("diskQuota"));
+
+    return event;
+}
+
+void QuotaEventListener::apply(const Event &event)
+{
+    if (event.user.isEmpty()) {
+        return;
+    }
+
+    if (event.used) {
+        // the limit is only part of quota events, the database is authoritative for it anyway
+        std::optional<quota_size_t> limit = event.limit;
+        if (!limit) {
+            if (const auto cached = QuotaCache::value(event.user)) {
+                limit = cached->second;
+            }
+        }
+        if (limit) {
+            QuotaCache::insert(event.user, {*event.used, *limit});
+        }
+
+        if (SkaffariConfig::useMemcached()) {
+            const dbid_t id = accountId(event.user);
+            if (id > 0) {
+                Cutelyst::Memcached::set(MEMC_QUOTA_KEY + QString::number(id), QByteArray::number(*event.used), MEMC_QUOTA_EXP);
+            }
+            ListVersion::quotaChanged();
+        }
+
+        qCDebug(SK_IMAP) << "Updated quota usage of" << event.user << "to" << *event.used << "KiB from" << event.type << "event";
+
+    } else if (event.type == QLatin1String("MailboxDelete") || (event.type == QLatin1String("MailboxCreate") && event.isUserRoot())) {
+        // deleted folders change the usage, new or deleted accounts invalidate everything
+        QuotaCache::remove(event.user);
+
+        if (SkaffariConfig::useMemcached()) {
+            const dbid_t id = accountId(event.user);
+            if (id > 0) {
+                Cutelyst::Memcached::remove(MEMC_QUOTA_KEY + QString::number(id));
+            }
+            ListVersion::quotaChanged();
+        }
+
+        if (event.isUserRoot()) {
+            m_accountIds.remove(event.user);
+        }
+
+        qCDebug(SK_IMAP) << "Invalidated quota usage of" << event.user << "from" << event.type << "event";
+    }
+}
+
+dbid_t QuotaEventListener::accountId(const QString &user)
+{
+    const auto it = m_accountIds.constFind(user);
+    if (it != m_accountIds.cend()) {
+        return it.value();
+    }
+
+    QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("SELECT id FROM accountuser WHERE username = :username"));
+    q.bindValue(QStringLiteral(":username"), user);
+    if (Q_UNLIKELY(!q.exec())) {
+        qCWarning(SK_IMAP) << "Failed to query ID of account" << user << "for IMAP event notification:" << q.lastError().text();
+        return 0;
+    }
+
+    const dbid_t id = q.next() ? q.value(0).value<dbid_t>() : 0;
+    if (id > 0) {
+        m_accountIds.insert(user, id);
+    }
+    return id;
+}
+
+#include "moc_quotaeventlistener.cpp"
@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_QUOTAEVENTLISTENER_H
+#define SKAFFARI_QUOTAEVENTLISTENER_H
+
+#include "../../common/global.h"
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+
+#include <optional>
+
+class QSocketNotifier;
+
+/*!
+ * \brief Receives event notifications (RFC 5423) from Cyrus IMAP and updates the cached quota usage.
+ *
+ * Cyrus sends its event notifications as datagrams to the Unix socket configured by the
+ * \c notifysocket option in imapd.conf. The listener binds to that socket instead of
+ * notifyd and applies QuotaChange, QuotaExceeded and QuotaWithin events to the QuotaCache
+ * and to memcached, if enabled. MailboxCreate and MailboxDelete events for user mailboxes
+ * invalidate the cached values. Every other event that carries the \c diskUsed parameter
+ * updates the usage, too.
+ *
+ * Only one process can bind to the socket. If the socket is already in use by another
+ * process, listen() returns \c false. QuotaCache is local to the listening process, other
+ * processes only get the event updates if memcached is enabled.
+ */
+class QuotaEventListener : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Relevant data of a single event notification.
+     */
+    struct Event {
+        QString type;
+        /*!
+         * \brief Owner of the mailbox the event belongs to, empty for shared mailboxes.
+         */
+        QString user;
+        /*!
+         * \brief Mailbox name in the namespace of the owner, like \c INBOX or \c INBOX/Sent.
+         */
+        QString mailbox;
+        std::optional<quota_size_t> used;
+        std::optional<quota_size_t> limit;
+
+        [[nodiscard]] bool isValid() const { return !type.isEmpty(); }
+
+        /*!
+         * \brief Returns \c true if the event belongs to the personal root mailbox of a user.
+         */
+        [[nodiscard]] bool isUserRoot() const;
+    };
+
+    explicit QuotaEventListener(QObject *parent = nullptr);
+    ~QuotaEventListener() override;
+
+    /*!
+     * \brief Binds to the Unix datagram socket at \a path.
+     *
+     * A stale socket file left by a previous process is removed.
+     */
+    bool listen(const QString &path);
+
+    void close();
+
+    [[nodiscard]] bool isListening() const;
+
+    /*!
+     * \brief Parses a single event notification.
+     *
+     * \a data can either be a datagram in the notifyd format, where the JSON
+     * encoded event is one of the null separated fields, or the plain JSON object.
+     * Returns an invalid Event if \a data does not contain an event.
+     */
+    [[nodiscard]] static Event parse(const QByteArray &data);
+
+    /*!
+     * \brief Updates the cached quota values according to \a event.
+     */
+    void apply(const Event &event);
+
+Q_SIGNALS:
+    void eventReceived(const QuotaEventListener::Event &event);
+
+private:
+    void readDatagrams();
+    [[nodiscard]] dbid_t accountId(const QString &user);
+
+    QHash<QString,dbid_t> m_accountIds;
+    QString m_path;
+    QSocketNotifier *m_notifier{nullptr};
+    int m_fd{-1};
+
+    Q_DISABLE_COPY(QuotaEventListener)
+};
+
+Q_DECLARE_METATYPE(QuotaEventListener::Event)
+
+#endif // SKAFFARI_QUOTAEVENTLISTENER_H
@@ -24,8 +24,12 @@
 #include "utils/utils.h"
 #include "imap/imap.h"
 #include "imap/imaperror.h"
+#include "imap/quotacache.h"
 #include "../../common/password.h"
 #include "utils/skaffariconfig.h"
+#include "utils/aliasfilter.h"
+#include "utils/listversion.h"
+#include "utils/collation.h"
 #include <Cutelyst/Context>
 #include <Cutelyst/Plugins/Utils/Sql>
 #include <Cutelyst/Response>
@@ -39,7 +43,6 @@
 #include <QRegularExpression>
 #include <QUrl>
 #include <QStringList>
-#include <QCollator>
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QLocale>
@@ -50,8 +53,6 @@ Q_LOGGING_CATEGORY(SK_ACCOUNT, "skaffari.account")
 #define PAM_ACCT_EXPIRED 1
 #define PAM_NEW_AUTHTOK_REQD 2
 
-#define MEMC_QUOTA_EXP 900
-#define MEMC_QUOTA_KEY QLatin1String("sk_quotausage_")
 
 Account::Account() :
     d(new AccountData)
@@ -295,6 +296,9 @@ dbid_t insertVirtual(dbid_t idn_id, dbid_t ace_id, const QString &alias, const Q
 
     if (Q_LIKELY(q.exec())) {
         ret = q.lastInsertId().value<dbid_t>();
+        if (!username.isEmpty()) {
+            AliasFilter::add(alias);
+        }
     } else {
         error = q.lastError();
     }
@@ -561,7 +565,7 @@ Account Account::create(Cutelyst::Context *c, SkaffariError &e, const QVariantHa
 
     const quint8 accountStatus = Account::calcStatus(validUntil, pwExpires);
 
-    QMap<Imap::SpecialUse,QString> folders;
+    Imap::FolderList folders;
 
     QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("INSERT INTO accountuser (domain_id, username, password, imap, pop, sieve, smtpauth, quota, created_at, updated_at, valid_until, pwd_expire, status) "
                                          "VALUES (:domain_id, :username, :password, :imap, :pop, :sieve, :smtpauth, :quota, :created_at, :updated_at, :valid_until, :pwd_expire, :status)"));
@@ -750,75 +754,62 @@ Account Account::create(Cutelyst::Context *c, SkaffariError &e, const QVariantHa
 
             if (Q_LIKELY(imap.login())) {
 
-                if (Q_LIKELY(imap.createMailbox(username))) {
-
-                    // at this point, the mailbox has been created on the IMAP server
-                    // all following actions can fail - if they do, it is not nice,
-                    // but base functionality is given, so we only log errors
-                    mailboxCreated = true;
-
-                    if (Q_UNLIKELY(!imap.setQuota(username, quota))) {
-                        qCWarning(SK_ACCOUNT) << "Failed to set IMAP quota for new mailbox" << username;
+                Imap::MailboxProvisioning mbp;
+                mbp.user = username;
+                mbp.quota = quota;
+
+                const Imap::FolderList specialFolderKeys{
+                    {Imap::SpecialUse::Sent, QStringLiteral("sentFolder")},
+                    {Imap::SpecialUse::Trash, QStringLiteral("trashFolder")},
+                    {Imap::SpecialUse::Drafts, QStringLiteral("draftsFolder")},
+                    {Imap::SpecialUse::Junk, QStringLiteral("junkFolder")},
+                    {Imap::SpecialUse::Archive, QStringLiteral("archiveFolder")}
+                };
+                for (const auto &sfk : specialFolderKeys) {
+                    const QString folder = p.value(sfk.second).toString().trimmed();
+                    if (!folder.isEmpty()) {
+                        mbp.folders.push_back(std::make_pair(sfk.first, folder));
                     }
+                }
 
-                    const QString sentFolder = p.value(QStringLiteral("sentFolder")).toString().trimmed();
-                    if (!sentFolder.isEmpty()) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, sentFolder, Imap::SpecialUse::Sent))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP sent folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(sentFolder), aunStr, qUtf8Printable(imap.lastError().text()));
-                        } else {
-                            folders.insert(Imap::SpecialUse::Sent, sentFolder);
-                        }
+                const QStringList otherFolders = p.value(QStringLiteral("otherFolders")).toString().split(QLatin1Char(','), Qt::SkipEmptyParts);
+                for (const QString &otherFolder : otherFolders) {
+                    const QString folder = otherFolder.trimmed();
+                    if (!folder.isEmpty()) {
+                        mbp.folders.push_back(std::make_pair(Imap::SpecialUse::None, folder));
                     }
+                }
 
-                    const QString trashFolder = p.value(QStringLiteral("trashFolder")).toString().trimmed();
-                    if (!trashFolder.isEmpty()) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, trashFolder, Imap::SpecialUse::Trash))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP trash folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(trashFolder), aunStr, qUtf8Printable(imap.lastError().text()));
-                        } else {
-                            folders.insert(Imap::SpecialUse::Trash, trashFolder);
-                        }
-                    }
+                // all commands are pipelined, the results are in the order:
+                // CREATE mailbox, SETQUOTA, CREATE for every folder
+                const Imap::BatchResults results = imap.provisionMailboxes({mbp});
+                Q_ASSERT(results.size() == mbp.folders.size() + 2);
 
-                    const QString draftsFolder = p.value(QStringLiteral("draftsFolder")).toString().trimmed();
-                    if (!draftsFolder.isEmpty()) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, draftsFolder, Imap::SpecialUse::Drafts))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP drafts folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(draftsFolder), aunStr, qUtf8Printable(imap.lastError().text()));
-                        } else {
-                            folders.insert(Imap::SpecialUse::Drafts, draftsFolder);
-                        }
-                    }
+                if (Q_LIKELY(results.at(0).response)) {
 
-                    const QString junkFolder = p.value(QStringLiteral("junkFolder")).toString().trimmed();
-                    if (!junkFolder.isEmpty()) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, junkFolder, Imap::SpecialUse::Junk))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP junk folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(junkFolder), aunStr, qUtf8Printable(imap.lastError().text()));
-                        } else {
-                            folders.insert(Imap::SpecialUse::Junk, junkFolder);
-                        }
-                    }
+                    // at this point, the mailbox has been created on the IMAP server
+                    // all following actions can fail - if they do, it is not nice,
+                    // but base functionality is given, so we only log errors
+                    mailboxCreated = true;
 
-                    const QString archiveFolder = p.value(QStringLiteral("archiveFolder")).toString().trimmed();
-                    if (!archiveFolder.isEmpty()) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, archiveFolder, Imap::SpecialUse::Archive))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP archive folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(archiveFolder), aunStr, qUtf8Printable(imap.lastError().text()));
-                        } else {
-                            folders.insert(Imap::SpecialUse::Archive, archiveFolder);
-                        }
+                    if (Q_UNLIKELY(!results.at(1).response)) {
+                        qCWarning(SK_ACCOUNT, "%s failed to set IMAP quota for new account %s: %s", uniStr, aunStr, qUtf8Printable(results.at(1).response.error().text()));
                     }
 
-                    const QStringList otherFolders = p.value(QStringLiteral("otherFolders")).toString().trimmed().split(QLatin1Char(','));
-                    for (const QString &otherFolder : otherFolders) {
-                        if (Q_UNLIKELY(!imap.createFolder(username, otherFolder))) {
-                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(otherFolder), aunStr, qUtf8Printable(imap.lastError().text()));
+                    for (int i = 0; i < mbp.folders.size(); ++i) {
+                        const auto &folder = mbp.folders.at(i);
+                        const ImapResponse &r = results.at(i + 2).response;
+                        if (Q_UNLIKELY(!r)) {
+                            qCWarning(SK_ACCOUNT, "%s failed to create IMAP folder \"%s\" for new account %s: %s", uniStr, qUtf8Printable(folder.second), aunStr, qUtf8Printable(r.error().text()));
                         } else {
-                            folders.insert(Imap::SpecialUse::None, otherFolder);
+                            folders.push_back(folder);
                         }
                     }
 
                     imap.logout();
 
                 } else {
-                    e.setImapError(imap.lastError(), c->translate("Account", "Creating a new IMAP mailbox failed."));
+                    e.setImapError(results.at(0).response.error(), c->translate("Account", "Creating a new IMAP mailbox failed."));
                     imap.logout();
                     mailboxCreated = false;
                 }
@@ -858,29 +849,22 @@ Account Account::create(Cutelyst::Context *c, SkaffariError &e, const QVariantHa
 
         if (Q_LIKELY(imap.login(username, password))) {
 
-            if (Q_UNLIKELY(!imap.subscribeFolder())) {
-                qCWarning(SK_ACCOUNT, "%s failed to subscribe newly created user \"%s\" to its INBOX: %s", uniStr, aunStr, qUtf8Printable(imap.lastError().text()));
-            }
-
-            for (const QString &f : folders.values()) {
-                if (Q_UNLIKELY(!imap.subscribeFolder(f))) {
-                    qCWarning(SK_ACCOUNT, "%s failed to subscribe newly created user \"%s\" to folder \"%s\": %s", uniStr, aunStr, qUtf8Printable(f), qUtf8Printable(imap.lastError().text()));
+            const Imap::BatchResults results = imap.provisionFolders(folders);
+            for (const Imap::BatchResult &result : results) {
+                if (Q_UNLIKELY(!result.response)) {
+                    qCWarning(SK_ACCOUNT, "%s failed to run \"%s\" for newly created user \"%s\": %s", uniStr, qUtf8Printable(result.command), aunStr, qUtf8Printable(result.response.error().text()));
                 }
             }
 
-            if (!imap.hasCapability(QStringLiteral("CREATE-SPECIAL-USE")) && imap.hasCapability(QStringLiteral("SPECIAL-USE")) && imap.hasCapability(QStringLiteral("METADATA"))) {
-                for (auto i = folders.constBegin(); i != folders.constEnd(); ++i) {
-                    if (Q_UNLIKELY(!imap.setSpecialUse(i.value(), i.key()))) {
-                        qCWarning(SK_ACCOUNT, "%s failed to set special use flag %u on folder \"%s\" for newly created user \"%s\": %s", uniStr, static_cast<uint>(i.key()), qUtf8Printable(i.value()), aunStr, qUtf8Printable(imap.lastError().text()));
-                    }
-                }
-            }
+            imap.logout();
 
         } else {
             qCWarning(SK_ACCOUNT, "%s failed to login newly created user \"%s\" to subscribe to folders: %s", uniStr, aunStr, qUtf8Printable(imap.lastError().text()));
         }
     }
 
+    ListVersion::accountsChanged(d.id());
+
     qCInfo(SK_ACCOUNT, "%s created new account %s in domain %s", uniStr, qUtf8Printable(a.nameIdString()), qUtf8Printable(d.nameIdString()));
 
     return a;
@@ -918,6 +902,8 @@ bool Account::remove(Cutelyst::Context *c, SkaffariError &e) const
 
     imap.logout();
 
+    QuotaCache::remove(d->username);
+
     QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("SELECT quota FROM accountuser WHERE username = :username"));
     q.bindValue(QStringLiteral(":username"), d->username);
 
@@ -970,6 +956,8 @@ bool Account::remove(Cutelyst::Context *c, SkaffariError &e) const
         qCWarning(SK_ACCOUNT, "%s failed to update count of domain accounts and used quota for domain ID %u after deleting account %s: %s", uniStr, d->domainId, aniStr, qUtf8Printable(q.lastError().text()));
     }
 
+    ListVersion::accountsChanged(d->domainId);
+
     qCInfo(SK_ACCOUNT, "%s deleted account %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(nameIdString()));
 
     ret = true;
@@ -979,8 +967,44 @@ bool Account::remove(Cutelyst::Context *c, SkaffariError &e) const
 
 Cutelyst::Pagination Account::list(Cutelyst::Context *c, SkaffariError &e, const Domain &d, const Cutelyst::Pagination &p, const QString &sortBy, const QString &sortOrder, const QString &searchRole, const QString &searchString)
 {
-    Cutelyst::Pagination pag;
+    std::vector<AccountListRow> rows;
+    Cutelyst::Pagination pag = Account::listRows(c, e, d, p, rows, sortBy, sortOrder, searchRole, searchString);
+
+    if (rows.empty()) {
+        return pag;
+    }
+
     std::vector<Account> lst;
+    lst.reserve(rows.size());
+    for (const AccountListRow &row : rows) {
+        lst.emplace_back(row.id,
+                         d.id(),
+                         row.username,
+                         row.testFlag(AccountListRow::Imap),
+                         row.testFlag(AccountListRow::Pop),
+                         row.testFlag(AccountListRow::Sieve),
+                         row.testFlag(AccountListRow::SmtpAuth),
+                         row.addresses,
+                         row.forwards,
+                         row.quota,
+                         row.usage,
+                         row.created,
+                         row.updated,
+                         row.validUntil,
+                         row.passwordExpires,
+                         row.testFlag(AccountListRow::KeepLocal),
+                         row.testFlag(AccountListRow::CatchAll),
+                         row.status);
+    }
+
+    pag.insert(QStringLiteral("accounts"), QVariant::fromValue<std::vector<Account>>(lst));
+
+    return pag;
+}
+
+Cutelyst::Pagination Account::listRows(Cutelyst::Context *c, SkaffariError &e, const Domain &d, const Cutelyst::Pagination &p, std::vector<AccountListRow> &rows, const QString &sortBy, const QString &sortOrder, const QString &searchRole, const QString &searchString)
+{
+    Cutelyst::Pagination pag;
 
     Q_ASSERT_X(c, "list accounts", "invalid context object");
 
@@ -1031,13 +1055,12 @@ Cutelyst::Pagination Account::list(Cutelyst::Context *c, SkaffariError &e, const
 
     pag = Cutelyst::Pagination(static_cast<int>(foundRows), p.limit(), p.currentPage(), p.pages().size());
 
+    // only log in if there are quota values that are neither in memcached nor updated by events
     Imap imap(c);
-    if (!imap.login()) {
-        qCWarning(SK_ACCOUNT, "%s failed to log IMAP admin into IMAP server to query account quotas while listing accounts for domain %s: %s", uniStr, dniStr, qUtf8Printable(imap.lastError().text()));
-    }
+    bool imapLoginTried = false;
 
-    QCollator col(c->locale());
-    lst.reserve(foundRows);
+    const QLocale locale = c->locale();
+    rows.reserve(rows.size() + static_cast<std::size_t>(q.size() > 0 ? q.size() : 0));
 
     while (q.next()) {
         const dbid_t _id = q.value(0).value<dbid_t>();
@@ -1059,11 +1082,11 @@ Cutelyst::Pagination Account::list(Cutelyst::Context *c, SkaffariError &e, const
         if ((emailAddresses.first.size() > 1) || (forwards.first.size() > 1)) {
 
             if (emailAddresses.first.size() > 1) {
-                std::sort(emailAddresses.first.begin(), emailAddresses.first.end(), col);
+                Collation::sort(emailAddresses.first, locale);
             }
 
             if (forwards.first.size() > 1) {
-                std::sort(forwards.first.begin(), forwards.first.end(), col);
+                Collation::sort(forwards.first, locale);
             }
         }
 
@@ -1081,40 +1104,62 @@ Cutelyst::Pagination Account::list(Cutelyst::Context *c, SkaffariError &e, const
         }
 
         if (!gotQuota) {
+            if (const auto current = QuotaCache::current(_username)) {
+                usage = current->first;
+                quota = current->second;
+                gotQuota = true;
+            }
+        }
+
+        if (!gotQuota) {
+            if (!imapLoginTried) {
+                imapLoginTried = true;
+                if (!imap.login()) {
+                    qCWarning(SK_ACCOUNT, "%s failed to log IMAP admin into IMAP server to query account quotas while listing accounts for domain %s: %s", uniStr, dniStr, qUtf8Printable(imap.lastError().text()));
+                }
+            }
+
             if (Q_LIKELY(imap.isLoggedIn())) {
                 quota_pair quotaVals = imap.getQuota(_username);
                 usage = quotaVals.first;
                 quota = quotaVals.second;
+                if (Q_LIKELY(!imap.lastError())) {
+                    QuotaCache::insert(_username, quotaVals);
+                }
                 if (SkaffariConfig::useMemcached()) {
                     Cutelyst::Memcached::set(MEMC_QUOTA_KEY + QString::number(_id), QByteArray::number(quotaVals.first), MEMC_QUOTA_EXP);
                 }
+            } else if (const auto cached = QuotaCache::value(_username)) {
+                usage = cached->first;
+                quota = cached->second;
             }
         }
 
-        lst.emplace_back(_id,
-                         d.id(),
-                         _username,
-                         q.value(2).toBool(),
-                         q.value(3).toBool(),
-                         q.value(4).toBool(),
-                         q.value(5).toBool(),
-                         emailAddresses.first,
-                         forwards.first,
-                         quota,
-                         usage,
-                         accountCreated,
-                         accountUpdated,
-                         accountValidUntil,
-                         accountPwExpires,
-                         forwards.second,
-                         emailAddresses.second,
-                         q.value(11).value<quint8>());
+        AccountListRow row;
+        row.id = _id;
+        row.username = _username;
+        row.setFlag(AccountListRow::Imap, q.value(2).toBool());
+        row.setFlag(AccountListRow::Pop, q.value(3).toBool());
+        row.setFlag(AccountListRow::Sieve, q.value(4).toBool());
+        row.setFlag(AccountListRow::SmtpAuth, q.value(5).toBool());
+        row.setFlag(AccountListRow::KeepLocal, forwards.second);
+        row.setFlag(AccountListRow::CatchAll, emailAddresses.second);
+        row.addresses = std::move(emailAddresses.first);
+        row.forwards = std::move(forwards.first);
+        row.quota = quota;
+        row.usage = usage;
+        row.created = accountCreated;
+        row.updated = accountUpdated;
+        row.validUntil = accountValidUntil;
+        row.passwordExpires = accountPwExpires;
+        row.status = q.value(11).value<quint8>();
+        rows.push_back(std::move(row));
+    }
+
+    if (imap.isLoggedIn()) {
+        imap.logout();
     }
 
-    imap.logout();
-
-    pag.insert(QStringLiteral("accounts"), QVariant::fromValue<std::vector<Account>>(lst));
-
     return pag;
 }
 
@@ -1156,14 +1201,14 @@ Account Account::get(Cutelyst::Context *c, SkaffariError &e, dbid_t id)
     std::pair<QStringList,bool> forwards = queryFowards(c, userName);
 
     if ((emailAddresses.first.size() > 1) || (forwards.first.size() > 1)) {
-        QCollator col(c->locale());
+        const QLocale locale = c->locale();
 
         if (emailAddresses.first.size() > 1) {
-            std::sort(emailAddresses.first.begin(), emailAddresses.first.end(), col);
+            Collation::sort(emailAddresses.first, locale);
         }
 
         if (forwards.first.size() > 1) {
-            std::sort(forwards.first.begin(), forwards.first.end(), col);
+            Collation::sort(forwards.first, locale);
         }
     }
 
@@ -1180,17 +1225,31 @@ Account Account::get(Cutelyst::Context *c, SkaffariError &e, dbid_t id)
         }
     }
 
+    if (!gotUsage) {
+        if (const auto current = QuotaCache::current(userName)) {
+            usage = current->first;
+            quota = current->second;
+            gotUsage = true;
+        }
+    }
+
     if (!gotUsage) {
         Imap imap(c);
         if (imap.login()) {
             quota_pair quotaPair = imap.getQuota(userName);
             usage = quotaPair.first;
             quota = quotaPair.second;
+            if (Q_LIKELY(!imap.lastError())) {
+                QuotaCache::insert(userName, quotaPair);
+            }
             imap.logout();
 
             if (SkaffariConfig::useMemcached()) {
-                Cutelyst::Memcached::set(MEMC_QUOTA_KEY + QString::number(id), QByteArray::number(quota), MEMC_QUOTA_EXP);
+                Cutelyst::Memcached::set(MEMC_QUOTA_KEY + QString::number(id), QByteArray::number(usage), MEMC_QUOTA_EXP);
             }
+        } else if (const auto cached = QuotaCache::value(userName)) {
+            usage = cached->first;
+            quota = cached->second;
         }
     }
 
@@ -1433,6 +1492,8 @@ bool Account::update(Cutelyst::Context *c, SkaffariError &e, Domain *dom, const
         }
     }
 
+    ListVersion::accountsChanged(d->domainId);
+
     qCInfo(SK_ACCOUNT, "%s updated account %s in domain %s", uniStr, aniStr, dniStr);
 
     ret = true;
@@ -1623,6 +1684,7 @@ QStringList Account::check(Cutelyst::Context *c, SkaffariError &e, const Domain
                                 qq.bindValue(QStringLiteral(":status"), 1);
 
                                 if (Q_LIKELY(qq.exec())) {
+                                    AliasFilter::add(childAddress);
                                     const QString newAddress = parts.first + QLatin1Char('@') + kid.name();
                                     newAddresses.push_back(newAddress);
                                     qCInfo(SK_ACCOUNT, "%s added a new address for child domain %s to account %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(kid.nameIdString()), qUtf8Printable(nameIdString()));
@@ -1640,8 +1702,7 @@ QStringList Account::check(Cutelyst::Context *c, SkaffariError &e, const Domain
             if (!newAddresses.empty()) {
                 d->addresses.append(newAddresses);
                 if (d->addresses.size() > 1) {
-                    QCollator col(c->locale());
-                    std::sort(d->addresses.begin(), d->addresses.end(), col);
+                    Collation::sort(d->addresses, c->locale());
                 }
             }
         }
@@ -1775,11 +1836,15 @@ QString Account::updateEmail(Cutelyst::Context *c, SkaffariError &e, const QVari
         return ret;
     }
 
+    AliasFilter::add(address);
+    if (dom.isIdn()) {
+        AliasFilter::add(aceAddress);
+    }
+
     d->addresses.removeOne(oldAddress);
     d->addresses.push_back(address);
     if (d->addresses.size() > 1) {
-        QCollator col(c->locale());
-        std::sort(d->addresses.begin(), d->addresses.end(), col);
+        Collation::sort(d->addresses, c->locale());
     }
 
     qCInfo(SK_ACCOUNT, "%s updated email address %s of account %s to %s.", uniStr, qUtf8Printable(oldAddress), aniStr, qUtf8Printable(address));
@@ -1864,8 +1929,7 @@ QString Account::addEmail(Cutelyst::Context *c, SkaffariError &e, const QVariant
 
     d->addresses.push_back(address);
     if (d->addresses.size() > 1) {
-        QCollator col(c->locale());
-        std::sort(d->addresses.begin(), d->addresses.end(), col);
+        Collation::sort(d->addresses, c->locale());
     }
 
     qCInfo(SK_ACCOUNT, "%s added new email address %s to account %s.", uniStr, qUtf8Printable(address), aniStr);
@@ -2283,6 +2347,8 @@ void Account::markUpdated(Cutelyst::Context *c)
     }
 
     d->updated = current;
+
+    ListVersion::accountsChanged(d->domainId);
 }
 
 QString AccountData::nameIdString() const
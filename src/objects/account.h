@@ -21,6 +21,7 @@
 
 #include "../../common/global.h"
 #include "objects/domain.h"
+#include "objects/accountlistrow.h"
 #include <Cutelyst/ParamsMultiMap>
 #include <Cutelyst/Plugins/Utils/Pagination>
 #include <QSharedDataPointer>
@@ -397,6 +398,15 @@ public:
      */
     static Cutelyst::Pagination list(Cutelyst::Context *c, SkaffariError &e, const Domain &d, const Cutelyst::Pagination &p, const QString &sortBy = QStringLiteral("username"), const QString &sortOrder = QStringLiteral("ASC"), const QString &searchRole = QStringLiteral("username"), const QString &searchString = QString());
 
+    /*!
+     * \brief Lists all accounts belonging to the domain \a d as compact list rows.
+     *
+     * Works like list() but appends the accounts to \a rows instead of inserting a list of
+     * %Account objects into the returned pagination. Use this if the list is only serialized
+     * with AccountListRow::writeJsonArray().
+     */
+    static Cutelyst::Pagination listRows(Cutelyst::Context *c, SkaffariError &e, const Domain &d, const Cutelyst::Pagination &p, std::vector<AccountListRow> &rows, const QString &sortBy = QStringLiteral("username"), const QString &sortOrder = QStringLiteral("ASC"), const QString &searchRole = QStringLiteral("username"), const QString &searchString = QString());
+
     /*!
      * \brief Gets the account defined by database ID \a id from the database.
      *
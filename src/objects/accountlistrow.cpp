@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "accountlistrow.h"
+
+namespace {
+
+void appendJsonString(QByteArray &out, const QString &str)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    out.append('"');
+    const QByteArray utf8 = str.toUtf8();
+    for (const char ch : utf8) {
+        const auto uch = static_cast<uchar>(ch);
+        switch (uch) {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\b':
+            out.append("\\b");
+            break;
+        case '\f':
+            out.append("\\f");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            if (uch < 0x20) {
+                out.append("\\u00");
+                out.append(hexDigits[uch >> 4]);
+                out.append(hexDigits[uch & 0xf]);
+            } else {
+                out.append(ch);
+            }
+            break;
+        }
+    }
+    out.append('"');
+}
+
+void appendJsonStringList(QByteArray &out, const QStringList &list)
+{
+    out.append('[');
+    for (int i = 0; i < list.size(); ++i) {
+        if (i > 0) {
+            out.append(',');
+        }
+        appendJsonString(out, list.at(i));
+    }
+    out.append(']');
+}
+
+void appendJsonBool(QByteArray &out, bool value)
+{
+    if (value) {
+        out.append("true");
+    } else {
+        out.append("false");
+    }
+}
+
+void appendJsonDateTime(QByteArray &out, const QDateTime &dt)
+{
+    out.append('"');
+    out.append(dt.toString(Qt::ISODate).toLatin1());
+    out.append('"');
+}
+
+}
+
+void AccountListRow::writeJson(QByteArray &out, dbid_t domainId, const QDateTime &now) const
+{
+    out.append("{\"id\":");
+    out.append(QByteArray::number(id));
+    out.append(",\"domainId\":");
+    out.append(QByteArray::number(domainId));
+    out.append(",\"username\":");
+    appendJsonString(out, username);
+    out.append(",\"imap\":");
+    appendJsonBool(out, testFlag(Imap));
+    out.append(",\"pop\":");
+    appendJsonBool(out, testFlag(Pop));
+    out.append(",\"sieve\":");
+    appendJsonBool(out, testFlag(Sieve));
+    out.append(",\"smtpauth\":");
+    appendJsonBool(out, testFlag(SmtpAuth));
+    out.append(",\"addresses\":");
+    appendJsonStringList(out, addresses);
+    out.append(",\"forwards\":");
+    appendJsonStringList(out, forwards);
+    out.append(",\"quota\":");
+    out.append(QByteArray::number(quota));
+    out.append(",\"usage\":");
+    out.append(QByteArray::number(usage));
+    out.append(",\"created\":");
+    appendJsonDateTime(out, created);
+    out.append(",\"updated\":");
+    appendJsonDateTime(out, updated);
+    out.append(",\"validUntil\":");
+    appendJsonDateTime(out, validUntil);
+    out.append(",\"passwordExpires\":");
+    appendJsonDateTime(out, passwordExpires);
+    out.append(",\"passwordExpired\":");
+    appendJsonBool(out, passwordExpires < now);
+    out.append(",\"keepLocal\":");
+    appendJsonBool(out, testFlag(KeepLocal));
+    out.append(",\"catchAll\":");
+    appendJsonBool(out, testFlag(CatchAll));
+    out.append(",\"expired\":");
+    appendJsonBool(out, validUntil < now);
+    out.append(",\"status\":");
+    out.append(QByteArray::number(status));
+    out.append('}');
+}
+
+void AccountListRow::writeJsonArray(QByteArray &out, const std::vector<AccountListRow> &rows, dbid_t domainId)
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+
+    out.append('[');
+    bool first = true;
+    for (const AccountListRow &row : rows) {
+        if (!first) {
+            out.append(',');
+        }
+        first = false;
+        row.writeJson(out, domainId, now);
+    }
+    out.append(']');
+}
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_ACCOUNTLISTROW_H
+#define SKAFFARI_ACCOUNTLISTROW_H
+
+#include "../../common/global.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+/*!
+ * \ingroup skaffariobjects
+ * \brief Compact account data for one row of the account list of a domain.
+ *
+ * Unlike Account this is not implicitly shared and packs the boolean values
+ * into a single flags byte. Rows can be written as JSON directly into a byte
+ * array, without building QJsonObject and QJsonArray instances first. The
+ * output uses the same keys and values as Account::toJson().
+ */
+struct AccountListRow
+{
+    enum Flag : quint8 {
+        Imap        = 0x01,
+        Pop         = 0x02,
+        Sieve       = 0x04,
+        SmtpAuth    = 0x08,
+        KeepLocal   = 0x10,
+        CatchAll    = 0x20
+    };
+
+    QStringList addresses;
+    QStringList forwards;
+    QString username;
+    QDateTime created;
+    QDateTime updated;
+    QDateTime validUntil;
+    QDateTime passwordExpires;
+    quota_size_t quota = 0;
+    quota_size_t usage = 0;
+    dbid_t id = 0;
+    quint8 flags = 0;
+    quint8 status = 0;
+
+    /*!
+     * \brief Returns \c true if \a flag is set.
+     */
+    bool testFlag(Flag flag) const { return (flags & flag) != 0; }
+
+    /*!
+     * \brief Sets \a flag to \a on.
+     */
+    void setFlag(Flag flag, bool on) { flags = static_cast<quint8>(on ? (flags | flag) : (flags & ~flag)); }
+
+    /*!
+     * \brief Appends this row as JSON object to \a out.
+     *
+     * \a domainId is the database ID of the domain the account belongs to, \a now
+     * is used to determine if the account or its password expired.
+     */
+    void writeJson(QByteArray &out, dbid_t domainId, const QDateTime &now) const;
+
+    /*!
+     * \brief Appends \a rows as JSON array to \a out.
+     */
+    static void writeJsonArray(QByteArray &out, const std::vector<AccountListRow> &rows, dbid_t domainId);
+};
+
+#endif // SKAFFARI_ACCOUNTLISTROW_H
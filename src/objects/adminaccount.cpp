@@ -18,6 +18,7 @@
 
 #include "adminaccount_p.h"
 #include "skaffarierror.h"
+#include "../utils/listversion.h"
 #include "../utils/utils.h"
 #include "../utils/skaffariconfig.h"
 #include <Cutelyst/Context>
@@ -377,6 +378,8 @@ AdminAccount AdminAccount::create(Cutelyst::Context *c, const QVariantHash &para
 
     aa = AdminAccount(id, username, type, domIds, SkaffariConfig::defTimezone(), SkaffariConfig::defLanguage(), QStringLiteral("default"), SkaffariConfig::defMaxdisplay(), SkaffariConfig::defWarnlevel(), currentUtc, currentUtc);
 
+    ListVersion::domainsChanged();
+
     qCInfo(SK_ADMIN, "%s created new admin acccount %s of type %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(aa.nameIdString()), AdminAccount::staticMetaObject.enumerator(AdminAccount::staticMetaObject.indexOfEnumerator("AdminAccountType")).valueToKey(type));
     qCDebug(SK_ADMIN) << aa;
 
@@ -638,6 +641,8 @@ bool AdminAccount::update(Cutelyst::Context *c, SkaffariError &e, const QVariant
 
     ret = true;
 
+    ListVersion::domainsChanged();
+
     qCInfo(SK_ADMIN, "%s updated admin account %s of type %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(nameIdString()), AdminAccount::staticMetaObject.enumerator(AdminAccount::staticMetaObject.indexOfEnumerator("AdminAccountType")).valueToKey(type));
     qCDebug(SK_ADMIN) << *this;
 
@@ -797,6 +802,9 @@ bool AdminAccount::updateOwn(Cutelyst::Context *c, SkaffariError &e, const QVari
 
     ret = true;
 
+    // lists are rendered with the language, time zone and warn level of the admin
+    ListVersion::domainsChanged();
+
     qCInfo(SK_ADMIN, "%s updated his/her own account.", qUtf8Printable(AdminAccount::getUserNameIdString(c)));
     qCDebug(SK_ADMIN) << *this;
 
@@ -850,6 +858,8 @@ bool AdminAccount::remove(Cutelyst::Context *c, SkaffariError &e)
     }
 
     ret = true;
+    ListVersion::domainsChanged();
+
     qCInfo(SK_ADMIN, "%s removed admin %s of type %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(nameIdString()), AdminAccount::staticMetaObject.enumerator(AdminAccount::staticMetaObject.indexOfEnumerator("AdminAccountType")).valueToKey(d->type));
     qCDebug(SK_ADMIN) << *this;
 
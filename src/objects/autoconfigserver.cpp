@@ -19,6 +19,7 @@
 #include "autoconfigserver.h"
 #include "skaffarierror.h"
 #include "../utils/skaffariconfig.h"
+#include "../utils/autoconfigcache.h"
 #include <Cutelyst/Context>
 #include <Cutelyst/Plugins/Utils/Sql>
 #include <Cutelyst/Plugins/Memcached/Memcached>
@@ -314,6 +315,8 @@ AutoconfigServer AutoconfigServer::create(Cutelyst::Context *c, dbid_t domainId,
                          static_cast<AutoconfigServer::Authentication>(authentication),
                          sorting);
 
+    AutoconfigCache::invalidate();
+
     if (SkaffariConfig::useMemcached()) {
         const QString memKey = domainId ? QLatin1String(SK_AC_MEMC_AUTOCONFIG_PREFIX) + QString::number(domainId) : QStringLiteral(SK_AC_MEMC_AUTOCONFIG_GLOBAL);
         Cutelyst::Memcached::remove(memKey);
@@ -344,6 +347,8 @@ bool AutoconfigServer::remove(Cutelyst::Context *c, SkaffariError &e)
         return false;
     }
 
+    AutoconfigCache::invalidate();
+
     if (SkaffariConfig::useMemcached()) {
         const QString memKey = d->domainId ? QLatin1String(SK_AC_MEMC_AUTOCONFIG_PREFIX) + QString::number(d->domainId) : QStringLiteral(SK_AC_MEMC_AUTOCONFIG_GLOBAL);
         Cutelyst::Memcached::remove(memKey);
@@ -393,6 +398,8 @@ bool AutoconfigServer::update(Cutelyst::Context *c, const QVariantHash &p, Skaff
         return false;
     }
 
+    AutoconfigCache::invalidate();
+
     if (SkaffariConfig::useMemcached()) {
         const QString memKey = d->domainId ? QLatin1String(SK_AC_MEMC_AUTOCONFIG_PREFIX) + QString::number(d->domainId) : QStringLiteral(SK_AC_MEMC_AUTOCONFIG_GLOBAL);
         Cutelyst::Memcached::remove(memKey);
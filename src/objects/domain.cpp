@@ -23,6 +23,9 @@
 #include "objects/adminaccount.h"
 #include "utils/utils.h"
 #include "utils/skaffariconfig.h"
+#include "utils/autoconfigcache.h"
+#include "utils/listversion.h"
+#include "utils/collation.h"
 #include "../../common/global.h"
 #include <Cutelyst/ParamsMultiMap>
 #include <Cutelyst/Response>
@@ -558,6 +561,8 @@ Domain Domain::create(Cutelyst::Context *c, const QVariantHash &params, Skaffari
 
     dom = Domain(domainId, domainAceId, domainName, prefix, transport, quota, maxAccounts, domainQuota, 0, freeNames, freeAddress, 0, currentTimeUtc, currentTimeUtc, validUntil, autoconfig, parent, std::vector<SimpleDomain>(), std::vector<SimpleAdmin>(), foldersVect);
 
+    ListVersion::domainsChanged();
+
     qCInfo(SK_DOMAIN, "%s created new domain %s.", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(dom.nameIdString()));
     qCDebug(SK_DOMAIN) << dom;
 
@@ -759,8 +764,7 @@ std::vector<Domain> Domain::list(Cutelyst::Context *c, SkaffariError &errorData,
     }
 
     if ((orderBy == QLatin1String("domain_name")) && lst.size() > 1) {
-        DomainNameCollator dnc(c->locale());
-        std::sort(lst.begin(), lst.end(), dnc);
+        Collation::sort(lst, c->locale(), [](const Domain &d) { return d.name(); });
     }
 
     return lst;
@@ -946,6 +950,8 @@ bool Domain::remove(Cutelyst::Context *c, SkaffariError &error, dbid_t newParent
 
     ret = true;
 
+    ListVersion::domainsChanged();
+
     qCInfo(SK_DOMAIN, "%s removed domain %s", qUtf8Printable(AdminAccount::getUserNameIdString(c)), qUtf8Printable(nameIdString()));
     qCDebug(SK_DOMAIN) << *this;
 
@@ -1150,6 +1156,9 @@ bool Domain::update(Cutelyst::Context *c, const QVariantHash &p, SkaffariError &
         d->freeNames = freeNames;
         d->transport = transport;
         d->validUntil = validUntil;
+        if (d->autoconfig != autoconfig) {
+            AutoconfigCache::invalidate();
+        }
         d->autoconfig = autoconfig;
     }
 
@@ -1157,6 +1166,8 @@ bool Domain::update(Cutelyst::Context *c, const QVariantHash &p, SkaffariError &
     d->folders = foldersVect;
     d->updated = currentTimeUtc;
 
+    ListVersion::domainsChanged();
+
     qCInfo(SK_DOMAIN, "%s updated domain %s.", qUtf8Printable(admin.nameIdString()), qUtf8Printable(nameIdString()));
     qCDebug(SK_DOMAIN) << *this;
 
@@ -21,17 +21,6 @@
 
 #include "domain.h"
 #include <QSharedData>
-#include <QCollator>
-
-class DomainNameCollator : public QCollator
-{
-public:
-    explicit DomainNameCollator(const QLocale &locale) :
-        QCollator(locale)
-    {}
-
-    bool operator() (const Domain &left, const Domain &right) { return (compare(left.name(), right.name()) < 0); }
-};
 
 class DomainData : public QSharedData
 {
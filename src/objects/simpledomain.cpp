@@ -19,6 +19,7 @@
 #include "simpledomain.h"
 #include "skaffarierror.h"
 #include "adminaccount.h"
+#include "../utils/collation.h"
 #include <Cutelyst/Context>
 #include <Cutelyst/Plugins/Utils/Sql>
 #include <Cutelyst/Plugins/Authentication/authentication.h>
@@ -29,17 +30,6 @@
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QDebug>
-#include <QCollator>
-
-class SimpleDomainNameCollator : public QCollator
-{
-public:
-    explicit SimpleDomainNameCollator(const QLocale &locale) :
-        QCollator(locale)
-    {}
-
-    bool operator() (const SimpleDomain &left, const SimpleDomain &right) { return (compare(left.name(), right.name()) < 0); }
-};
 
 SimpleDomain::SimpleDomain(dbid_t id, const QString &name) :
     m_name {name}, m_id{id}
@@ -139,8 +129,7 @@ std::vector<SimpleDomain> SimpleDomain::list(Cutelyst::Context *c, SkaffariError
     }
 
     if (lst.size() > 1) {
-        SimpleDomainNameCollator sdnc(c->locale());
-        std::sort(lst.begin(), lst.end(), sdnc);
+        Collation::sort(lst, c->locale(), [](const SimpleDomain &d) { return d.name(); });
     }
 
     return lst;
@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "responsecompression.h"
+#include "staticassets.h"
+#include "../logging.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Context>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+
+#include <zlib.h>
+
+namespace {
+
+bool isCompressible(const QString &contentType)
+{
+    return contentType.startsWith(QLatin1String("text/"))
+            || contentType == QLatin1String("application/json")
+            || contentType == QLatin1String("application/javascript")
+            || contentType == QLatin1String("application/xml")
+            || contentType == QLatin1String("image/svg+xml")
+            || contentType.endsWith(QLatin1String("+xml"))
+            || contentType.endsWith(QLatin1String("+json"));
+}
+
+}
+
+ResponseCompression::ResponseCompression(Cutelyst::Application *parent)
+    : Cutelyst::Plugin(parent)
+{
+
+}
+
+void ResponseCompression::setLevel(int level)
+{
+    m_level = (level >= 1 && level <= 9) ? level : 6;
+}
+
+int ResponseCompression::level() const
+{
+    return m_level;
+}
+
+void ResponseCompression::setThreshold(int threshold)
+{
+    m_threshold = qMax(threshold, 0);
+}
+
+int ResponseCompression::threshold() const
+{
+    return m_threshold;
+}
+
+bool ResponseCompression::setup(Cutelyst::Application *app)
+{
+    connect(app, &Cutelyst::Application::afterDispatch, this, &ResponseCompression::afterDispatch);
+    return true;
+}
+
+QByteArray ResponseCompression::compress(const QByteArray &data, int level, bool gzip)
+{
+    QByteArray out;
+
+    z_stream stream{};
+    // window bits 15 + 16 selects the gzip wrapper
+    if (Q_UNLIKELY(deflateInit2(&stream, level, Z_DEFLATED, gzip ? 31 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)) {
+        return out;
+    }
+
+    out.resize(static_cast<int>(deflateBound(&stream, static_cast<uLong>(data.size()))));
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    const int ret = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+
+    if (Q_UNLIKELY(ret != Z_STREAM_END)) {
+        return QByteArray();
+    }
+
+    out.resize(static_cast<int>(stream.total_out));
+    return out;
+}
+
+void ResponseCompression::afterDispatch(Cutelyst::Context *c)
+{
+    Cutelyst::Response *res = c->res();
+
+    if (res->bodyDevice() || res->body().size() < m_threshold) {
+        return;
+    }
+
+    const quint16 status = res->status();
+    if (status == Cutelyst::Response::NoContent || status == Cutelyst::Response::NotModified) {
+        return;
+    }
+
+    Cutelyst::Headers &headers = res->headers();
+    if (!headers.header(QStringLiteral("Content-Encoding")).isEmpty() || !isCompressible(headers.contentType())) {
+        return;
+    }
+
+    const QString acceptEncoding = c->req()->header(QStringLiteral("Accept-Encoding"));
+    bool gzip = false;
+    QString coding;
+    if (StaticAssets::acceptsEncoding(acceptEncoding, QLatin1String("gzip"))) {
+        gzip = true;
+        coding = QStringLiteral("gzip");
+    } else if (StaticAssets::acceptsEncoding(acceptEncoding, QLatin1String("deflate"))) {
+        coding = QStringLiteral("deflate");
+    } else {
+        return;
+    }
+
+    const QByteArray compressed = compress(res->body(), m_level, gzip);
+    if (compressed.isEmpty() || compressed.size() >= res->body().size()) {
+        return;
+    }
+
+    qCDebug(SK_CORE, "Compressed response body with %s from %i to %i bytes.", qUtf8Printable(coding), res->body().size(), compressed.size());
+
+    res->setBody(compressed);
+    headers.setHeader(QStringLiteral("Content-Encoding"), coding);
+
+    const QString vary = headers.header(QStringLiteral("Vary"));
+    if (vary.isEmpty()) {
+        headers.setHeader(QStringLiteral("Vary"), QStringLiteral("Accept-Encoding"));
+    } else if (!vary.contains(QLatin1String("Accept-Encoding"), Qt::CaseInsensitive)) {
+        headers.setHeader(QStringLiteral("Vary"), vary + QLatin1String(", Accept-Encoding"));
+    }
+
+    // the compressed representation is not byte-identical anymore
+    const QString etag = headers.header(QStringLiteral("ETag"));
+    if (!etag.isEmpty() && !etag.startsWith(QLatin1String("W/"))) {
+        headers.setHeader(QStringLiteral("ETag"), QLatin1String("W/") + etag);
+    }
+}
+
+#include "moc_responsecompression.cpp"
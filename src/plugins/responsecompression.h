@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_RESPONSECOMPRESSION_H
+#define SKAFFARI_RESPONSECOMPRESSION_H
+
+#include <Cutelyst/Plugin>
+
+#include <QByteArray>
+
+namespace Cutelyst {
+class Context;
+}
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Compresses dynamic responses like rendered pages and JSON data.
+ *
+ * After dispatching, responses with a compressible content type, that are at least
+ * threshold() bytes big, are compressed with gzip or deflate if the client accepts
+ * one of them. Responses that already have a Content-Encoding or that use an IO
+ * device as body, like static files, are left untouched.
+ */
+class ResponseCompression : public Cutelyst::Plugin
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ResponseCompression)
+public:
+    /*!
+     * \brief Constructs a new %ResponseCompression plugin for \a parent.
+     */
+    explicit ResponseCompression(Cutelyst::Application *parent);
+
+    /*!
+     * \brief Sets the compression \a level between 1 and 9.
+     *
+     * Values out of range select the zlib default level 6.
+     */
+    void setLevel(int level);
+
+    /*!
+     * \brief Returns the compression level.
+     */
+    [[nodiscard]] int level() const;
+
+    /*!
+     * \brief Sets the minimum body size in bytes for compression.
+     */
+    void setThreshold(int threshold);
+
+    /*!
+     * \brief Returns the minimum body size in bytes for compression.
+     */
+    [[nodiscard]] int threshold() const;
+
+    /*!
+     * \brief Connects to the application to compress responses after dispatching.
+     */
+    bool setup(Cutelyst::Application *app) override;
+
+    /*!
+     * \brief Compresses \a data with the given \a level.
+     *
+     * If \a gzip is \c true, the data will be wrapped in the gzip format, otherwise
+     * in the zlib format used by HTTP deflate. Returns an empty byte array on error.
+     */
+    [[nodiscard]] static QByteArray compress(const QByteArray &data, int level, bool gzip);
+
+private:
+    void afterDispatch(Cutelyst::Context *c);
+
+    int m_level = 6;
+    int m_threshold = 1024;
+};
+
+#endif // SKAFFARI_RESPONSECOMPRESSION_H
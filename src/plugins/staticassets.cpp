@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "staticassets.h"
+#include "../logging.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Context>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMimeDatabase>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QWriteLocker>
+
+#define SK_STATIC_ASSETS_MANIFEST "assets.json"
+#define SK_STATIC_ASSETS_IMMUTABLE "public, max-age=31536000, immutable"
+
+namespace {
+
+struct AssetManifest
+{
+    QReadWriteLock lock;
+    QHash<QString,QString> hashed;
+    QSet<QString> immutable;
+};
+
+Q_GLOBAL_STATIC(AssetManifest, assetManifest)
+
+}
+
+StaticAssets::StaticAssets(Cutelyst::Application *parent)
+    : Cutelyst::Plugin(parent)
+{
+
+}
+
+void StaticAssets::setIncludePaths(const QStringList &paths)
+{
+    m_includePaths.clear();
+    m_includePaths.reserve(paths.size());
+
+    for (const QString &path : paths) {
+        const QString cleanPath = QDir::cleanPath(path);
+        m_includePaths.push_back(cleanPath);
+
+        QFile manifestFile(cleanPath + QLatin1String("/" SK_STATIC_ASSETS_MANIFEST));
+        if (!manifestFile.exists()) {
+            continue;
+        }
+
+        if (Q_UNLIKELY(!manifestFile.open(QIODevice::ReadOnly))) {
+            qCWarning(SK_CORE) << "Failed to open static assets manifest" << manifestFile.fileName();
+            continue;
+        }
+
+        QJsonParseError jpe;
+        const QJsonObject manifest = QJsonDocument::fromJson(manifestFile.readAll(), &jpe).object();
+        if (Q_UNLIKELY(jpe.error != QJsonParseError::NoError)) {
+            qCWarning(SK_CORE) << "Failed to parse static assets manifest" << manifestFile.fileName() << jpe.errorString();
+            continue;
+        }
+
+        QWriteLocker locker(&assetManifest->lock);
+        for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+            const QString hashedPath = it.value().toString();
+            if (hashedPath.isEmpty()) {
+                continue;
+            }
+            // the first include path wins, like for the files itself
+            if (!assetManifest->hashed.contains(it.key())) {
+                assetManifest->hashed.insert(it.key(), hashedPath);
+            }
+            assetManifest->immutable.insert(hashedPath);
+        }
+    }
+}
+
+bool StaticAssets::setup(Cutelyst::Application *app)
+{
+    connect(app, &Cutelyst::Application::beforePrepareAction, this, &StaticAssets::beforePrepareAction);
+    return true;
+}
+
+QString StaticAssets::assetPath(const QString &path)
+{
+    const QString key = path.startsWith(QLatin1Char('/')) ? path.mid(1) : path;
+
+    QReadLocker locker(&assetManifest->lock);
+    const auto it = assetManifest->hashed.constFind(key);
+    if (it == assetManifest->hashed.constEnd()) {
+        return path;
+    }
+    return QLatin1Char('/') + it.value();
+}
+
+bool StaticAssets::acceptsEncoding(const QString &acceptEncoding, QLatin1String coding)
+{
+    const QVector<QStringRef> parts = acceptEncoding.splitRef(QLatin1Char(','), QString::SkipEmptyParts);
+    for (const QStringRef &part : parts) {
+        const QVector<QStringRef> params = part.split(QLatin1Char(';'));
+        if (params.constFirst().trimmed().compare(coding, Qt::CaseInsensitive) != 0) {
+            continue;
+        }
+        for (int i = 1; i < params.size(); ++i) {
+            const QStringRef param = params.at(i).trimmed();
+            if (param.startsWith(QLatin1String("q="), Qt::CaseInsensitive)) {
+                return param.mid(2).toDouble() > 0.0;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void StaticAssets::beforePrepareAction(Cutelyst::Context *c, bool *skipMethod)
+{
+    if (*skipMethod) {
+        return;
+    }
+
+    QString relPath = c->req()->path();
+    while (relPath.startsWith(QLatin1Char('/'))) {
+        relPath.remove(0, 1);
+    }
+
+    // only paths with a file name extension can be static files
+    const int lastSlash = relPath.lastIndexOf(QLatin1Char('/'));
+    if (relPath.lastIndexOf(QLatin1Char('.')) <= lastSlash) {
+        return;
+    }
+
+    relPath = QDir::cleanPath(relPath);
+    if (Q_UNLIKELY(relPath.startsWith(QLatin1String("..")))) {
+        return;
+    }
+
+    for (const QString &includePath : qAsConst(m_includePaths)) {
+        const QString filePath = includePath + QLatin1Char('/') + relPath;
+        if (QFileInfo(filePath).isFile()) {
+            serve(c, filePath, relPath);
+            *skipMethod = true;
+            return;
+        }
+    }
+
+    qCDebug(SK_CORE) << "Can not find static file" << relPath;
+}
+
+void StaticAssets::serve(Cutelyst::Context *c, const QString &filePath, const QString &relPath)
+{
+    Cutelyst::Response *res = c->res();
+
+    bool immutable = false;
+    {
+        QReadLocker locker(&assetManifest->lock);
+        immutable = assetManifest->immutable.contains(relPath);
+    }
+
+    const QDateTime lastModified = QFileInfo(filePath).lastModified().toUTC();
+    res->headers().setLastModified(lastModified);
+    if (immutable) {
+        res->setHeader(QStringLiteral("Cache-Control"), QStringLiteral(SK_STATIC_ASSETS_IMMUTABLE));
+    }
+
+    const bool brExists = QFileInfo::exists(filePath + QLatin1String(".br"));
+    const bool gzExists = QFileInfo::exists(filePath + QLatin1String(".gz"));
+    if (brExists || gzExists) {
+        res->setHeader(QStringLiteral("Vary"), QStringLiteral("Accept-Encoding"));
+    }
+
+    const QDateTime ifModifiedSince = c->req()->headers().ifModifiedSinceDateTime();
+    if (ifModifiedSince.isValid() && lastModified <= ifModifiedSince) {
+        res->setStatus(Cutelyst::Response::NotModified);
+        return;
+    }
+
+    static const QMimeDatabase mimeDb;
+    const QMimeType mimeType = mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchExtension);
+    if (mimeType.isValid()) {
+        if (mimeType.inherits(QStringLiteral("text/plain"))) {
+            res->setContentType(mimeType.name() + QLatin1String("; charset=utf-8"));
+        } else {
+            res->setContentType(mimeType.name());
+        }
+    }
+
+    const QString acceptEncoding = c->req()->header(QStringLiteral("Accept-Encoding"));
+
+    auto file = new QFile;
+    if (brExists && acceptsEncoding(acceptEncoding, QLatin1String("br"))) {
+        file->setFileName(filePath + QLatin1String(".br"));
+        res->setHeader(QStringLiteral("Content-Encoding"), QStringLiteral("br"));
+    } else if (gzExists && acceptsEncoding(acceptEncoding, QLatin1String("gzip"))) {
+        file->setFileName(filePath + QLatin1String(".gz"));
+        res->setHeader(QStringLiteral("Content-Encoding"), QStringLiteral("gzip"));
+    } else {
+        file->setFileName(filePath);
+    }
+
+    if (Q_UNLIKELY(!file->open(QIODevice::ReadOnly))) {
+        qCWarning(SK_CORE) << "Failed to open static file" << file->fileName() << file->errorString();
+        delete file;
+        res->headers().removeHeader(QStringLiteral("Content-Encoding"));
+        res->setStatus(Cutelyst::Response::InternalServerError);
+        return;
+    }
+
+    // the response takes ownership of the file
+    res->setBody(file);
+}
+
+#include "moc_staticassets.cpp"
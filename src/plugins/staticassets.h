@@ -0,0 +1,72 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_STATICASSETS_H
+#define SKAFFARI_STATICASSETS_H
+
+#include <Cutelyst/Plugin>
+
+#include <QStringList>
+
+namespace Cutelyst {
+class Context;
+}
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Serves static template files with precompressed variants.
+ *
+ * Replacement for the StaticSimple plugin that serves files from the include
+ * paths. If the client accepts it and the build step created them, the \c .br
+ * or \c .gz variant of a file is sent instead of the file itself.
+ *
+ * The build step also creates copies of style sheets and scripts with the
+ * content hash in their names and writes them to an \c assets.json manifest
+ * in the root of the static directory. Templates get the hashed name via the
+ * \c sk_asset filter. As the content of such a file will never change, it is
+ * sent with an immutable Cache-Control header.
+ */
+class StaticAssets : public Cutelyst::Plugin
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StaticAssets)
+public:
+    /*!
+     * \brief Constructs a new %StaticAssets plugin for \a parent.
+     */
+    explicit StaticAssets(Cutelyst::Application *parent);
+
+    /*!
+     * \brief Sets the directories to search for static files and loads their manifests.
+     *
+     * Directories are searched in the order of the list.
+     */
+    void setIncludePaths(const QStringList &paths);
+
+    /*!
+     * \brief Connects to the application to serve static files before dispatching.
+     */
+    bool setup(Cutelyst::Application *app) override;
+
+    /*!
+     * \brief Returns the content hashed variant of \a path or \a path if there is none.
+     *
+     * \a path is the absolute URL path like \c /css/style.css
+     */
+    [[nodiscard]] static QString assetPath(const QString &path);
+
+    /*!
+     * \brief Returns \c true if \a acceptEncoding allows the content \a coding.
+     */
+    [[nodiscard]] static bool acceptsEncoding(const QString &acceptEncoding, QLatin1String coding);
+
+private:
+    void beforePrepareAction(Cutelyst::Context *c, bool *skipMethod);
+    void serve(Cutelyst::Context *c, const QString &filePath, const QString &relPath);
+
+    QStringList m_includePaths;
+};
+
+#endif // SKAFFARI_STATICASSETS_H
@@ -24,6 +24,7 @@
 #include "objects/adminaccount.h"
 #include "utils/skaffariconfig.h"
 #include "utils/utils.h"
+#include "imap/imapmetrics.h"
 #include "../common/config.h"
 #include "../common/global.h"
 
@@ -34,6 +35,7 @@
 #include <Cutelyst/Plugins/Memcached/Memcached>
 #include <Cutelyst/Application>
 
+#include <QCoreApplication>
 #include <QLocale>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -253,6 +255,43 @@ void Root::about(Context *c)
              });
 }
 
+void Root::metrics(Context *c)
+{
+    Response *res = c->res();
+    res->setHeader(QStringLiteral("Cache-Control"), QStringLiteral("no-store"));
+
+    const QByteArray token = SkaffariConfig::metricsToken().toUtf8();
+    if (token.isEmpty()) {
+        res->setStatus(Response::NotFound);
+        res->setContentType(QStringLiteral("text/plain; charset=utf-8"));
+        res->setBody(QByteArrayLiteral("Not found\n"));
+        return;
+    }
+
+    // scrapers can not log in, they have to send the configured token instead
+    const QByteArray auth = c->req()->header(QStringLiteral("Authorization")).toUtf8();
+    const QByteArray prefix = QByteArrayLiteral("Bearer ");
+    const QByteArray sent = auth.startsWith(prefix) ? auth.mid(prefix.size()).trimmed() : QByteArray();
+
+    // compare in constant time to not leak the token length or matching prefixes
+    int diff = sent.size() ^ token.size();
+    for (int i = 0; i < token.size(); ++i) {
+        diff |= static_cast<uchar>(token.at(i)) ^ static_cast<uchar>(i < sent.size() ? sent.at(i) : 0);
+    }
+
+    if (diff != 0) {
+        res->setStatus(Response::Unauthorized);
+        res->setHeader(QStringLiteral("WWW-Authenticate"), QStringLiteral("Bearer realm=\"Skaffari metrics\""));
+        res->setContentType(QStringLiteral("text/plain; charset=utf-8"));
+        res->setBody(QByteArrayLiteral("Unauthorized\n"));
+        return;
+    }
+
+    // every worker process has its own counters, the pid label keeps them apart
+    res->setContentType(QStringLiteral("text/plain; version=0.0.4; charset=utf-8"));
+    res->setBody(ImapMetrics::global().toPrometheus(QByteArrayLiteral("pid=\"") + QByteArray::number(QCoreApplication::applicationPid()) + '"'));
+}
+
 void Root::defaultPage(Context *c)
 {
     c->res()->setStatus(404);
@@ -325,6 +364,11 @@ bool Root::Auto(Context* c)
         return true;
     }
 
+    // the metrics endpoint is protected by its own token
+    if (c->controllerName() == QLatin1String("Root") && c->actionName() == QLatin1String("metrics")) {
+        return true;
+    }
+
     const AuthenticationUser user = Authentication::user(c);
 
     if (Q_UNLIKELY(user.isNull())) {
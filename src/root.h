@@ -43,6 +43,17 @@ public:
     C_ATTR(about, :Global :Args(0))
     void about(Context *c);
 
+    /*!
+     * \brief Returns IMAP command metrics in the Prometheus text format.
+     *
+     * Clients have to send the token configured by SkaffariConfig::metricsToken() as bearer token
+     * in the \c Authorization header, the endpoint is disabled if no token is configured. The
+     * counters are kept per worker process and labeled with the process ID, a single request only
+     * returns the counters of the process that handled it.
+     */
+    C_ATTR(metrics, :Global :Args(0))
+    void metrics(Context *c);
+
     C_ATTR(defaultPage, :Path)
     void defaultPage(Context *c);
 
@@ -19,7 +19,6 @@
 #include "skaffari.h"
 
 #include <Cutelyst/Application>
-#include <Cutelyst/Plugins/StaticSimple/StaticSimple>
 #include <Cutelyst/Plugins/View/Cutelee/cuteleeview.h>
 #include <Cutelyst/Plugins/Session/Session>
 #include <Cutelyst/Plugins/Authentication/authentication.h>
@@ -34,14 +33,18 @@
 #include <Cutelyst/Plugins/Utils/LangSelect>
 
 #include <cutelee/engine.h>
+#include <cutelee/cachingloaderdecorator.h>
 
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QDir>
+#include <QDirIterator>
+#include <QFileSystemWatcher>
 #include <QMetaType>
 #include <QCoreApplication>
 #include <QTranslator>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QLoggingCategory>
@@ -61,6 +64,9 @@ extern "C"
 
 #include "objects/helpentry.h"
 #include "objects/skaffarierror.h"
+#include "imap/quotaeventlistener.h"
+#include "plugins/staticassets.h"
+#include "plugins/responsecompression.h"
 
 #include "utils/skaffariconfig.h"
 #include "utils/qtimezonevariant_p.h"
@@ -259,13 +265,17 @@ bool Skaffari::init()
     auto view = new CuteleeView(this);
     view->setTemplateExtension(QStringLiteral(".html"));
     view->setWrapper(QStringLiteral("wrapper.html"));
-    view->setCache(false);
+    // setCache() recreates the Cutelee engine, so it has to be called before adding libraries
+    view->setCache(generalConfig.value(QStringLiteral("templatecache"), true).toBool());
     view->setIncludePaths({sitePath});
     view->engine()->addDefaultLibrary(QStringLiteral("cutelee_i18ntags"));
     view->engine()->insertDefaultLibrary(QStringLiteral("cutelee_skaffari"), new SkaffariCutelee(view->engine()));
 
     view->loadTranslationsFromDir(tmplName, SkaffariConfig::tmplPath(QStringLiteral("l10n")), QStringLiteral("_"));
 
+    m_view = view;
+    m_tmplWatch = view->isCaching() && generalConfig.value(QStringLiteral("templatewatch"), false).toBool();
+
     qCDebug(SK_CORE) << "Registering Controllers.";
     new Root(this);
     new Login(this);
@@ -280,9 +290,15 @@ bool Skaffari::init()
 
     qCDebug(SK_CORE) << "Registering plugins.";
 
-    auto staticSimple = new StaticSimple(this);
+    auto staticAssets = new StaticAssets(this);
     const QString staticPath = SkaffariConfig::tmplPath(QStringLiteral("static"));
-    staticSimple->setIncludePaths({staticPath, QStringLiteral(SKAFFARI_STATICDIR)});
+    staticAssets->setIncludePaths({staticPath, QStringLiteral(SKAFFARI_STATICDIR)});
+
+    if (generalConfig.value(QStringLiteral("compression"), true).toBool()) {
+        auto compression = new ResponseCompression(this);
+        compression->setLevel(generalConfig.value(QStringLiteral("compressionlevel"), 6).toInt());
+        compression->setThreshold(generalConfig.value(QStringLiteral("compressionthreshold"), 1024).toInt());
+    }
 
     if (SkaffariConfig::useMemcached()) {
         auto memc = new Memcached(this);
@@ -329,7 +345,67 @@ bool Skaffari::postFork()
 {
     QMutexLocker locker(&mutex);
 
-    return initDb();
+    if (!initDb()) {
+        return false;
+    }
+
+    // only one application instance per process tries to bind the event socket
+    static bool eventListenerStarted = false;
+    if (!eventListenerStarted) {
+        eventListenerStarted = true;
+        const QString eventSocket = SkaffariConfig::imapEventSocket();
+        if (!eventSocket.isEmpty()) {
+            auto listener = new QuotaEventListener(this);
+            if (!listener->listen(eventSocket)) {
+                delete listener;
+            }
+        }
+    }
+
+    if (m_view->isCaching()) {
+        m_view->preloadTemplates();
+        if (m_tmplWatch) {
+            watchTemplates();
+        }
+    }
+
+    return true;
+}
+
+void Skaffari::watchTemplates()
+{
+    const QString sitePath = SkaffariConfig::tmplPath(QStringLiteral("site"));
+
+    QStringList paths{sitePath};
+    QDirIterator it(sitePath, QDir::Dirs|QDir::Files|QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        paths << it.next();
+    }
+
+    auto watcher = new QFileSystemWatcher(this);
+    const QStringList failed = watcher->addPaths(paths);
+    if (!failed.empty()) {
+        qCWarning(SK_CORE) << "Failed to watch template files:" << failed;
+    }
+
+    auto invalidate = [this, watcher](const QString &path) {
+        qCInfo(SK_CORE, "Template path %s changed, clearing template cache.", qUtf8Printable(path));
+        const auto loaders = m_view->engine()->templateLoaders();
+        for (const auto &loader : loaders) {
+            if (auto cache = loader.dynamicCast<Cutelee::CachingLoaderDecorator>()) {
+                cache->clear();
+            }
+        }
+        // editors often replace files instead of writing to them, what removes them from the watcher
+        if (QFileInfo::exists(path) && !watcher->files().contains(path) && !watcher->directories().contains(path)) {
+            watcher->addPath(path);
+        }
+    };
+
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, invalidate);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, invalidate);
+
+    qCDebug(SK_CORE, "Watching %i template paths for changes.", paths.size());
 }
 
 bool Skaffari::initDb() const
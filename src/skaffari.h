@@ -23,6 +23,10 @@
 
 #include "logging.h"
 
+namespace Cutelyst {
+class CuteleeView;
+}
+
 using namespace Cutelyst;
 
 /*!
@@ -75,12 +79,16 @@ public:
     /*!
      * \brief This will be called after the engine forked and will setup the database connection.
      *
-     * Returns always \c true.
+     * If template caching is enabled, this will also precompile all templates of the
+     * active template set.
      */
     bool postFork() override;
 
 private:
     bool initDb() const;
+    void watchTemplates();
+    CuteleeView *m_view = nullptr;
+    bool m_tmplWatch = false;
     static bool isInitialized;
     static bool messageHandlerInstalled;
 };
@@ -0,0 +1,171 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "aliasfilter.h"
+#include "bloomfilter.h"
+#include "skaffariconfig.h"
+#include "../logging.h"
+
+#include <Cutelyst/Plugins/Memcached/Memcached>
+#include <Cutelyst/Plugins/Utils/Sql>
+
+#include <QCache>
+#include <QDateTime>
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QWriteLocker>
+
+#include <memory>
+
+#define SK_ALIAS_FILTER_REBUILD_INTERVAL 300000
+#define SK_ALIAS_FILTER_MISS_TTL 300000
+#define SK_ALIAS_FILTER_MAX_MISSES 1024
+#define SK_ALIAS_FILTER_MEMC_GENERATION_KEY "alias_filter_generation"
+
+namespace {
+
+struct AliasFilterData
+{
+    QReadWriteLock lock;
+    std::unique_ptr<BloomFilter> filter;
+    qint64 builtAt = 0;
+    quint64 generation = 0;
+    QMutex rebuildMutex;
+    QMutex missMutex;
+    QCache<QString,qint64> misses{SK_ALIAS_FILTER_MAX_MISSES};
+};
+
+Q_GLOBAL_STATIC(AliasFilterData, aliasFilterData)
+
+// email addresses are compared case insensitive by the database
+QString filterKey(const QString &alias)
+{
+    return alias.toCaseFolded();
+}
+
+quint64 sharedGeneration()
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return 0;
+    }
+    return Cutelyst::Memcached::get(QStringLiteral(SK_ALIAS_FILTER_MEMC_GENERATION_KEY)).toULongLong();
+}
+
+void rebuild(quint64 generation)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QSqlQuery q = CPreparedSqlQueryThread(QStringLiteral("SELECT alias FROM virtual WHERE username <> ''"));
+    if (Q_UNLIKELY(!q.exec())) {
+        qCWarning(SK_CORE) << "Failed to query email addresses to build the alias filter:" << q.lastError().text();
+        // do not retry on every request
+        QWriteLocker locker(&aliasFilterData->lock);
+        aliasFilterData->builtAt = now;
+        return;
+    }
+
+    // leave some room for addresses added until the next rebuild
+    const int expected = q.size() > 0 ? q.size() + q.size() / 4 : 1024;
+    auto filter = std::make_unique<BloomFilter>(expected);
+    int count = 0;
+    while (q.next()) {
+        filter->add(filterKey(q.value(0).toString()));
+        ++count;
+    }
+
+    {
+        QWriteLocker locker(&aliasFilterData->lock);
+        aliasFilterData->filter = std::move(filter);
+        aliasFilterData->builtAt = now;
+        aliasFilterData->generation = generation;
+    }
+
+    {
+        QMutexLocker locker(&aliasFilterData->missMutex);
+        aliasFilterData->misses.clear();
+    }
+
+    qCDebug(SK_CORE) << "Built alias filter with" << count << "email addresses";
+}
+
+void ensureCurrent()
+{
+    const quint64 generation = sharedGeneration();
+
+    {
+        QReadLocker locker(&aliasFilterData->lock);
+        if (aliasFilterData->builtAt + SK_ALIAS_FILTER_REBUILD_INTERVAL > QDateTime::currentMSecsSinceEpoch() && aliasFilterData->generation == generation) {
+            return;
+        }
+    }
+
+    // if another thread is already rebuilding, use the current filter
+    if (!aliasFilterData->rebuildMutex.tryLock()) {
+        return;
+    }
+    rebuild(generation);
+    aliasFilterData->rebuildMutex.unlock();
+}
+
+}
+
+bool AliasFilter::mightExist(const QString &alias)
+{
+    const QString key = filterKey(alias);
+
+    ensureCurrent();
+
+    {
+        QReadLocker locker(&aliasFilterData->lock);
+        if (!aliasFilterData->filter) {
+            return true;
+        }
+        if (!aliasFilterData->filter->contains(key)) {
+            return false;
+        }
+    }
+
+    QMutexLocker locker(&aliasFilterData->missMutex);
+    if (const qint64 *expires = aliasFilterData->misses.object(key)) {
+        if (*expires > QDateTime::currentMSecsSinceEpoch()) {
+            return false;
+        }
+        aliasFilterData->misses.remove(key);
+    }
+
+    return true;
+}
+
+void AliasFilter::addMiss(const QString &alias)
+{
+    QMutexLocker locker(&aliasFilterData->missMutex);
+    aliasFilterData->misses.insert(filterKey(alias), new qint64(QDateTime::currentMSecsSinceEpoch() + SK_ALIAS_FILTER_MISS_TTL));
+}
+
+void AliasFilter::add(const QString &alias)
+{
+    const QString key = filterKey(alias);
+
+    {
+        QWriteLocker locker(&aliasFilterData->lock);
+        if (aliasFilterData->filter) {
+            aliasFilterData->filter->add(key);
+        }
+    }
+
+    {
+        QMutexLocker locker(&aliasFilterData->missMutex);
+        aliasFilterData->misses.remove(key);
+    }
+
+    if (SkaffariConfig::useMemcached()) {
+        Cutelyst::Memcached::incrementWithInitial(QStringLiteral(SK_ALIAS_FILTER_MEMC_GENERATION_KEY), 1, 1, 0);
+    }
+}
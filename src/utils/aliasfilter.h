@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_ALIASFILTER_H
+#define SKAFFARI_ALIASFILTER_H
+
+#include <QString>
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Negative lookup cache for the email addresses of user accounts.
+ *
+ * Used by the public autoconfig and autodiscover endpoints to reject unknown
+ * addresses without querying the database. It combines a BloomFilter of all
+ * addresses that belong to a user account, that is rebuilt from the database
+ * every 5 minutes, with a small list of recently missed addresses.
+ *
+ * Addresses added by this process are added to the filter immediately. If
+ * memcached is enabled, adding an address triggers a rebuild in all other
+ * processes, too. Without memcached, other processes will know new addresses
+ * after the next rebuild.
+ */
+class AliasFilter
+{
+public:
+    /*!
+     * \brief Returns \c false if \a alias does certainly not belong to a user account.
+     *
+     * Builds the filter on first use and rebuilds it if it is outdated. If the filter
+     * can not be built, this always returns \c true.
+     */
+    [[nodiscard]] static bool mightExist(const QString &alias);
+
+    /*!
+     * \brief Remembers that the database does not contain \a alias.
+     */
+    static void addMiss(const QString &alias);
+
+    /*!
+     * \brief Adds a new \a alias of a user account.
+     */
+    static void add(const QString &alias);
+};
+
+#endif // SKAFFARI_ALIASFILTER_H
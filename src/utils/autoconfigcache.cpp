@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "autoconfigcache.h"
+#include "skaffariconfig.h"
+#include "utils.h"
+
+#include <Cutelyst/Context>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+#include <Cutelyst/Plugins/Memcached/Memcached>
+
+#include <QCryptographicHash>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include <atomic>
+
+#define SK_AC_CACHE_MEMC_EPOCH_KEY "autoconfig_epoch"
+#define SK_AC_CACHE_MAX_AGE 900
+#define SK_AC_CACHE_MAX_ENTRIES 4096
+
+namespace {
+
+struct CachedEntry
+{
+    AutoconfigCache::Entry entry;
+    quint64 epoch = 0;
+};
+
+struct AutoconfigCacheData
+{
+    QReadWriteLock lock;
+    QHash<QString,CachedEntry> entries;
+    std::atomic<quint64> localEpoch{0};
+};
+
+Q_GLOBAL_STATIC(AutoconfigCacheData, autoconfigCacheData)
+
+quint64 currentEpoch()
+{
+    quint64 epoch = autoconfigCacheData->localEpoch.load();
+    if (SkaffariConfig::useMemcached()) {
+        epoch += Cutelyst::Memcached::get(QStringLiteral(SK_AC_CACHE_MEMC_EPOCH_KEY)).toULongLong();
+    }
+    return epoch;
+}
+
+}
+
+std::optional<AutoconfigCache::Entry> AutoconfigCache::value(const QString &key)
+{
+    const quint64 epoch = currentEpoch();
+
+    QReadLocker locker(&autoconfigCacheData->lock);
+    const auto it = autoconfigCacheData->entries.constFind(key);
+    if (it == autoconfigCacheData->entries.cend()) {
+        return std::nullopt;
+    }
+
+    if (it->epoch != epoch || it->entry.lastModified.secsTo(QDateTime::currentDateTimeUtc()) > SK_AC_CACHE_MAX_AGE) {
+        return std::nullopt;
+    }
+
+    return it->entry;
+}
+
+AutoconfigCache::Entry AutoconfigCache::insert(const QString &key, const QByteArray &body)
+{
+    CachedEntry cached;
+    cached.epoch = currentEpoch();
+    cached.entry.body = body;
+    cached.entry.etag = '"' + QCryptographicHash::hash(body, QCryptographicHash::Sha1).toHex() + '"';
+    // HTTP dates have a resolution of seconds
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    cached.entry.lastModified = now.addMSecs(-now.time().msec());
+
+    QWriteLocker locker(&autoconfigCacheData->lock);
+    if (autoconfigCacheData->entries.size() >= SK_AC_CACHE_MAX_ENTRIES) {
+        autoconfigCacheData->entries.clear();
+    }
+    autoconfigCacheData->entries.insert(key, cached);
+
+    return cached.entry;
+}
+
+void AutoconfigCache::invalidate()
+{
+    ++autoconfigCacheData->localEpoch;
+
+    if (SkaffariConfig::useMemcached()) {
+        Cutelyst::Memcached::incrementWithInitial(QStringLiteral(SK_AC_CACHE_MEMC_EPOCH_KEY), 1, 1, 0);
+    }
+
+    QWriteLocker locker(&autoconfigCacheData->lock);
+    autoconfigCacheData->entries.clear();
+}
+
+void AutoconfigCache::send(Cutelyst::Context *c, const Entry &entry, const QString &contentType)
+{
+    Cutelyst::Response *res = c->res();
+    res->setHeader(QStringLiteral("ETag"), QString::fromLatin1(entry.etag));
+    res->headers().setLastModified(entry.lastModified);
+    res->setHeader(QStringLiteral("Cache-Control"), QStringLiteral("no-cache"));
+
+    const QString ifNoneMatch = c->req()->header(QStringLiteral("If-None-Match"));
+    bool notModified = false;
+    if (!ifNoneMatch.isEmpty()) {
+        notModified = Utils::etagMatches(ifNoneMatch, entry.etag);
+    } else {
+        const QDateTime ifModifiedSince = c->req()->headers().ifModifiedSinceDateTime();
+        notModified = ifModifiedSince.isValid() && entry.lastModified <= ifModifiedSince;
+    }
+
+    if (notModified) {
+        res->setStatus(Cutelyst::Response::NotModified);
+        return;
+    }
+
+    res->setContentType(contentType);
+    res->setBody(entry.body);
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_AUTOCONFIGCACHE_H
+#define SKAFFARI_AUTOCONFIGCACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include <optional>
+
+namespace Cutelyst {
+class Context;
+}
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Process wide cache for rendered autoconfig and autodiscover responses.
+ *
+ * All entries are invalidated by invalidate(), that has to be called whenever data
+ * used by the responses changes: autoconfig servers, the autoconfig strategy of a
+ * domain or the global autoconfig settings. If memcached is enabled, the invalidation
+ * is shared with all other processes. Entries expire after 15 minutes anyway.
+ */
+class AutoconfigCache
+{
+public:
+    struct Entry {
+        QByteArray body;
+        QByteArray etag;
+        QDateTime lastModified;
+    };
+
+    /*!
+     * \brief Returns the valid cache entry for \a key, if any.
+     */
+    [[nodiscard]] static std::optional<Entry> value(const QString &key);
+
+    /*!
+     * \brief Stores the rendered \a body for \a key and returns the new entry.
+     */
+    static Entry insert(const QString &key, const QByteArray &body);
+
+    /*!
+     * \brief Invalidates all cached responses.
+     */
+    static void invalidate();
+
+    /*!
+     * \brief Sends \a entry as response with ETag and Last-Modified headers.
+     *
+     * If the request contains matching If-None-Match or If-Modified-Since headers,
+     * the response will have status 304 without body.
+     */
+    static void send(Cutelyst::Context *c, const Entry &entry, const QString &contentType);
+};
+
+#endif // SKAFFARI_AUTOCONFIGCACHE_H
@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "bloomfilter.h"
+
+namespace {
+
+/*
+ * FNV-1a over the UTF-16 code units, finalized with the splitmix64 mixer
+ * so that both halves can be used as independent hash values.
+ */
+quint64 hash64(const QString &str)
+{
+    quint64 h = Q_UINT64_C(14695981039346656037);
+    const ushort *data = str.utf16();
+    for (int i = 0; i < str.size(); ++i) {
+        h ^= data[i];
+        h *= Q_UINT64_C(1099511628211);
+    }
+    h ^= h >> 30;
+    h *= Q_UINT64_C(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= Q_UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+    return h;
+}
+
+}
+
+BloomFilter::BloomFilter(int expectedEntries)
+{
+    // about 9.6 bits per entry give 1% false positives with 7 hash functions
+    const uint bits = static_cast<uint>(qMax(expectedEntries, 64)) * 10;
+    m_bitCount = ((bits + 63) / 64) * 64;
+    m_bits.assign(m_bitCount / 64, 0);
+}
+
+void BloomFilter::add(const QString &str)
+{
+    // double hashing: h1 + i * h2 for i in [0, k)
+    const quint64 h = hash64(str);
+    const quint64 h1 = h & 0xffffffff;
+    const quint64 h2 = (h >> 32) | 1;
+    for (int i = 0; i < hashCount; ++i) {
+        const quint64 bit = (h1 + static_cast<quint64>(i) * h2) % m_bitCount;
+        m_bits[bit / 64] |= Q_UINT64_C(1) << (bit % 64);
+    }
+}
+
+bool BloomFilter::contains(const QString &str) const
+{
+    const quint64 h = hash64(str);
+    const quint64 h1 = h & 0xffffffff;
+    const quint64 h2 = (h >> 32) | 1;
+    for (int i = 0; i < hashCount; ++i) {
+        const quint64 bit = (h1 + static_cast<quint64>(i) * h2) % m_bitCount;
+        if ((m_bits[bit / 64] & (Q_UINT64_C(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int BloomFilter::bitCount() const
+{
+    return static_cast<int>(m_bitCount);
+}
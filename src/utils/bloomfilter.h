@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_BLOOMFILTER_H
+#define SKAFFARI_BLOOMFILTER_H
+
+#include <QString>
+
+#include <vector>
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Simple Bloom filter for strings.
+ *
+ * contains() never returns \c false for an added string, but can return
+ * \c true for strings that have not been added. The filter is sized for
+ * about 1% false positives at the expected number of entries.
+ */
+class BloomFilter
+{
+public:
+    /*!
+     * \brief Constructs an empty filter sized for \a expectedEntries strings.
+     */
+    explicit BloomFilter(int expectedEntries = 0);
+
+    void add(const QString &str);
+
+    [[nodiscard]] bool contains(const QString &str) const;
+
+    /*!
+     * \brief Returns the size of the filter in bits.
+     */
+    [[nodiscard]] int bitCount() const;
+
+private:
+    static constexpr int hashCount{7};
+
+    std::vector<quint64> m_bits;
+    uint m_bitCount{64};
+};
+
+#endif // SKAFFARI_BLOOMFILTER_H
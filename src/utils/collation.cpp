@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "collation.h"
+
+#include <QHash>
+
+const QCollator &Collation::collator(const QLocale &locale)
+{
+    // QCollator is not thread-safe, so every worker thread gets its own ones
+    thread_local QHash<QString,QCollator> collators;
+
+    const QString name = locale.bcp47Name();
+    auto it = collators.find(name);
+    if (it == collators.end()) {
+        it = collators.insert(name, QCollator(locale));
+    }
+    return it.value();
+}
+
+void Collation::sort(QStringList &list, const QLocale &locale)
+{
+    if (list.size() < 2) {
+        return;
+    }
+
+    const QCollator &col = collator(locale);
+
+    std::vector<std::pair<QCollatorSortKey,int>> keys;
+    keys.reserve(static_cast<std::size_t>(list.size()));
+    for (int i = 0; i < list.size(); ++i) {
+        keys.emplace_back(col.sortKey(list.at(i)), i);
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const std::pair<QCollatorSortKey,int> &left, const std::pair<QCollatorSortKey,int> &right) {
+        return left.first.compare(right.first) < 0;
+    });
+
+    QStringList sorted;
+    sorted.reserve(list.size());
+    for (const auto &k : keys) {
+        sorted.push_back(list.at(k.second));
+    }
+    list.swap(sorted);
+}
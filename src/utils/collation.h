@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_COLLATION_H
+#define SKAFFARI_COLLATION_H
+
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QLocale>
+#include <QStringList>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Locale aware sorting with precomputed sort keys.
+ *
+ * Comparing two strings with QCollator::compare() runs the full collation
+ * algorithm on every comparison. The sort functions of this class compute
+ * one QCollatorSortKey per element and sort by these keys, what only needs
+ * cheap byte comparisons. The collators are cached per thread and locale.
+ */
+class Collation
+{
+public:
+    /*!
+     * \brief Returns the collator for \a locale, cached for the current thread.
+     */
+    static const QCollator &collator(const QLocale &locale);
+
+    /*!
+     * \brief Sorts \a list in ascending order according to \a locale.
+     */
+    static void sort(QStringList &list, const QLocale &locale);
+
+    /*!
+     * \brief Sorts \a list in ascending order of the strings returned by \a key according to \a locale.
+     *
+     * \a key has to take a const reference to an element and has to return a QString.
+     */
+    template<typename T, typename KeyFunc>
+    static void sort(std::vector<T> &list, const QLocale &locale, KeyFunc key)
+    {
+        if (list.size() < 2) {
+            return;
+        }
+
+        const QCollator &col = collator(locale);
+
+        std::vector<std::pair<QCollatorSortKey,std::size_t>> keys;
+        keys.reserve(list.size());
+        for (std::size_t i = 0; i < list.size(); ++i) {
+            keys.emplace_back(col.sortKey(key(list[i])), i);
+        }
+
+        std::sort(keys.begin(), keys.end(), [](const std::pair<QCollatorSortKey,std::size_t> &left, const std::pair<QCollatorSortKey,std::size_t> &right) {
+            return left.first.compare(right.first) < 0;
+        });
+
+        std::vector<T> sorted;
+        sorted.reserve(list.size());
+        for (const auto &k : keys) {
+            sorted.push_back(std::move(list[k.second]));
+        }
+        list.swap(sorted);
+    }
+
+private:
+    // prevent construction
+    Collation();
+    ~Collation();
+};
+
+#endif // SKAFFARI_COLLATION_H
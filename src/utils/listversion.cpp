@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "listversion.h"
+#include "skaffariconfig.h"
+#include "utils.h"
+#include "../imap/quotacache.h"
+#include "../objects/adminaccount.h"
+
+#include <Cutelyst/Context>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+#include <Cutelyst/Plugins/Memcached/Memcached>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+
+#define SK_LIST_VERSION_ACCOUNTS_KEY "list_version_accounts"
+#define SK_LIST_VERSION_DOMAIN_KEY "list_version_domain_"
+#define SK_LIST_VERSION_DOMAINS_KEY "list_version_domains"
+#define SK_LIST_VERSION_QUOTA_KEY "list_version_quota"
+
+namespace {
+
+void increment(const QString &key)
+{
+    // start evicted or new counters at an unused value
+    Cutelyst::Memcached::incrementWithInitial(key, 1, static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()), 0);
+}
+
+bool counter(const QString &key, QCryptographicHash &hash)
+{
+    Cutelyst::Memcached::MemcachedReturnType rt;
+    const quint64 value = Cutelyst::Memcached::incrementWithInitial(key, 0, static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()), 0, &rt);
+    if (rt != Cutelyst::Memcached::Success) {
+        return false;
+    }
+    hash.addData(QByteArray::number(value));
+    hash.addData("\n", 1);
+    return true;
+}
+
+QByteArray finish(Cutelyst::Context *c, QCryptographicHash &hash, const QByteArray &params)
+{
+    // quota usage values expire in memcached and will then be queried again
+    hash.addData(QByteArray::number(QDateTime::currentSecsSinceEpoch() / MEMC_QUOTA_EXP));
+    hash.addData("\n", 1);
+    hash.addData(QByteArray::number(AdminAccount::getUserId(c)));
+    hash.addData("\n", 1);
+    hash.addData(c->locale().bcp47Name().toLatin1());
+    hash.addData("\n", 1);
+    hash.addData(params);
+    return '"' + hash.result().toHex().left(32) + '"';
+}
+
+}
+
+void ListVersion::accountsChanged(dbid_t domainId)
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return;
+    }
+    increment(QLatin1String(SK_LIST_VERSION_DOMAIN_KEY) + QString::number(domainId));
+    increment(QStringLiteral(SK_LIST_VERSION_ACCOUNTS_KEY));
+}
+
+void ListVersion::domainsChanged()
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return;
+    }
+    increment(QStringLiteral(SK_LIST_VERSION_DOMAINS_KEY));
+}
+
+void ListVersion::quotaChanged()
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return;
+    }
+    increment(QStringLiteral(SK_LIST_VERSION_QUOTA_KEY));
+}
+
+QByteArray ListVersion::accountsTag(Cutelyst::Context *c, dbid_t domainId, const QByteArray &params)
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayLiteral("accounts\n"));
+    hash.addData(QByteArray::number(domainId));
+    hash.addData("\n", 1);
+
+    const QString accountsKey = domainId > 0 ? QLatin1String(SK_LIST_VERSION_DOMAIN_KEY) + QString::number(domainId) : QStringLiteral(SK_LIST_VERSION_ACCOUNTS_KEY);
+    if (!counter(accountsKey, hash) || !counter(QStringLiteral(SK_LIST_VERSION_DOMAINS_KEY), hash) || !counter(QStringLiteral(SK_LIST_VERSION_QUOTA_KEY), hash)) {
+        return QByteArray();
+    }
+
+    return finish(c, hash, params);
+}
+
+QByteArray ListVersion::domainsTag(Cutelyst::Context *c, const QByteArray &params)
+{
+    if (!SkaffariConfig::useMemcached()) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayLiteral("domains\n"));
+
+    // the domain list shows account counts and quota usage
+    if (!counter(QStringLiteral(SK_LIST_VERSION_DOMAINS_KEY), hash) || !counter(QStringLiteral(SK_LIST_VERSION_ACCOUNTS_KEY), hash) || !counter(QStringLiteral(SK_LIST_VERSION_QUOTA_KEY), hash)) {
+        return QByteArray();
+    }
+
+    return finish(c, hash, params);
+}
+
+bool ListVersion::notModified(Cutelyst::Context *c, const QByteArray &etag)
+{
+    if (etag.isEmpty()) {
+        return false;
+    }
+
+    Cutelyst::Response *res = c->res();
+    res->setHeader(QStringLiteral("ETag"), QString::fromLatin1(etag));
+    res->setHeader(QStringLiteral("Cache-Control"), QStringLiteral("private, no-cache"));
+
+    if (Utils::etagMatches(c->req()->header(QStringLiteral("If-None-Match")), etag)) {
+        res->setStatus(Cutelyst::Response::NotModified);
+        return true;
+    }
+
+    return false;
+}
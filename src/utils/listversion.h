@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef SKAFFARI_LISTVERSION_H
+#define SKAFFARI_LISTVERSION_H
+
+#include "../../common/global.h"
+
+#include <QByteArray>
+
+namespace Cutelyst {
+class Context;
+}
+
+/*!
+ * \ingroup skaffaricore
+ * \brief Change counters to answer conditional requests for account and domain lists.
+ *
+ * Every change to the accounts of a domain, to the domains or to the quota usage
+ * increments a counter stored in memcached. The ETags of the lists are built from
+ * these counters, so that a list has not to be queried again if nothing changed.
+ * As quota usage can change without Skaffari noticing it, the ETags also change
+ * after the expiration time of the cached quota usage values.
+ *
+ * The counters are only shared between processes through memcached. If memcached
+ * is not enabled, no ETags will be created.
+ */
+class ListVersion
+{
+public:
+    /*!
+     * \brief Marks the accounts of the domain identified by \a domainId as changed.
+     */
+    static void accountsChanged(dbid_t domainId);
+
+    /*!
+     * \brief Marks the domains or their assignment to administrators as changed.
+     */
+    static void domainsChanged();
+
+    /*!
+     * \brief Marks the quota usage of accounts as changed.
+     */
+    static void quotaChanged();
+
+    /*!
+     * \brief Returns the ETag for the account list of \a domainId.
+     *
+     * If \a domainId is \c 0, the tag is for the accounts of all domains. \a params
+     * has to contain all request parameters, that change the content of the list.
+     * Returns an empty byte array if no tag can be created.
+     */
+    [[nodiscard]] static QByteArray accountsTag(Cutelyst::Context *c, dbid_t domainId, const QByteArray &params = QByteArray());
+
+    /*!
+     * \brief Returns the ETag for the domain list.
+     *
+     * Returns an empty byte array if no tag can be created.
+     */
+    [[nodiscard]] static QByteArray domainsTag(Cutelyst::Context *c, const QByteArray &params = QByteArray());
+
+    /*!
+     * \brief Adds the \a etag to the response and returns \c true if the client already has it.
+     *
+     * If the If-None-Match request header matches \a etag, the response status will be
+     * set to 304 and the caller should not add a body. Does nothing and returns \c false
+     * if \a etag is empty.
+     */
+    static bool notModified(Cutelyst::Context *c, const QByteArray &etag);
+};
+
+#endif // SKAFFARI_LISTVERSION_H
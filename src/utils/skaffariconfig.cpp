@@ -19,6 +19,7 @@
 #include "skaffariconfig.h"
 
 #include "../common/config.h"
+#include "autoconfigcache.h"
 #include <Cutelyst/Plugins/Utils/Sql>
 #include <Cutelyst/Plugins/Memcached/Memcached>
 #include <QSqlQuery>
@@ -71,6 +72,13 @@ struct ConfigValues
     bool imapUnixhierarchysep = SK_DEF_IMAP_UNIXHIERARCHYSEP;
     bool imapDomainasprefix = SK_DEF_IMAP_DOMAINASPREFIX;
     bool imapFqun = SK_DEF_IMAP_FQUN;
+    bool imapCompress = SK_DEF_IMAP_COMPRESS;
+    quint32 imapMaxAdminSessions = SK_DEF_IMAP_MAXADMINSESSIONS;
+    int imapAdminQueueTimeout = SK_DEF_IMAP_ADMINQUEUETIMEOUT;
+    bool imapSharedAdminLimit = SK_DEF_IMAP_SHAREDADMINLIMIT;
+    quint32 imapBreakerThreshold = SK_DEF_IMAP_BREAKERTHRESHOLD;
+    quint32 imapBreakerCooldown = SK_DEF_IMAP_BREAKERCOOLDOWN;
+    QString imapEventSocket;
 
     QString tmpl = QStringLiteral("default");
     QString tmplBasePath = QStringLiteral(SKAFFARI_TMPLDIR) + QLatin1String("/default");
@@ -78,6 +86,8 @@ struct ConfigValues
 
     bool useMemcached = false;
     bool useMemcachedSession = false;
+
+    QString metricsToken;
 };
 Q_GLOBAL_STATIC(ConfigValues, cfg)
 
@@ -88,6 +98,7 @@ void SkaffariConfig::load(const QVariantMap &general, const QVariantMap &account
     cfg->tmpl = general.value(QStringLiteral("template"), QStringLiteral("default")).toString();
     cfg->useMemcached = general.value(QStringLiteral("usememcached"), false).toBool();
     cfg->useMemcachedSession = general.value(QStringLiteral("usememcachedsession"), false).toBool();
+    cfg->metricsToken = general.value(QStringLiteral("metricstoken")).toString();
 
     cfg->accPwMethod = static_cast<Password::Method>(accounts.value(QStringLiteral("pwmethod"), SK_DEF_ACC_PWMETHOD).value<quint8>());
     cfg->accPwAlgorithm = static_cast<Password::Algorithm>(accounts.value(QStringLiteral("pwalgorithm"), SK_DEF_ACC_PWALGORITHM).value<quint8>());
@@ -119,6 +130,13 @@ void SkaffariConfig::load(const QVariantMap &general, const QVariantMap &account
     cfg->imapUnixhierarchysep = imap.value(QStringLiteral("unixhierarchysep"), SK_DEF_IMAP_UNIXHIERARCHYSEP).toBool();
     cfg->imapDomainasprefix = imap.value(QStringLiteral("domainasprefix"), SK_DEF_IMAP_DOMAINASPREFIX).toBool();
     cfg->imapFqun = imap.value(QStringLiteral("fqun"), SK_DEF_IMAP_FQUN).toBool();
+    cfg->imapCompress = imap.value(QStringLiteral("compress"), SK_DEF_IMAP_COMPRESS).toBool();
+    cfg->imapMaxAdminSessions = imap.value(QStringLiteral("maxadminsessions"), SK_DEF_IMAP_MAXADMINSESSIONS).value<quint32>();
+    cfg->imapAdminQueueTimeout = imap.value(QStringLiteral("adminqueuetimeout"), SK_DEF_IMAP_ADMINQUEUETIMEOUT).toInt();
+    cfg->imapSharedAdminLimit = imap.value(QStringLiteral("sharedadminlimit"), SK_DEF_IMAP_SHAREDADMINLIMIT).toBool();
+    cfg->imapBreakerThreshold = imap.value(QStringLiteral("breakerthreshold"), SK_DEF_IMAP_BREAKERTHRESHOLD).value<quint32>();
+    cfg->imapBreakerCooldown = imap.value(QStringLiteral("breakercooldown"), SK_DEF_IMAP_BREAKERCOOLDOWN).value<quint32>();
+    cfg->imapEventSocket = imap.value(QStringLiteral("eventsocket")).toString();
     // cfg->imapAuthMech = static_cast<SkaffariIMAP::AuthMech>(imap.value(QStringLiteral("authmech"), SK_DEF_IMAP_AUTHMECH).value<quint8>());
 
     cfg->tmplAsyncAccountList = tmpl.value(QStringLiteral("asyncaccountlist"), SK_DEF_TMPL_ASYNCACCOUNTLIST).toBool();
@@ -184,12 +202,17 @@ QVariantHash SkaffariConfig::getDefaultsSettings()
 
 void SkaffariConfig::setAutoconfigSettings(const QVariantHash &options)
 {
-    QWriteLocker locker(&cfg->lock);
+    {
+        QWriteLocker locker(&cfg->lock);
+
+        setDbOption<bool>(QStringLiteral(SK_CONF_KEY_AUTOCONF_ENABLED), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_ENABLED)).toBool());
+        setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_ID), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_ID)).toString());
+        setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY)).toString());
+        setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY_SHORT), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY_SHORT)).toString());
+    }
 
-    setDbOption<bool>(QStringLiteral(SK_CONF_KEY_AUTOCONF_ENABLED), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_ENABLED)).toBool());
-    setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_ID), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_ID)).toString());
-    setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY)).toString());
-    setDbOption<QString>(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY_SHORT), options.value(QStringLiteral(SK_CONF_KEY_AUTOCONF_DISPLAY_SHORT)).toString());
+    // takes the config lock itself to check for memcached
+    AutoconfigCache::invalidate();
 }
 
 QVariantHash SkaffariConfig::getAutoconfigSettings()
@@ -221,6 +244,7 @@ QString SkaffariConfig::tmplPath(const QStringList &pathparts)
 void SkaffariConfig::setTmplBasePath(const QString &path) { QWriteLocker locker(&cfg->lock); cfg->tmplBasePath = path; }
 bool SkaffariConfig::useMemcached() { QReadLocker locker(&cfg->lock); return cfg->useMemcached; }
 bool SkaffariConfig::useMemcachedSession() { QReadLocker locker(&cfg->lock); return cfg->useMemcachedSession; }
+QString SkaffariConfig::metricsToken() { QReadLocker locker(&cfg->lock); return cfg->metricsToken; }
 
 Password::Method SkaffariConfig::accPwMethod() { QReadLocker locker(&cfg->lock); return cfg->accPwMethod; }
 Password::Algorithm SkaffariConfig::accPwAlgorithm() { QReadLocker locker(&cfg->lock); return cfg->accPwAlgorithm; }
@@ -317,6 +341,13 @@ Account::CreateMailbox SkaffariConfig::imapCreatemailbox() { QReadLocker locker(
 bool SkaffariConfig::imapUnixhierarchysep() { QReadLocker locker(&cfg->lock); return cfg->imapUnixhierarchysep; }
 bool SkaffariConfig::imapDomainasprefix() { QReadLocker locker(&cfg->lock); return cfg->imapDomainasprefix;}
 bool SkaffariConfig::imapFqun() { QReadLocker locker(&cfg->lock); return cfg->imapUnixhierarchysep && cfg->imapDomainasprefix && cfg->imapFqun; }
+bool SkaffariConfig::imapCompress() { QReadLocker locker(&cfg->lock); return cfg->imapCompress; }
+quint32 SkaffariConfig::imapMaxAdminSessions() { QReadLocker locker(&cfg->lock); return cfg->imapMaxAdminSessions; }
+int SkaffariConfig::imapAdminQueueTimeout() { QReadLocker locker(&cfg->lock); return cfg->imapAdminQueueTimeout; }
+bool SkaffariConfig::imapSharedAdminLimit() { QReadLocker locker(&cfg->lock); return cfg->imapSharedAdminLimit; }
+quint32 SkaffariConfig::imapBreakerThreshold() { QReadLocker locker(&cfg->lock); return cfg->imapBreakerThreshold; }
+quint32 SkaffariConfig::imapBreakerCooldown() { QReadLocker locker(&cfg->lock); return cfg->imapBreakerCooldown; }
+QString SkaffariConfig::imapEventSocket() { QReadLocker locker(&cfg->lock); return cfg->imapEventSocket; }
 // SkaffariIMAP::AuthMech SkaffariConfig::imapAuthmech() { QReadLocker locker(&cfg->lock); return cfg->imapAuthMech; }
 
 bool SkaffariConfig::autoconfigEnabled() { QReadLocker locker(&cfg->lock); return getDbOption<bool>(QStringLiteral(SK_CONF_KEY_AUTOCONF_ENABLED), false); }
@@ -464,6 +464,76 @@ public:
      */
     static bool imapFqun();
 
+    /*!
+     * \brief Use COMPRESS=DEFLATE for the connection to the IMAP server.
+     *
+     * If enabled and the IMAP server supports the COMPRESS=DEFLATE extension (RFC 4978),
+     * the data sent between Skaffari and the IMAP server will be compressed after the
+     * authentication. This can reduce the transfer volume of large mailbox listings on
+     * remote IMAP servers.
+     *
+     * \par Config file key
+     * IMAP/compress
+     */
+    static bool imapCompress();
+
+    /*!
+     * \brief Maximum number of concurrent sessions of the IMAP admin user.
+     *
+     * Additional sessions will wait for a free slot up to imapAdminQueueTimeout().
+     * \c 0 disables the limit.
+     *
+     * \par Config file key
+     * IMAP/maxadminsessions
+     */
+    static quint32 imapMaxAdminSessions();
+
+    /*!
+     * \brief Time in milliseconds to wait for a free IMAP admin session.
+     *
+     * \par Config file key
+     * IMAP/adminqueuetimeout
+     */
+    static int imapAdminQueueTimeout();
+
+    /*!
+     * \brief Apply imapMaxAdminSessions() to all processes instead of every single process.
+     *
+     * \par Config file key
+     * IMAP/sharedadminlimit
+     */
+    static bool imapSharedAdminLimit();
+
+    /*!
+     * \brief Number of consecutive IMAP timeouts after that connection attempts will be paused.
+     *
+     * \c 0 disables the circuit breaker.
+     *
+     * \par Config file key
+     * IMAP/breakerthreshold
+     */
+    static quint32 imapBreakerThreshold();
+
+    /*!
+     * \brief Time in seconds to pause IMAP connection attempts after imapBreakerThreshold() timeouts.
+     *
+     * \par Config file key
+     * IMAP/breakercooldown
+     */
+    static quint32 imapBreakerCooldown();
+
+    /*!
+     * \brief Path of the Unix socket on that Skaffari receives event notifications from Cyrus IMAP.
+     *
+     * If set, one Skaffari process binds to this socket and updates the cached storage quota usage
+     * from QuotaChange, QuotaExceeded, MailboxCreate and MailboxDelete events. An empty path
+     * disables the listener.
+     *
+     * \par Config file key
+     * IMAP/eventsocket
+     */
+    static QString imapEventSocket();
+
     /*!
      * \brief Authentication mechanism to use for the connection to the IMAP server.
      *
@@ -519,6 +589,16 @@ public:
      */
     static bool useMemcachedSession();
 
+    /*!
+     * \brief Returns the bearer token that has to be sent to access the metrics endpoint.
+     *
+     * An empty token disables the endpoint.
+     *
+     * \par Config file key
+     * Skaffari/metricstoken
+     */
+    static QString metricsToken();
+
     /*!
      * \brief Returns \c true if auto configuration support is enabled.
      *
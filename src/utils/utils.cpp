@@ -191,3 +191,27 @@ QDateTime Utils::dateTimeFromDateAndTime(Cutelyst::Context *c, const QVariantHas
 
     return dt;
 }
+
+bool Utils::etagMatches(const QString &ifNoneMatch, const QByteArray &etag)
+{
+    if (ifNoneMatch.isEmpty() || etag.isEmpty()) {
+        return false;
+    }
+
+    const QString tag = QString::fromLatin1(etag.startsWith("W/") ? etag.mid(2) : etag);
+    const QVector<QStringRef> tags = ifNoneMatch.splitRef(QLatin1Char(','));
+    for (const QStringRef &t : tags) {
+        QStringRef trimmed = t.trimmed();
+        if (trimmed == QLatin1String("*")) {
+            return true;
+        }
+        if (trimmed.startsWith(QLatin1String("W/"))) {
+            trimmed = trimmed.mid(2);
+        }
+        if (trimmed == tag) {
+            return true;
+        }
+    }
+
+    return false;
+}
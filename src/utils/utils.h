@@ -141,6 +141,13 @@ public:
      */
     static QDateTime dateTimeFromDateAndTime(Cutelyst::Context *c, const QVariantHash &params, const QString &dateTimeKey, const QString &dateKey, const QString &timeKey, const QDateTime &defaultDt);
 
+    /*!
+     * \brief Returns \c true if the If-None-Match header value \a ifNoneMatch matches \a etag.
+     *
+     * Uses the weak comparison, so <tt>W/"abc"</tt> matches <tt>"abc"</tt>.
+     */
+    static bool etagMatches(const QString &ifNoneMatch, const QByteArray &etag);
+
 private:
     // prevent construction
     Utils();
@@ -0,0 +1,82 @@
+# SPDX-FileCopyrightText: (C) 2024 Matthias Fehring <https://www.huessenbergnetz.de>
+# SPDX-License-Identifier: AGPL-3.0-or-later
+#
+# Copies the static files from SOURCE_DIR to DEST_DIR, creates content hashed
+# copies of style sheets and scripts listed in DEST_DIR/assets.json and
+# precompresses text based files with gzip and brotli, if available.
+#
+# cmake -DSOURCE_DIR=<dir> -DDEST_DIR=<dir> [-DGZIP_EXECUTABLE=<exe>] [-DBROTLI_EXECUTABLE=<exe>] -P staticassets.cmake
+
+if (NOT SOURCE_DIR OR NOT DEST_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and DEST_DIR have to be set.")
+endif ()
+
+file(REMOVE_RECURSE ${DEST_DIR})
+file(MAKE_DIRECTORY ${DEST_DIR})
+
+if (NOT IS_DIRECTORY ${SOURCE_DIR})
+    message(WARNING "Static files directory ${SOURCE_DIR} does not exist.")
+    return()
+endif ()
+
+set(_compress_extensions .css .js .svg .json .txt .ico .html .xml .map .ttf .eot .otf)
+set(_hash_extensions .css .js)
+
+function(precompress _file)
+    if (GZIP_EXECUTABLE)
+        execute_process(COMMAND ${GZIP_EXECUTABLE} -9 -n -c ${_file} OUTPUT_FILE ${_file}.gz RESULT_VARIABLE _result)
+        if (NOT _result EQUAL 0)
+            message(WARNING "Failed to compress ${_file} with gzip.")
+            file(REMOVE ${_file}.gz)
+        endif ()
+    endif ()
+    if (BROTLI_EXECUTABLE)
+        execute_process(COMMAND ${BROTLI_EXECUTABLE} -q 11 -f -o ${_file}.br ${_file} RESULT_VARIABLE _result)
+        if (NOT _result EQUAL 0)
+            message(WARNING "Failed to compress ${_file} with brotli.")
+            file(REMOVE ${_file}.br)
+        endif ()
+    endif ()
+endfunction()
+
+macro(process_file _file)
+    get_filename_component(_dir ${_file} DIRECTORY)
+    file(COPY ${SOURCE_DIR}/${_file} DESTINATION ${DEST_DIR}/${_dir})
+
+    get_filename_component(_ext ${_file} EXT)
+    string(REGEX MATCH "\\.[^.]+$" _ext "${_ext}")
+    string(TOLOWER "${_ext}" _ext)
+
+    list(FIND _compress_extensions "${_ext}" _compress)
+    if (_compress GREATER -1)
+        precompress(${DEST_DIR}/${_file})
+    endif ()
+
+    list(FIND _hash_extensions "${_ext}" _hash)
+    if (_hash GREATER -1)
+        file(SHA256 ${SOURCE_DIR}/${_file} _sha)
+        string(SUBSTRING ${_sha} 0 12 _sha)
+        string(REGEX REPLACE "\\${_ext}$" ".${_sha}${_ext}" _hashed_file ${_file})
+        configure_file(${SOURCE_DIR}/${_file} ${DEST_DIR}/${_hashed_file} COPYONLY)
+        if (_compress GREATER -1)
+            precompress(${DEST_DIR}/${_hashed_file})
+        endif ()
+        if (_manifest)
+            set(_manifest "${_manifest},\n")
+        endif ()
+        set(_manifest "${_manifest}    \"${_file}\": \"${_hashed_file}\"")
+    endif ()
+endmacro()
+
+file(GLOB_RECURSE _files RELATIVE ${SOURCE_DIR} ${SOURCE_DIR}/*)
+list(SORT _files)
+
+set(_manifest "")
+
+foreach (_file ${_files})
+    if (NOT _file STREQUAL "CMakeLists.txt" AND NOT _file MATCHES "\\.(gz|br)$")
+        process_file(${_file})
+    endif ()
+endforeach ()
+
+file(WRITE ${DEST_DIR}/assets.json "{\n${_manifest}\n}\n")
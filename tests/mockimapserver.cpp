@@ -0,0 +1,615 @@
+#include "mockimapserver.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+struct MockImapServer::Connection
+{
+    enum AuthState : int {
+        None,
+        PlainWaiting,
+        LoginUser,
+        LoginPassword
+    };
+
+    QByteArray buffer;
+    QByteArray authTag;
+    QByteArray authUser;
+    QList<std::pair<qint64,QByteArray>> queue;
+    QTimer *timer{nullptr};
+    AuthState authState{None};
+    bool authenticated{false};
+    bool closeAfterFlush{false};
+};
+
+MockImapServer::MockImapServer(QObject *parent)
+    : QTcpServer{parent}
+{
+    m_thread.setObjectName(QStringLiteral("MockImapServer"));
+}
+
+MockImapServer::~MockImapServer()
+{
+    stop();
+}
+
+void MockImapServer::setCapabilities(const QByteArray &capabilities)
+{
+    m_capabilities = capabilities;
+}
+
+void MockImapServer::setServerName(const QByteArray &name)
+{
+    m_serverName = name;
+}
+
+void MockImapServer::setCredentials(const QByteArray &user, const QByteArray &password)
+{
+    m_user = user;
+    m_password = password;
+}
+
+void MockImapServer::setLatency(int msecs)
+{
+    m_latency = msecs;
+}
+
+void MockImapServer::setHandler(const QByteArray &verb, Handler handler)
+{
+    m_handlers.insert(verb.toUpper(), handler);
+}
+
+void MockImapServer::addMailbox(const QString &name, quint64 usage, quint64 limit)
+{
+    QMutexLocker locker(&m_mutex);
+    Mailbox mb;
+    mb.usage = usage;
+    mb.limit = limit;
+    mb.hasQuota = limit > 0;
+    m_mailboxes.insert(name, mb);
+}
+
+void MockImapServer::addMailboxes(int count, const QStringList &folders, quint64 limit)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 1; i <= count; ++i) {
+        const QString root = QLatin1String("user.") + syntheticUser(i);
+        Mailbox mb;
+        mb.usage = static_cast<quint64>(i % 1024) * 100;
+        mb.limit = limit;
+        mb.hasQuota = limit > 0;
+        m_mailboxes.insert(root, mb);
+        for (const QString &folder : folders) {
+            m_mailboxes.insert(root + QLatin1Char('.') + folder, Mailbox{});
+        }
+    }
+}
+
+QString MockImapServer::syntheticUser(int index)
+{
+    return QStringLiteral("test%1").arg(index, 6, 10, QLatin1Char('0'));
+}
+
+bool MockImapServer::hasMailbox(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_mailboxes.contains(name);
+}
+
+int MockImapServer::mailboxCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_mailboxes.size();
+}
+
+MockImapServer::Mailbox MockImapServer::mailbox(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_mailboxes.value(name);
+}
+
+void MockImapServer::clearMailboxes()
+{
+    QMutexLocker locker(&m_mutex);
+    m_mailboxes.clear();
+}
+
+int MockImapServer::commandCount(const QByteArray &verb) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_commandCounts.value(verb.toUpper());
+}
+
+void MockImapServer::resetCommandCounts()
+{
+    QMutexLocker locker(&m_mutex);
+    m_commandCounts.clear();
+}
+
+bool MockImapServer::start()
+{
+    if (m_thread.isRunning()) {
+        return isListening();
+    }
+
+    m_thread.start();
+    moveToThread(&m_thread);
+
+    bool ok = false;
+    QMetaObject::invokeMethod(this, [this]() {
+        return listen(QHostAddress::LocalHost);
+    }, Qt::BlockingQueuedConnection, &ok);
+
+    return ok;
+}
+
+void MockImapServer::stop()
+{
+    if (!m_thread.isRunning()) {
+        return;
+    }
+
+    QThread *owner = QThread::currentThread();
+    QMetaObject::invokeMethod(this, [this, owner]() {
+        close();
+        const auto connections = m_connections;
+        m_connections.clear();
+        for (auto it = connections.cbegin(); it != connections.cend(); ++it) {
+            it.key()->disconnect(this);
+            it.key()->abort();
+            delete it.key();
+            delete it.value();
+        }
+        moveToThread(owner);
+    }, Qt::BlockingQueuedConnection);
+
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void MockImapServer::incomingConnection(qintptr socketDescriptor)
+{
+    auto socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+
+    auto conn = new Connection;
+    conn->timer = new QTimer(socket);
+    conn->timer->setSingleShot(true);
+    m_connections.insert(socket, conn);
+
+    connect(conn->timer, &QTimer::timeout, this, [this, socket]() { flush(socket); });
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        delete m_connections.take(socket);
+        socket->deleteLater();
+    });
+
+    socket->write(QByteArrayLiteral("* OK [CAPABILITY ") + m_capabilities + QByteArrayLiteral("] Mock IMAP server ready\r\n"));
+}
+
+void MockImapServer::onReadyRead(QTcpSocket *socket)
+{
+    Connection *conn = m_connections.value(socket);
+    if (!conn) {
+        return;
+    }
+
+    conn->buffer += socket->readAll();
+    int idx = -1;
+    while ((idx = conn->buffer.indexOf('\n')) > -1) {
+        QByteArray line = conn->buffer.left(idx);
+        conn->buffer.remove(0, idx + 1);
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        processLine(socket, *conn, line);
+    }
+}
+
+void MockImapServer::processLine(QTcpSocket *socket, Connection &conn, const QByteArray &line)
+{
+    if (conn.authState != Connection::None) {
+        continueAuthentication(socket, conn, line);
+        return;
+    }
+
+    QList<QByteArray> tokens = tokenize(line);
+    if (tokens.size() < 2) {
+        sendReply(socket, tokens.value(0, QByteArrayLiteral("*")), Reply{{}, QByteArrayLiteral("BAD Missing command")});
+        return;
+    }
+
+    const QByteArray tag = tokens.takeFirst();
+    const QByteArray verb = tokens.takeFirst().toUpper();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_commandCounts[verb]++;
+    }
+
+    const auto handler = m_handlers.constFind(verb);
+    if (handler != m_handlers.cend()) {
+        sendReply(socket, tag, handler.value()(tokens));
+        return;
+    }
+
+    if (verb == "AUTHENTICATE") {
+        const QByteArray mech = tokens.value(0).toUpper();
+        conn.authTag = tag;
+        if (mech == "PLAIN") {
+            if (tokens.size() > 1) {
+                conn.authState = Connection::PlainWaiting;
+                continueAuthentication(socket, conn, tokens.at(1));
+            } else {
+                conn.authState = Connection::PlainWaiting;
+                socket->write(QByteArrayLiteral("+ \r\n"));
+            }
+        } else if (mech == "LOGIN") {
+            if (tokens.size() > 1) {
+                conn.authUser = QByteArray::fromBase64(tokens.at(1));
+                conn.authState = Connection::LoginPassword;
+                socket->write(QByteArrayLiteral("+ UGFzc3dvcmQ6\r\n"));
+            } else {
+                conn.authState = Connection::LoginUser;
+                socket->write(QByteArrayLiteral("+ VXNlcm5hbWU6\r\n"));
+            }
+        } else {
+            sendReply(socket, tag, Reply{{}, QByteArrayLiteral("NO Unsupported authentication mechanism")});
+        }
+        return;
+    }
+
+    if (verb == "LOGOUT") {
+        sendReply(socket, tag, Reply{{QByteArrayLiteral("BYE Mock IMAP server logging out")}, QByteArrayLiteral("OK Completed")}, true);
+        return;
+    }
+
+    sendReply(socket, tag, handle(conn, verb, tokens));
+}
+
+void MockImapServer::continueAuthentication(QTcpSocket *socket, Connection &conn, const QByteArray &line)
+{
+    if (line == "*") {
+        conn.authState = Connection::None;
+        sendReply(socket, conn.authTag, Reply{{}, QByteArrayLiteral("BAD Authentication cancelled")});
+        return;
+    }
+
+    switch (conn.authState) {
+    case Connection::PlainWaiting:
+    {
+        // authzid \0 authcid \0 password
+        const QList<QByteArray> parts = QByteArray::fromBase64(line).split('\0');
+        conn.authState = Connection::None;
+        if (parts.size() != 3) {
+            sendReply(socket, conn.authTag, Reply{{}, QByteArrayLiteral("NO Invalid authentication data")});
+            return;
+        }
+        finishAuthentication(socket, conn, parts.at(1), parts.at(2));
+        break;
+    }
+    case Connection::LoginUser:
+        conn.authUser = QByteArray::fromBase64(line);
+        conn.authState = Connection::LoginPassword;
+        socket->write(QByteArrayLiteral("+ UGFzc3dvcmQ6\r\n"));
+        break;
+    case Connection::LoginPassword:
+        conn.authState = Connection::None;
+        finishAuthentication(socket, conn, conn.authUser, QByteArray::fromBase64(line));
+        break;
+    default:
+        break;
+    }
+}
+
+void MockImapServer::finishAuthentication(QTcpSocket *socket, Connection &conn, const QByteArray &user, const QByteArray &password)
+{
+    if (checkCredentials(user, password)) {
+        conn.authenticated = true;
+        sendReply(socket, conn.authTag, Reply{{}, QByteArrayLiteral("OK [CAPABILITY ") + m_capabilities + QByteArrayLiteral("] Success")});
+    } else {
+        sendReply(socket, conn.authTag, Reply{{}, QByteArrayLiteral("NO Authentication failed")});
+    }
+}
+
+bool MockImapServer::checkCredentials(const QByteArray &user, const QByteArray &password) const
+{
+    if (user == m_user) {
+        return password == m_password;
+    }
+
+    // users of existing mailboxes can log in with every non empty password
+    return !password.isEmpty() && hasMailbox(QLatin1String("user.") + QString::fromUtf8(user));
+}
+
+MockImapServer::Reply MockImapServer::handle(Connection &conn, const QByteArray &verb, const QList<QByteArray> &args)
+{
+    if (verb == "CAPABILITY") {
+        return Reply{{QByteArrayLiteral("CAPABILITY ") + m_capabilities}, QByteArrayLiteral("OK Completed")};
+    }
+
+    if (verb == "NOOP") {
+        return Reply{};
+    }
+
+    if (verb == "LOGIN") {
+        if (args.size() != 2) {
+            return Reply{{}, QByteArrayLiteral("BAD Invalid arguments")};
+        }
+        if (!checkCredentials(args.at(0), args.at(1))) {
+            return Reply{{}, QByteArrayLiteral("NO Login failed")};
+        }
+        conn.authenticated = true;
+        return Reply{{}, QByteArrayLiteral("OK [CAPABILITY ") + m_capabilities + QByteArrayLiteral("] Logged in")};
+    }
+
+    if (verb == "ID") {
+        return Reply{{QByteArrayLiteral("ID (\"name\" ") + quoted(QString::fromLatin1(m_serverName)) + QByteArrayLiteral(" \"version\" \"1.0\")")}, QByteArrayLiteral("OK Completed")};
+    }
+
+    if (!conn.authenticated) {
+        return Reply{{}, QByteArrayLiteral("BAD Please login first")};
+    }
+
+    if (verb == "NAMESPACE") {
+        return Reply{{QByteArrayLiteral(R"(NAMESPACE (("INBOX." ".")) (("user." ".")) (("" ".")))")}, QByteArrayLiteral("OK Completed")};
+    }
+
+    if (verb == "LIST") {
+        if (args.size() < 2) {
+            return Reply{{}, QByteArrayLiteral("BAD Invalid arguments")};
+        }
+        return list(args.at(0), args.at(1));
+    }
+
+    if (verb == "GETQUOTA") {
+        return getQuota(args.value(0));
+    }
+
+    if (verb == "SETQUOTA") {
+        if (args.size() != 2) {
+            return Reply{{}, QByteArrayLiteral("BAD Invalid arguments")};
+        }
+        return setQuota(args.at(0), args.at(1));
+    }
+
+    if (verb == "CREATE") {
+        return create(args.value(0));
+    }
+
+    if (verb == "DELETE") {
+        return remove(args.value(0));
+    }
+
+    if (verb == "SETACL" || verb == "SETMETADATA") {
+        return requireMailbox(args.value(0));
+    }
+
+    if (verb == "SUBSCRIBE" || verb == "UNSUBSCRIBE") {
+        return Reply{};
+    }
+
+    return Reply{{}, QByteArrayLiteral("BAD Unrecognized command")};
+}
+
+MockImapServer::Reply MockImapServer::list(const QByteArray &reference, const QByteArray &pattern) const
+{
+    if (reference.isEmpty() && pattern.isEmpty()) {
+        return Reply{{QByteArrayLiteral(R"(LIST (\Noselect) "." "")")}, QByteArrayLiteral("OK Completed")};
+    }
+
+    const QString full = QString::fromUtf8(reference + pattern);
+    const int wildcard = full.indexOf(QRegularExpression(QStringLiteral("[*%]")));
+    const QString prefix = wildcard < 0 ? full : full.left(wildcard);
+
+    QString rx = QRegularExpression::escape(full);
+    rx.replace(QLatin1String("\\*"), QLatin1String(".*"));
+    rx.replace(QLatin1String("%"), QLatin1String("[^.]*"));
+    const QRegularExpression re(QRegularExpression::anchoredPattern(rx));
+
+    Reply reply;
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_mailboxes.lowerBound(prefix); it != m_mailboxes.cend() && it.key().startsWith(prefix); ++it) {
+        if (wildcard > -1 && !re.match(it.key()).hasMatch()) {
+            continue;
+        }
+        const auto next = std::next(it);
+        const bool hasChildren = next != m_mailboxes.cend() && next.key().startsWith(it.key() + QLatin1Char('.'));
+        reply.untagged << QByteArrayLiteral("LIST (") + (hasChildren ? QByteArrayLiteral("\\HasChildren") : QByteArrayLiteral("\\HasNoChildren")) + QByteArrayLiteral(") \".\" ") + quoted(it.key());
+    }
+
+    return reply;
+}
+
+MockImapServer::Reply MockImapServer::getQuota(const QByteArray &root) const
+{
+    const QString name = QString::fromUtf8(root);
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_mailboxes.constFind(name);
+    if (it == m_mailboxes.cend() || !it.value().hasQuota) {
+        return Reply{{}, QByteArrayLiteral("NO Quota root does not exist")};
+    }
+
+    return Reply{{QByteArrayLiteral("QUOTA ") + quoted(name) + QByteArrayLiteral(" (STORAGE ") + QByteArray::number(it.value().usage) + ' ' + QByteArray::number(it.value().limit) + ')'}, QByteArrayLiteral("OK Completed")};
+}
+
+MockImapServer::Reply MockImapServer::setQuota(const QByteArray &root, const QByteArray &limits)
+{
+    const QString name = QString::fromUtf8(root);
+    // limits is the raw parenthesized list like (STORAGE 1024)
+    const QList<QByteArray> parts = limits.mid(1, limits.size() - 2).simplified().split(' ');
+
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_mailboxes.find(name);
+    if (it == m_mailboxes.end()) {
+        return Reply{{}, QByteArrayLiteral("NO Mailbox does not exist")};
+    }
+
+    if (parts.size() == 2 && parts.at(0).toUpper() == "STORAGE") {
+        bool ok = false;
+        const quint64 limit = parts.at(1).toULongLong(&ok);
+        if (!ok) {
+            return Reply{{}, QByteArrayLiteral("BAD Invalid quota limit")};
+        }
+        it.value().limit = limit;
+        it.value().hasQuota = true;
+    } else if (parts.size() <= 1 && parts.value(0).isEmpty()) {
+        it.value().limit = 0;
+        it.value().hasQuota = false;
+    } else {
+        return Reply{{}, QByteArrayLiteral("BAD Invalid quota resource")};
+    }
+
+    return Reply{};
+}
+
+MockImapServer::Reply MockImapServer::create(const QByteArray &name)
+{
+    const QString mbName = QString::fromUtf8(name);
+    if (mbName.isEmpty()) {
+        return Reply{{}, QByteArrayLiteral("BAD Invalid mailbox name")};
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_mailboxes.contains(mbName)) {
+        return Reply{{}, QByteArrayLiteral("NO Mailbox already exists")};
+    }
+    m_mailboxes.insert(mbName, Mailbox{});
+
+    return Reply{};
+}
+
+MockImapServer::Reply MockImapServer::remove(const QByteArray &name)
+{
+    const QString mbName = QString::fromUtf8(name);
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_mailboxes.find(mbName);
+    if (it == m_mailboxes.end()) {
+        return Reply{{}, QByteArrayLiteral("NO Mailbox does not exist")};
+    }
+
+    it = m_mailboxes.erase(it);
+
+    // like Cyrus, deleting the INBOX of a user deletes the complete user
+    if (mbName.count(QLatin1Char('.')) == 1 && mbName.startsWith(QLatin1String("user."))) {
+        const QString childPrefix = mbName + QLatin1Char('.');
+        while (it != m_mailboxes.end() && it.key().startsWith(childPrefix)) {
+            it = m_mailboxes.erase(it);
+        }
+    }
+
+    return Reply{};
+}
+
+MockImapServer::Reply MockImapServer::requireMailbox(const QByteArray &name) const
+{
+    // empty name is the server itself for SETMETADATA
+    if (name.isEmpty() || hasMailbox(QString::fromUtf8(name))) {
+        return Reply{};
+    }
+
+    return Reply{{}, QByteArrayLiteral("NO Mailbox does not exist")};
+}
+
+void MockImapServer::sendReply(QTcpSocket *socket, const QByteArray &tag, const Reply &reply, bool close)
+{
+    Connection *conn = m_connections.value(socket);
+    if (!conn) {
+        return;
+    }
+
+    QByteArray data;
+    for (const QByteArray &line : reply.untagged) {
+        data += QByteArrayLiteral("* ") + line + QByteArrayLiteral("\r\n");
+    }
+    data += tag + ' ' + reply.status + QByteArrayLiteral("\r\n");
+
+    conn->queue.append({QDeadlineTimer::current().deadline() + m_latency, data});
+    conn->closeAfterFlush = conn->closeAfterFlush || close;
+    flush(socket);
+}
+
+void MockImapServer::flush(QTcpSocket *socket)
+{
+    Connection *conn = m_connections.value(socket);
+    if (!conn) {
+        return;
+    }
+
+    const qint64 now = QDeadlineTimer::current().deadline();
+    while (!conn->queue.empty() && conn->queue.constFirst().first <= now) {
+        socket->write(conn->queue.takeFirst().second);
+    }
+
+    if (!conn->queue.empty()) {
+        if (!conn->timer->isActive()) {
+            conn->timer->start(static_cast<int>(conn->queue.constFirst().first - now));
+        }
+    } else if (conn->closeAfterFlush) {
+        socket->disconnectFromHost();
+    }
+}
+
+QList<QByteArray> MockImapServer::tokenize(const QByteArray &line)
+{
+    QList<QByteArray> tokens;
+    int i = 0;
+    const int size = line.size();
+    while (i < size) {
+        const char c = line.at(i);
+        if (c == ' ') {
+            ++i;
+        } else if (c == '"') {
+            QByteArray token;
+            ++i;
+            while (i < size && line.at(i) != '"') {
+                if (line.at(i) == '\\' && i + 1 < size) {
+                    ++i;
+                }
+                token += line.at(i++);
+            }
+            ++i;
+            tokens << token;
+        } else if (c == '(') {
+            const int start = i;
+            int depth = 0;
+            bool inQuotes = false;
+            for (; i < size; ++i) {
+                const char p = line.at(i);
+                if (p == '"' && (i == 0 || line.at(i - 1) != '\\')) {
+                    inQuotes = !inQuotes;
+                } else if (!inQuotes && p == '(') {
+                    ++depth;
+                } else if (!inQuotes && p == ')' && --depth == 0) {
+                    ++i;
+                    break;
+                }
+            }
+            tokens << line.mid(start, i - start);
+        } else {
+            const int start = i;
+            while (i < size && line.at(i) != ' ') {
+                ++i;
+            }
+            tokens << line.mid(start, i - start);
+        }
+    }
+    return tokens;
+}
+
+QByteArray MockImapServer::quoted(const QString &str)
+{
+    QByteArray escaped = str.toUtf8();
+    escaped.replace('\\', QByteArrayLiteral("\\\\"));
+    escaped.replace('"', QByteArrayLiteral("\\\""));
+    return '"' + escaped + '"';
+}
+
+#include "moc_mockimapserver.cpp"
@@ -0,0 +1,132 @@
+#ifndef MOCKIMAPSERVER_H
+#define MOCKIMAPSERVER_H
+
+#include <QTcpServer>
+#include <QThread>
+#include <QMutex>
+#include <QMap>
+#include <QHash>
+#include <QStringList>
+
+#include <functional>
+
+class QTcpSocket;
+
+/*!
+ * \brief Scriptable in-process IMAP server for tests and benchmarks.
+ *
+ * The server runs in its own thread, so that the blocking Imap client can be used
+ * from the test thread. It implements the subset of IMAP used by Skaffari on top of
+ * an in-memory mailbox list: CAPABILITY, LOGIN, AUTHENTICATE PLAIN/LOGIN, ID,
+ * NAMESPACE, LIST, GETQUOTA, SETQUOTA, CREATE, DELETE, SETACL, SETMETADATA,
+ * SUBSCRIBE, NOOP and LOGOUT. The hierarchy delimiter is the dot, user mailboxes
+ * live below \c user. like on a Cyrus server without unixhierarchysep.
+ *
+ * Every command can be replaced by a custom handler with setHandler(), for example
+ * to let it fail. Configuration has to be done before start(), the mailbox list can
+ * be inspected and changed at any time.
+ */
+class MockImapServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Reply {
+        QList<QByteArray> untagged;
+        QByteArray status{"OK Completed"};
+    };
+
+    /*!
+     * \brief Handler for a command verb, gets the command arguments with quoted strings already unquoted.
+     */
+    using Handler = std::function<Reply(const QList<QByteArray> &args)>;
+
+    struct Mailbox {
+        quint64 usage{0};
+        quint64 limit{0};
+        bool hasQuota{false};
+    };
+
+    explicit MockImapServer(QObject *parent = nullptr);
+    ~MockImapServer() override;
+
+    void setCapabilities(const QByteArray &capabilities);
+    void setServerName(const QByteArray &name);
+    void setCredentials(const QByteArray &user, const QByteArray &password);
+
+    /*!
+     * \brief Delays every tagged response by \a msecs milliseconds.
+     */
+    void setLatency(int msecs);
+
+    void setHandler(const QByteArray &verb, Handler handler);
+
+    void addMailbox(const QString &name, quint64 usage = 0, quint64 limit = 0);
+
+    /*!
+     * \brief Adds \a count synthetic user mailboxes named \c user.test000001 and so on,
+     * each with the sub \a folders and a quota of \a limit KiB.
+     */
+    void addMailboxes(int count, const QStringList &folders = {}, quint64 limit = 1024 * 1024);
+
+    /*!
+     * \brief Returns the name of the synthetic user at \a index as created by addMailboxes().
+     */
+    static QString syntheticUser(int index);
+
+    [[nodiscard]] bool hasMailbox(const QString &name) const;
+    [[nodiscard]] int mailboxCount() const;
+    [[nodiscard]] Mailbox mailbox(const QString &name) const;
+    void clearMailboxes();
+
+    /*!
+     * \brief Returns how often the command \a verb has been received.
+     */
+    [[nodiscard]] int commandCount(const QByteArray &verb) const;
+    void resetCommandCounts();
+
+    /*!
+     * \brief Starts listening on a random port on the loopback interface in the server thread.
+     */
+    bool start();
+
+    void stop();
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    struct Connection;
+
+    void onReadyRead(QTcpSocket *socket);
+    void processLine(QTcpSocket *socket, Connection &conn, const QByteArray &line);
+    void continueAuthentication(QTcpSocket *socket, Connection &conn, const QByteArray &line);
+    void finishAuthentication(QTcpSocket *socket, Connection &conn, const QByteArray &user, const QByteArray &password);
+    Reply handle(Connection &conn, const QByteArray &verb, const QList<QByteArray> &args);
+    void sendReply(QTcpSocket *socket, const QByteArray &tag, const Reply &reply, bool close = false);
+    void flush(QTcpSocket *socket);
+    bool checkCredentials(const QByteArray &user, const QByteArray &password) const;
+
+    Reply list(const QByteArray &reference, const QByteArray &pattern) const;
+    Reply getQuota(const QByteArray &root) const;
+    Reply setQuota(const QByteArray &root, const QByteArray &limits);
+    Reply create(const QByteArray &name);
+    Reply remove(const QByteArray &name);
+    Reply requireMailbox(const QByteArray &name) const;
+
+    static QList<QByteArray> tokenize(const QByteArray &line);
+    static QByteArray quoted(const QString &str);
+
+    QThread m_thread;
+    mutable QMutex m_mutex;
+    QMap<QString,Mailbox> m_mailboxes;
+    QHash<QByteArray,int> m_commandCounts;
+    QHash<QByteArray,Handler> m_handlers;
+    QHash<QTcpSocket*,Connection*> m_connections;
+    QByteArray m_capabilities{"IMAP4rev1 LITERAL+ ID NAMESPACE QUOTA ACL METADATA SPECIAL-USE CREATE-SPECIAL-USE SASL-IR AUTH=PLAIN AUTH=LOGIN"};
+    QByteArray m_serverName{"Cyrus IMAP"};
+    QByteArray m_user{"cyrus"};
+    QByteArray m_password{"secret"};
+    int m_latency{0};
+};
+
+#endif // MOCKIMAPSERVER_H
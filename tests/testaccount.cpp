@@ -4,6 +4,7 @@
 #include <QDataStream>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QMetaObject>
 #include <QMetaProperty>
 
@@ -57,6 +58,7 @@ private Q_SLOTS:
     void calcStatus_data();
     void datastream();
     void toJson();
+    void listRowJson();
 
     void cleanupTestCase() {}
 
@@ -332,6 +334,68 @@ void AccountTest::toJson()
     QCOMPARE(a.toJson(), o);
 }
 
+void AccountTest::listRowJson()
+{
+    const QDateTime created = QDateTime(QDate(2023, 4, 5), QTime(6, 7, 8), Qt::UTC);
+
+    Account a(123,
+              456,
+              QStringLiteral("te\"st\\er\n"),
+              true,
+              false,
+              true,
+              true,
+              QStringList({QStringLiteral("test@example.com"), QStringLiteral("tëst@example.com")}),
+              QStringList(),
+              123456,
+              2345,
+              created,
+              created.addDays(1),
+              created.addYears(100),
+              created.addDays(2),
+              false,
+              true,
+              2);
+
+    AccountListRow row;
+    row.id = 123;
+    row.username = a.username();
+    row.setFlag(AccountListRow::Imap, true);
+    row.setFlag(AccountListRow::Pop, false);
+    row.setFlag(AccountListRow::Sieve, true);
+    row.setFlag(AccountListRow::SmtpAuth, true);
+    row.setFlag(AccountListRow::CatchAll, true);
+    row.addresses = a.addresses();
+    row.quota = 123456;
+    row.usage = 2345;
+    row.created = created;
+    row.updated = created.addDays(1);
+    row.validUntil = created.addYears(100);
+    row.passwordExpires = created.addDays(2);
+    row.status = 2;
+
+    QVERIFY(row.testFlag(AccountListRow::Imap));
+    QVERIFY(!row.testFlag(AccountListRow::Pop));
+    QVERIFY(!row.testFlag(AccountListRow::KeepLocal));
+
+    QByteArray out;
+    AccountListRow::writeJsonArray(out, std::vector<AccountListRow>({row, row}), 456);
+
+    QJsonParseError jpe;
+    const QJsonDocument doc = QJsonDocument::fromJson(out, &jpe);
+    QCOMPARE(jpe.error, QJsonParseError::NoError);
+    QVERIFY(doc.isArray());
+
+    const QJsonArray arr = doc.array();
+    QCOMPARE(arr.size(), 2);
+    QCOMPARE(arr.at(0).toObject(), a.toJson());
+    QCOMPARE(arr.at(1).toObject(), a.toJson());
+
+    out.clear();
+    AccountListRow::writeJsonArray(out, std::vector<AccountListRow>(), 456);
+    QCOMPARE(out, QByteArrayLiteral("[]"));
+}
+
 QTEST_MAIN(AccountTest)
 
 #include "testaccount.moc"
@@ -0,0 +1,58 @@
+#include "../src/utils/autoconfigcache.h"
+
+#include <QTest>
+
+class AutoconfigCacheTest : public QObject
+{
+    Q_OBJECT
+public:
+    AutoconfigCacheTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void insertValue();
+    void invalidate();
+
+    void cleanupTestCase() {}
+};
+
+void AutoconfigCacheTest::insertValue()
+{
+    const QString key = QStringLiteral("autoconfig\nexample.com\njohn");
+    QVERIFY(!AutoconfigCache::value(key));
+
+    const QByteArray body = QByteArrayLiteral("<clientConfig version=\"1.1\"/>");
+    const AutoconfigCache::Entry inserted = AutoconfigCache::insert(key, body);
+    QCOMPARE(inserted.body, body);
+    QVERIFY(inserted.etag.startsWith('"'));
+    QVERIFY(inserted.etag.endsWith('"'));
+    QCOMPARE(inserted.lastModified.time().msec(), 0);
+
+    const auto cached = AutoconfigCache::value(key);
+    QVERIFY(cached);
+    QCOMPARE(cached->body, body);
+    QCOMPARE(cached->etag, inserted.etag);
+    QCOMPARE(cached->lastModified, inserted.lastModified);
+
+    // same body, same ETag
+    QCOMPARE(AutoconfigCache::insert(QStringLiteral("other"), body).etag, inserted.etag);
+    QVERIFY(AutoconfigCache::insert(QStringLiteral("other"), QByteArrayLiteral("<clientConfig/>")).etag != inserted.etag);
+}
+
+void AutoconfigCacheTest::invalidate()
+{
+    const QString key = QStringLiteral("autoconfig\nexample.net\njane");
+    AutoconfigCache::insert(key, QByteArrayLiteral("<clientConfig/>"));
+    QVERIFY(AutoconfigCache::value(key));
+
+    AutoconfigCache::invalidate();
+    QVERIFY(!AutoconfigCache::value(key));
+
+    AutoconfigCache::insert(key, QByteArrayLiteral("<clientConfig/>"));
+    QVERIFY(AutoconfigCache::value(key));
+}
+
+QTEST_MAIN(AutoconfigCacheTest)
+
+#include "testautoconfigcache.moc"
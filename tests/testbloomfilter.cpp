@@ -0,0 +1,101 @@
+#include "../src/utils/bloomfilter.h"
+
+#include <QTest>
+#include <QRandomGenerator>
+#include <QSet>
+
+class BloomFilterTest : public QObject
+{
+    Q_OBJECT
+public:
+    BloomFilterTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void emptyFilter();
+    void bitCount();
+    void noFalseNegatives();
+    void falsePositiveRate();
+
+    void cleanupTestCase() {}
+
+private:
+    static QString randomAddress(QRandomGenerator &rand);
+};
+
+QString BloomFilterTest::randomAddress(QRandomGenerator &rand)
+{
+    static const QString chars = QStringLiteral("abcdefghijklmnopqrstuvwxyz0123456789.-");
+    QString local;
+    const int len = rand.bounded(4, 20);
+    for (int i = 0; i < len; ++i) {
+        local.append(chars.at(rand.bounded(chars.size())));
+    }
+    return local + QLatin1String("@example.com");
+}
+
+void BloomFilterTest::emptyFilter()
+{
+    BloomFilter filter(100);
+    QVERIFY(!filter.contains(QStringLiteral("john@example.com")));
+    QVERIFY(!filter.contains(QString()));
+}
+
+void BloomFilterTest::bitCount()
+{
+    QCOMPARE(BloomFilter().bitCount(), 640);
+    QCOMPARE(BloomFilter(100).bitCount(), 1024);
+    QCOMPARE(BloomFilter(1000).bitCount(), 10048);
+}
+
+void BloomFilterTest::noFalseNegatives()
+{
+    QRandomGenerator rand(42);
+    QStringList addresses;
+    addresses.reserve(5000);
+    for (int i = 0; i < 5000; ++i) {
+        addresses.push_back(randomAddress(rand));
+    }
+
+    BloomFilter filter(addresses.size());
+    for (const QString &address : addresses) {
+        filter.add(address);
+    }
+
+    for (const QString &address : addresses) {
+        QVERIFY2(filter.contains(address), qUtf8Printable(address));
+    }
+}
+
+void BloomFilterTest::falsePositiveRate()
+{
+    QRandomGenerator rand(23);
+    BloomFilter filter(20000);
+    QSet<QString> added;
+    while (added.size() < 20000) {
+        const QString address = randomAddress(rand);
+        added.insert(address);
+        filter.add(address);
+    }
+
+    int tested = 0;
+    int falsePositives = 0;
+    while (tested < 20000) {
+        const QString address = randomAddress(rand);
+        if (added.contains(address)) {
+            continue;
+        }
+        ++tested;
+        if (filter.contains(address)) {
+            ++falsePositives;
+        }
+    }
+
+    // sized for about 1%
+    QVERIFY2(falsePositives < tested / 50, qUtf8Printable(QString::number(falsePositives)));
+}
+
+QTEST_MAIN(BloomFilterTest)
+
+#include "testbloomfilter.moc"
@@ -0,0 +1,79 @@
+#include "../src/utils/collation.h"
+
+#include <QTest>
+#include <QLocale>
+#include <QStringList>
+
+#include <vector>
+
+class CollationTest : public QObject
+{
+    Q_OBJECT
+public:
+    CollationTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void sortStringList();
+    void sortVectorByKey();
+    void cachedCollator();
+
+    void cleanupTestCase() {}
+};
+
+void CollationTest::sortStringList()
+{
+    const QLocale locale(QLocale::English, QLocale::UnitedStates);
+    const QStringList input({QStringLiteral("charlie@example.com"), QStringLiteral("Alpha@example.com"), QStringLiteral("bravo@example.com"), QStringLiteral("alpha@example.com")});
+
+    QStringList expected = input;
+    const QCollator col(locale);
+    std::sort(expected.begin(), expected.end(), [&col](const QString &left, const QString &right) {
+        return col.compare(left, right) < 0;
+    });
+
+    QStringList sorted = input;
+    Collation::sort(sorted, locale);
+    QCOMPARE(sorted, expected);
+
+    QStringList empty;
+    Collation::sort(empty, locale);
+    QVERIFY(empty.empty());
+}
+
+void CollationTest::sortVectorByKey()
+{
+    struct Item {
+        int id;
+        QString name;
+    };
+
+    std::vector<Item> items;
+    items.push_back({1, QStringLiteral("zulu.example")});
+    items.push_back({2, QStringLiteral("bravo.example")});
+    items.push_back({3, QStringLiteral("ärger.example")});
+    items.push_back({4, QStringLiteral("alpha.example")});
+
+    Collation::sort(items, QLocale(QLocale::German, QLocale::Germany), [](const Item &item) { return item.name; });
+
+    QCOMPARE(items.size(), static_cast<std::size_t>(4));
+    QCOMPARE(items.at(0).id, 4);
+    QCOMPARE(items.at(1).id, 3);
+    QCOMPARE(items.at(2).id, 2);
+    QCOMPARE(items.at(3).id, 1);
+}
+
+void CollationTest::cachedCollator()
+{
+    const QLocale locale(QLocale::German, QLocale::Germany);
+    const QCollator &first = Collation::collator(locale);
+    const QCollator &second = Collation::collator(locale);
+    QCOMPARE(&first, &second);
+    QCOMPARE(first.locale(), locale);
+    QVERIFY(&Collation::collator(QLocale(QLocale::English, QLocale::UnitedStates)) != &first);
+}
+
+QTEST_MAIN(CollationTest)
+
+#include "testcollation.moc"
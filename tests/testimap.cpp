@@ -1,6 +1,39 @@
 #include "imap/imap.h"
+#include "imap/imapmetrics.h"
 
 #include <QTest>
+#include <QRandomGenerator>
+
+#include <unicode/ucnv.h>
+
+/*!
+ * \brief Reference implementation of the UTF7-IMAP conversion using ICU.
+ */
+static QString icuConvert(const char *toConverter, const char *fromConverter, const QByteArray &in, bool toUtf8)
+{
+    if (in.isEmpty()) {
+        return {};
+    }
+
+    QByteArray buf(in.size() * 3 + 1, Qt::Uninitialized);
+    UErrorCode uec = U_ZERO_ERROR;
+    const int32_t size = ucnv_convert(toConverter, fromConverter, buf.data(), buf.size(), in.constData(), in.size(), &uec);
+    if (size <= 0 || U_FAILURE(uec)) {
+        return {};
+    }
+    buf.truncate(size);
+    return toUtf8 ? QString::fromUtf8(buf) : QString::fromLatin1(buf);
+}
+
+static QString icuToUtf7Imap(const QString &str)
+{
+    return icuConvert("imap-mailbox-name", "utf-8", str.toUtf8(), false);
+}
+
+static QString icuFromUtf7Imap(const QString &str)
+{
+    return icuConvert("utf-8", "imap-mailbox-name", str.toLatin1(), true);
+}
 
 class ImapTest : public QObject
 {
@@ -13,6 +46,25 @@ public:
 
 private Q_SLOTS:
     void testUt7ImapConvert();
+
+    void testUtf7ImapEncode_data();
+    void testUtf7ImapEncode();
+
+    void testUtf7ImapInvalid_data();
+    void testUtf7ImapInvalid();
+
+    void testUtf7ImapFuzz();
+
+    void testMetrics();
+
+    void benchmarkToUtf7Imap_data();
+    void benchmarkToUtf7Imap();
+
+    void benchmarkFromUtf7Imap_data();
+    void benchmarkFromUtf7Imap();
+
+private:
+    QString randomMailboxName(QRandomGenerator &rand) const;
 };
 
 void ImapTest::testUt7ImapConvert()
@@ -36,6 +88,190 @@ void ImapTest::testUt7ImapConvert()
     }
 }
 
+void ImapTest::testUtf7ImapEncode_data()
+{
+    QTest::addColumn<QString>("decoded");
+    QTest::addColumn<QString>("encoded");
+
+    QTest::newRow("empty") << QString() << QString();
+    QTest::newRow("ascii") << QStringLiteral("INBOX.Sent Items") << QStringLiteral("INBOX.Sent Items");
+    QTest::newRow("ampersand") << QStringLiteral("Tom & Jerry") << QStringLiteral("Tom &- Jerry");
+    QTest::newRow("umlaut") << QStringLiteral("Entwürfe") << QStringLiteral("Entw&APw-rfe");
+    QTest::newRow("rfc3501") << QStringLiteral("~peter/mail/台北/日本語") << QStringLiteral("~peter/mail/&U,BTFw-/&ZeVnLIqe-");
+    QTest::newRow("surrogates") << QStringLiteral("\U0001F600") << QStringLiteral("&2D3eAA-");
+    QTest::newRow("control") << QStringLiteral("a\tb") << QStringLiteral("a&AAk-b");
+}
+
+void ImapTest::testUtf7ImapEncode()
+{
+    QFETCH(QString, decoded);
+    QFETCH(QString, encoded);
+
+    QCOMPARE(Imap::toUtf7Imap(decoded), encoded);
+    QCOMPARE(Imap::fromUtf7Imap(encoded), decoded);
+}
+
+void ImapTest::testUtf7ImapInvalid_data()
+{
+    QTest::addColumn<QString>("encoded");
+
+    QTest::newRow("unterminated") << QStringLiteral("Entw&APw");
+    QTest::newRow("invalid-char") << QStringLiteral("Entw&AP/-rfe");
+    QTest::newRow("non-ascii") << QStringLiteral("Entw&APü-rfe");
+    QTest::newRow("trailing-bits") << QStringLiteral("&APx-");
+    QTest::newRow("incomplete-unit") << QStringLiteral("&APwA-");
+}
+
+void ImapTest::testUtf7ImapInvalid()
+{
+    QFETCH(QString, encoded);
+
+    QVERIFY(Imap::fromUtf7Imap(encoded).isNull());
+}
+
+QString ImapTest::randomMailboxName(QRandomGenerator &rand) const
+{
+    static const QString pool = QStringLiteral("abcXYZ019 ._-/&&&\täßü€台北日本");
+
+    const int length = rand.bounded(0, 24);
+    QString name;
+    name.reserve(length * 2);
+    for (int i = 0; i < length; ++i) {
+        if (rand.bounded(8) == 0) {
+            // supplementary plane character encoded as surrogate pair
+            const char32_t ucs4 = 0x10000 + rand.bounded(0xFFFFF);
+            name.append(QString::fromUcs4(&ucs4, 1));
+        } else {
+            name.append(pool.at(rand.bounded(pool.size())));
+        }
+    }
+    return name;
+}
+
+void ImapTest::testUtf7ImapFuzz()
+{
+    QRandomGenerator rand(3501);
+
+    for (int i = 0; i < 20000; ++i) {
+        const QString str = randomMailboxName(rand);
+        const QString utf7 = Imap::toUtf7Imap(str);
+
+        if (!str.isEmpty()) {
+            QCOMPARE(utf7, icuToUtf7Imap(str));
+            QCOMPARE(Imap::fromUtf7Imap(utf7), icuFromUtf7Imap(utf7));
+        }
+        QCOMPARE(Imap::fromUtf7Imap(utf7), str);
+    }
+}
+
+void ImapTest::testMetrics()
+{
+    ImapMetrics metrics;
+    QVERIFY(metrics.isEmpty());
+
+    metrics.record(QByteArrayLiteral("GETQUOTA"), 3'000'000, 30, 120, false);
+    metrics.record(QByteArrayLiteral("GETQUOTA"), 70'000'000, 30, 20, true);
+    metrics.record(QByteArrayLiteral("LOGIN"), 20'000'000'000, 40, 200, false);
+
+    QVERIFY(!metrics.isEmpty());
+
+    const auto counters = metrics.counters();
+    QCOMPARE(counters.size(), 2);
+
+    const ImapMetrics::Counters quota = counters.value(QByteArrayLiteral("GETQUOTA"));
+    QCOMPARE(quota.count, Q_UINT64_C(2));
+    QCOMPARE(quota.errors, Q_UINT64_C(1));
+    QCOMPARE(quota.bytesOut, Q_UINT64_C(60));
+    QCOMPARE(quota.bytesIn, Q_UINT64_C(140));
+    QCOMPARE(quota.latencySum, Q_INT64_C(73000000));
+    QCOMPARE(quota.buckets.at(1), Q_UINT64_C(1)); // le 5ms
+    QCOMPARE(quota.buckets.at(5), Q_UINT64_C(1)); // le 100ms
+
+    const ImapMetrics::Counters login = counters.value(QByteArrayLiteral("LOGIN"));
+    QCOMPARE(login.buckets.back(), Q_UINT64_C(1));
+
+    const QByteArray prom = metrics.toPrometheus();
+    QVERIFY(prom.contains("skaffari_imap_commands_total{verb=\"GETQUOTA\"} 2\n"));
+    QVERIFY(prom.contains("skaffari_imap_command_errors_total{verb=\"GETQUOTA\"} 1\n"));
+    QVERIFY(prom.contains("skaffari_imap_command_duration_seconds_bucket{verb=\"GETQUOTA\",le=\"0.1\"} 2\n"));
+    QVERIFY(prom.contains("skaffari_imap_command_duration_seconds_bucket{verb=\"LOGIN\",le=\"10\"} 0\n"));
+    QVERIFY(prom.contains("skaffari_imap_command_duration_seconds_bucket{verb=\"LOGIN\",le=\"+Inf\"} 1\n"));
+
+    const QByteArray promPid = metrics.toPrometheus(QByteArrayLiteral("pid=\"42\""));
+    QVERIFY(promPid.contains("skaffari_imap_commands_total{pid=\"42\",verb=\"GETQUOTA\"} 2\n"));
+    QVERIFY(promPid.contains("skaffari_imap_command_duration_seconds_sum{pid=\"42\",verb=\"LOGIN\"} "));
+}
+
+void ImapTest::benchmarkToUtf7Imap_data()
+{
+    QTest::addColumn<QString>("str");
+    QTest::addColumn<bool>("icu");
+
+    const QString ascii = QStringLiteral("INBOX.Archive.2024.Projects");
+    const QString latin = QStringLiteral("Gelöschte Elemente.Entwürfe");
+    const QString cjk = QStringLiteral("~peter/mail/台北/日本語");
+
+    QTest::newRow("ascii") << ascii << false;
+    QTest::newRow("ascii-icu") << ascii << true;
+    QTest::newRow("latin") << latin << false;
+    QTest::newRow("latin-icu") << latin << true;
+    QTest::newRow("cjk") << cjk << false;
+    QTest::newRow("cjk-icu") << cjk << true;
+}
+
+void ImapTest::benchmarkToUtf7Imap()
+{
+    QFETCH(QString, str);
+    QFETCH(bool, icu);
+
+    QString result;
+    if (icu) {
+        QBENCHMARK {
+            result = icuToUtf7Imap(str);
+        }
+    } else {
+        QBENCHMARK {
+            result = Imap::toUtf7Imap(str);
+        }
+    }
+    QVERIFY(!result.isEmpty());
+}
+
+void ImapTest::benchmarkFromUtf7Imap_data()
+{
+    QTest::addColumn<QString>("str");
+    QTest::addColumn<bool>("icu");
+
+    const QString ascii = QStringLiteral("INBOX.Archive.2024.Projects");
+    const QString latin = QStringLiteral("Gel&APY-schte Elemente.Entw&APw-rfe");
+    const QString cjk = QStringLiteral("~peter/mail/&U,BTFw-/&ZeVnLIqe-");
+
+    QTest::newRow("ascii") << ascii << false;
+    QTest::newRow("ascii-icu") << ascii << true;
+    QTest::newRow("latin") << latin << false;
+    QTest::newRow("latin-icu") << latin << true;
+    QTest::newRow("cjk") << cjk << false;
+    QTest::newRow("cjk-icu") << cjk << true;
+}
+
+void ImapTest::benchmarkFromUtf7Imap()
+{
+    QFETCH(QString, str);
+    QFETCH(bool, icu);
+
+    QString result;
+    if (icu) {
+        QBENCHMARK {
+            result = icuFromUtf7Imap(str);
+        }
+    } else {
+        QBENCHMARK {
+            result = Imap::fromUtf7Imap(str);
+        }
+    }
+    QVERIFY(!result.isEmpty());
+}
+
 QTEST_MAIN(ImapTest)
 
 #include "testimap.moc"
@@ -0,0 +1,178 @@
+#include "imap/imaplimiter.h"
+#include "utils/skaffariconfig.h"
+
+#include <QFile>
+#include <QTest>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class ImapLimiterTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ImapLimiterTest(QObject *parent = nullptr)
+        : QObject{parent}
+    {}
+    ~ImapLimiterTest() override = default;
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testSharedSlots();
+
+    void testSlotOfKilledProcess();
+
+    void testBreakerHalfOpen();
+
+    void testBreakerDisabled();
+
+private:
+    void loadConfig(quint32 breakerThreshold) const;
+
+    QTemporaryDir m_runtimeDir;
+};
+
+void ImapLimiterTest::initTestCase()
+{
+    QVERIFY(m_runtimeDir.isValid());
+    qputenv("RUNTIME_DIRECTORY", QFile::encodeName(m_runtimeDir.path()));
+    loadConfig(2);
+}
+
+void ImapLimiterTest::loadConfig(quint32 breakerThreshold) const
+{
+    const QVariantMap imap{
+        {QStringLiteral("host"), QStringLiteral("127.0.0.1")},
+        {QStringLiteral("port"), 143},
+        {QStringLiteral("user"), QStringLiteral("cyrus")},
+        {QStringLiteral("password"), QStringLiteral("secret")},
+        {QStringLiteral("maxadminsessions"), 2},
+        {QStringLiteral("sharedadminlimit"), true},
+        {QStringLiteral("breakerthreshold"), breakerThreshold},
+        {QStringLiteral("breakercooldown"), 1}
+    };
+    SkaffariConfig::load({}, {}, {}, imap, {});
+}
+
+void ImapLimiterTest::testSharedSlots()
+{
+    QVERIFY(ImapSessionLimiter::lockFileBase().startsWith(m_runtimeDir.path() + QLatin1String("/skaffari-imap-admin-")));
+
+    ImapSessionLimiter limiter;
+    QVERIFY(limiter.isEnabled());
+    QVERIFY(limiter.isShared());
+
+    const int slot1 = limiter.acquire(0);
+    const int slot2 = limiter.acquire(0);
+    QVERIFY(slot1 > -1);
+    QVERIFY(slot2 > -1);
+    QVERIFY(slot1 != slot2);
+    QCOMPARE(limiter.acquire(50), -1);
+
+    // a second limiter behaves like another process
+    ImapSessionLimiter other;
+    QCOMPARE(other.acquire(20), -1);
+
+    limiter.release(slot1);
+    QCOMPARE(other.acquire(0), slot1);
+    QCOMPARE(limiter.acquire(0), -1);
+
+    other.release(slot1);
+    limiter.release(slot2);
+}
+
+void ImapLimiterTest::testSlotOfKilledProcess()
+{
+    int fds[2];
+    QCOMPARE(::pipe(fds), 0);
+
+    const pid_t pid = ::fork();
+    QVERIFY(pid > -1);
+
+    if (pid == 0) {
+        ::close(fds[0]);
+        ImapSessionLimiter limiter;
+        const char ok = (limiter.acquire(0) > -1 && limiter.acquire(0) > -1) ? '1' : '0';
+        if (::write(fds[1], &ok, 1) != 1) {
+            ::_exit(1);
+        }
+        // wait to get killed while holding all slots
+        for (;;) {
+            ::pause();
+        }
+    }
+
+    ::close(fds[1]);
+    char ok = '0';
+    QCOMPARE(::read(fds[0], &ok, 1), static_cast<ssize_t>(1));
+    ::close(fds[0]);
+    QCOMPARE(ok, '1');
+
+    ImapSessionLimiter limiter;
+    QCOMPARE(limiter.acquire(20), -1);
+
+    ::kill(pid, SIGKILL);
+    int status = 0;
+    QCOMPARE(::waitpid(pid, &status, 0), pid);
+
+    const int slot = limiter.acquire(0);
+    QVERIFY(slot > -1);
+    limiter.release(slot);
+}
+
+void ImapLimiterTest::testBreakerHalfOpen()
+{
+    ImapCircuitBreaker::reset();
+
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+    ImapCircuitBreaker::recordTimeout();
+    QVERIFY(!ImapCircuitBreaker::isOpen());
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+    ImapCircuitBreaker::recordTimeout();
+
+    QVERIFY(ImapCircuitBreaker::isOpen());
+    QVERIFY(!ImapCircuitBreaker::allowRequest());
+
+    QThread::msleep(1100);
+
+    // only a single trial is let through after the cool down
+    QVERIFY(!ImapCircuitBreaker::isOpen());
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+    QVERIFY(!ImapCircuitBreaker::allowRequest());
+    QVERIFY(ImapCircuitBreaker::isOpen());
+
+    // a failed trial opens the breaker again at once
+    ImapCircuitBreaker::recordTimeout();
+    QVERIFY(ImapCircuitBreaker::isOpen());
+    QVERIFY(!ImapCircuitBreaker::allowRequest());
+
+    QThread::msleep(1100);
+
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+    ImapCircuitBreaker::recordSuccess();
+    QVERIFY(!ImapCircuitBreaker::isOpen());
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+}
+
+void ImapLimiterTest::testBreakerDisabled()
+{
+    loadConfig(0);
+    ImapCircuitBreaker::reset();
+
+    for (int i = 0; i < 10; ++i) {
+        ImapCircuitBreaker::recordTimeout();
+    }
+    QVERIFY(!ImapCircuitBreaker::isOpen());
+    QVERIFY(ImapCircuitBreaker::allowRequest());
+
+    loadConfig(2);
+}
+
+QTEST_MAIN(ImapLimiterTest)
+
+#include "testimaplimiter.moc"
@@ -0,0 +1,341 @@
+#include "imap/imap.h"
+#include "utils/skaffariconfig.h"
+#include "mockimapserver.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+
+class ImapMockTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ImapMockTest(QObject *parent = nullptr)
+        : QObject{parent}
+    {}
+    ~ImapMockTest() override = default;
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testLogin_data();
+    void testLogin();
+
+    void testLoginFailed();
+
+    void testQuota();
+
+    void testCreateDeleteMailbox();
+
+    void testGetMailboxes();
+
+    void testProvisionMailboxes();
+
+    void testHandler();
+
+    void testLatency();
+
+    void benchmarkAccountList_data();
+    void benchmarkAccountList();
+
+    void benchmarkAccountCheck_data();
+    void benchmarkAccountCheck();
+
+    void benchmarkDomainRemove_data();
+    void benchmarkDomainRemove();
+
+private:
+    void loadConfig(quint16 port) const;
+    void benchmarkData() const;
+
+    MockImapServer m_server;
+};
+
+void ImapMockTest::initTestCase()
+{
+    m_server.addMailboxes(10, {QStringLiteral("Sent"), QStringLiteral("Trash")});
+    QVERIFY(m_server.start());
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::loadConfig(quint16 port) const
+{
+    const QVariantMap imap{
+        {QStringLiteral("host"), QStringLiteral("127.0.0.1")},
+        {QStringLiteral("port"), static_cast<int>(port)},
+        {QStringLiteral("user"), QStringLiteral("cyrus")},
+        {QStringLiteral("password"), QStringLiteral("secret")},
+        {QStringLiteral("protocol"), static_cast<int>(QAbstractSocket::IPv4Protocol)},
+        {QStringLiteral("encryption"), static_cast<int>(Imap::Unsecured)}
+    };
+    SkaffariConfig::load({}, {}, {}, imap, {});
+}
+
+void ImapMockTest::testLogin_data()
+{
+    QTest::addColumn<QByteArray>("capabilities");
+
+    QTest::newRow("plain-sasl-ir") << QByteArrayLiteral("IMAP4rev1 ID NAMESPACE QUOTA SASL-IR AUTH=PLAIN");
+    QTest::newRow("plain") << QByteArrayLiteral("IMAP4rev1 ID NAMESPACE QUOTA AUTH=PLAIN");
+    QTest::newRow("login-sasl-ir") << QByteArrayLiteral("IMAP4rev1 ID NAMESPACE QUOTA SASL-IR AUTH=LOGIN");
+    QTest::newRow("login") << QByteArrayLiteral("IMAP4rev1 ID NAMESPACE QUOTA AUTH=LOGIN");
+    QTest::newRow("fallback") << QByteArrayLiteral("IMAP4rev1 ID NAMESPACE QUOTA");
+}
+
+void ImapMockTest::testLogin()
+{
+    QFETCH(QByteArray, capabilities);
+
+    MockImapServer server;
+    server.setCapabilities(capabilities);
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    Imap imap(nullptr);
+    QVERIFY2(imap.login(), qUtf8Printable(imap.lastError().text()));
+    QVERIFY(imap.isLoggedIn());
+    imap.logout();
+    QVERIFY(!imap.isLoggedIn());
+
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::testLoginFailed()
+{
+    Imap imap(nullptr);
+    QVERIFY(!imap.login(QStringLiteral("cyrus"), QStringLiteral("wrong")));
+    QCOMPARE(imap.lastError().type(), ImapError::NoResponse);
+}
+
+void ImapMockTest::testQuota()
+{
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+
+    quota_pair quota = imap.getQuota(MockImapServer::syntheticUser(1));
+    QVERIFY(!imap.lastError());
+    QCOMPARE(quota.first, static_cast<quota_size_t>(100));
+    QCOMPARE(quota.second, static_cast<quota_size_t>(1024 * 1024));
+
+    QVERIFY(imap.setQuota(MockImapServer::syntheticUser(1), 2048));
+    quota = imap.getQuota(MockImapServer::syntheticUser(1));
+    QCOMPARE(quota.second, static_cast<quota_size_t>(2048));
+    QCOMPARE(m_server.mailbox(QStringLiteral("user.test000001")).limit, static_cast<quint64>(2048));
+
+    imap.logout();
+}
+
+void ImapMockTest::testCreateDeleteMailbox()
+{
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+
+    QVERIFY(imap.createMailbox(QStringLiteral("newuser")));
+    QVERIFY(m_server.hasMailbox(QStringLiteral("user.newuser")));
+    QVERIFY(!imap.createMailbox(QStringLiteral("newuser")));
+
+    m_server.addMailbox(QStringLiteral("user.newuser.Sent"));
+
+    QVERIFY(imap.deleteMailbox(QStringLiteral("newuser")));
+    QVERIFY(!m_server.hasMailbox(QStringLiteral("user.newuser")));
+    QVERIFY(!m_server.hasMailbox(QStringLiteral("user.newuser.Sent")));
+
+    imap.logout();
+}
+
+void ImapMockTest::testGetMailboxes()
+{
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+
+    const QStringList mailboxes = imap.getMailboxes();
+    QCOMPARE(mailboxes.size(), 10);
+    QCOMPARE(mailboxes.constFirst(), MockImapServer::syntheticUser(1));
+
+    imap.logout();
+}
+
+void ImapMockTest::testProvisionMailboxes()
+{
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+
+    Imap::MailboxProvisioning mbp;
+    mbp.user = QStringLiteral("provisioned");
+    mbp.quota = 4096;
+    mbp.folders = {{Imap::SpecialUse::Sent, QStringLiteral("Sent")}, {Imap::SpecialUse::Trash, QStringLiteral("Trash")}};
+
+    m_server.resetCommandCounts();
+    const Imap::BatchResults results = imap.provisionMailboxes({mbp});
+    QCOMPARE(results.size(), 4);
+    for (const Imap::BatchResult &result : results) {
+        QVERIFY2(static_cast<bool>(result.response), qUtf8Printable(result.command));
+    }
+
+    QCOMPARE(m_server.commandCount("CREATE"), 3);
+    QCOMPARE(m_server.commandCount("SETQUOTA"), 1);
+    QVERIFY(m_server.hasMailbox(QStringLiteral("user.provisioned.Trash")));
+    QCOMPARE(m_server.mailbox(QStringLiteral("user.provisioned")).limit, static_cast<quint64>(4096));
+
+    QVERIFY(imap.deleteMailbox(QStringLiteral("provisioned")));
+
+    imap.logout();
+}
+
+void ImapMockTest::testHandler()
+{
+    MockImapServer server;
+    server.addMailboxes(1);
+    server.setHandler("GETQUOTA", [](const QList<QByteArray> &args) {
+        Q_UNUSED(args)
+        return MockImapServer::Reply{{}, QByteArrayLiteral("NO Quota service unavailable")};
+    });
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+    const quota_pair quota = imap.getQuota(MockImapServer::syntheticUser(1));
+    QCOMPARE(imap.lastError().type(), ImapError::NoResponse);
+    QCOMPARE(quota.second, static_cast<quota_size_t>(0));
+
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::testLatency()
+{
+    MockImapServer server;
+    server.addMailboxes(1);
+    server.setLatency(25);
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    Imap imap(nullptr);
+    QVERIFY(imap.login());
+    QElapsedTimer timer;
+    timer.start();
+    const quota_pair quota = imap.getQuota(MockImapServer::syntheticUser(1));
+    QVERIFY(timer.elapsed() >= 25);
+    QCOMPARE(quota.first, static_cast<quota_size_t>(100));
+    imap.logout();
+
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::benchmarkData() const
+{
+    QTest::addColumn<int>("mailboxes");
+    QTest::addColumn<int>("latency");
+
+    QTest::newRow("1k-0ms") << 1'000 << 0;
+    QTest::newRow("1k-1ms") << 1'000 << 1;
+    QTest::newRow("100k-0ms") << 100'000 << 0;
+    QTest::newRow("100k-1ms") << 100'000 << 1;
+}
+
+void ImapMockTest::benchmarkAccountList_data()
+{
+    benchmarkData();
+}
+
+/*
+ * IMAP part of Account::list(): one admin session and one GETQUOTA for
+ * every account on the page.
+ */
+void ImapMockTest::benchmarkAccountList()
+{
+    QFETCH(int, mailboxes);
+    QFETCH(int, latency);
+
+    MockImapServer server;
+    server.addMailboxes(mailboxes, {QStringLiteral("Sent"), QStringLiteral("Trash")});
+    server.setLatency(latency);
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    constexpr int pageSize = 25;
+
+    QBENCHMARK {
+        Imap imap(nullptr);
+        QVERIFY(imap.login());
+        for (int i = 1; i <= pageSize; ++i) {
+            const quota_pair quota = imap.getQuota(MockImapServer::syntheticUser(i));
+            Q_UNUSED(quota)
+        }
+        imap.logout();
+    }
+
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::benchmarkAccountCheck_data()
+{
+    benchmarkData();
+}
+
+/*
+ * IMAP part of Account::check(): list all user mailboxes, then
+ * check the quota of the account.
+ */
+void ImapMockTest::benchmarkAccountCheck()
+{
+    QFETCH(int, mailboxes);
+    QFETCH(int, latency);
+
+    MockImapServer server;
+    server.addMailboxes(mailboxes, {QStringLiteral("Sent"), QStringLiteral("Trash")});
+    server.setLatency(latency);
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    QBENCHMARK {
+        Imap imap(nullptr);
+        QVERIFY(imap.login());
+        const QStringList mboxes = imap.getMailboxes();
+        QCOMPARE(mboxes.size(), mailboxes);
+        const quota_pair quota = imap.getQuota(MockImapServer::syntheticUser(mailboxes));
+        Q_UNUSED(quota)
+        imap.logout();
+    }
+
+    loadConfig(m_server.serverPort());
+}
+
+void ImapMockTest::benchmarkDomainRemove_data()
+{
+    benchmarkData();
+}
+
+/*
+ * IMAP part of Domain::remove(): every account of the domain is removed by
+ * Account::remove() with its own admin session.
+ */
+void ImapMockTest::benchmarkDomainRemove()
+{
+    QFETCH(int, mailboxes);
+    QFETCH(int, latency);
+
+    constexpr int domainAccounts = 100;
+
+    MockImapServer server;
+    server.addMailboxes(mailboxes, {QStringLiteral("Sent"), QStringLiteral("Trash"), QStringLiteral("Drafts")});
+    server.setLatency(latency);
+    QVERIFY(server.start());
+    loadConfig(server.serverPort());
+
+    QBENCHMARK_ONCE {
+        for (int i = 1; i <= domainAccounts; ++i) {
+            Imap imap(nullptr);
+            QVERIFY(imap.login());
+            QVERIFY(imap.deleteMailbox(MockImapServer::syntheticUser(i)));
+            imap.logout();
+        }
+    }
+
+    QCOMPARE(server.mailboxCount(), (mailboxes - domainAccounts) * 4);
+
+    loadConfig(m_server.serverPort());
+}
+
+QTEST_MAIN(ImapMockTest)
+
+#include "testimapmock.moc"
@@ -0,0 +1,142 @@
+#include "../common/password.h"
+
+#include <QTest>
+#include <QSet>
+#include <crypt.h>
+#include <thread>
+#include <vector>
+
+class PasswordTest : public QObject
+{
+    Q_OBJECT
+public:
+    PasswordTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void cryptEncrypt_data();
+    void cryptEncrypt();
+    void concurrentEncrypt();
+    void cryptSalt();
+    void mysqlPassword_data();
+    void mysqlPassword();
+
+    void cleanupTestCase() {}
+
+private:
+    static QByteArray cryptReference(const QByteArray &phrase, const QByteArray &settings);
+};
+
+QByteArray PasswordTest::cryptReference(const QByteArray &phrase, const QByteArray &settings)
+{
+    crypt_data data{};
+    const char *result = crypt_r(phrase.constData(), settings.constData(), &data);
+    return result ? QByteArray(result) : QByteArray();
+}
+
+void PasswordTest::cryptEncrypt_data()
+{
+    QTest::addColumn<Password::Algorithm>("algo");
+    QTest::addColumn<quint32>("rounds");
+    QTest::addColumn<QByteArray>("prefix");
+
+    QTest::newRow("md5") << Password::CryptMD5 << 0U << QByteArrayLiteral("$1$");
+    QTest::newRow("sha256") << Password::CryptSHA256 << 5000U << QByteArrayLiteral("$5$rounds=5000$");
+    QTest::newRow("sha512") << Password::CryptSHA512 << 5000U << QByteArrayLiteral("$6$rounds=5000$");
+    QTest::newRow("default") << Password::Default << 1000U << QByteArrayLiteral("$5$rounds=1000$");
+}
+
+void PasswordTest::cryptEncrypt()
+{
+    QFETCH(Password::Algorithm, algo);
+    QFETCH(quint32, rounds);
+    QFETCH(QByteArray, prefix);
+
+    const QString pw = QStringLiteral("sëcret Passwörd");
+    const QByteArray enc = Password(pw).encrypt(Password::Crypt, algo, rounds);
+    QVERIFY(enc.startsWith(prefix));
+    // the hash itself contains the settings
+    QCOMPARE(cryptReference(pw.toUtf8(), enc), enc);
+}
+
+void PasswordTest::concurrentEncrypt()
+{
+    constexpr int threadCount = 4;
+    constexpr int perThread = 8;
+
+    std::vector<std::vector<std::pair<QString,QByteArray>>> encrypted(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([t, &encrypted]() {
+            for (int i = 0; i < perThread; ++i) {
+                const QString pw = QStringLiteral("password%1-%2").arg(t).arg(i);
+                encrypted[static_cast<std::size_t>(t)].emplace_back(pw, Password(pw).encrypt(Password::Crypt, Password::CryptSHA512, 1000));
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    QSet<QByteArray> unique;
+    for (const auto &results : encrypted) {
+        QCOMPARE(results.size(), static_cast<std::size_t>(perThread));
+        for (const auto &result : results) {
+            QVERIFY(result.second.startsWith("$6$rounds=1000$"));
+            QCOMPARE(cryptReference(result.first.toUtf8(), result.second), result.second);
+            unique.insert(result.second);
+        }
+    }
+    QCOMPARE(unique.size(), threadCount * perThread);
+}
+
+void PasswordTest::cryptSalt()
+{
+    static const QByteArray cryptChars = QByteArrayLiteral("./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
+
+    const Password pw(QStringLiteral("secret"));
+    QSet<QByteArray> salts;
+    for (int i = 0; i < 50; ++i) {
+        const QByteArray enc = pw.encrypt(Password::Crypt, Password::CryptMD5);
+        const QList<QByteArray> parts = enc.split('$');
+        QCOMPARE(parts.size(), 4);
+        const QByteArray salt = parts.at(2);
+        QCOMPARE(salt.size(), 8);
+        for (const char c : salt) {
+            QVERIFY2(cryptChars.contains(c), salt.constData());
+        }
+        salts.insert(salt);
+    }
+    QCOMPARE(salts.size(), 50);
+}
+
+void PasswordTest::mysqlPassword_data()
+{
+    QTest::addColumn<QString>("password");
+    QTest::addColumn<QByteArray>("newHash");
+    QTest::addColumn<QByteArray>("oldHash");
+
+    // expected results of the MySQL PASSWORD() and OLD_PASSWORD() functions
+    QTest::newRow("password") << QStringLiteral("password") << QByteArrayLiteral("*2470C0C06DEE42FD1618BB99005ADCA2EC9D1E19") << QByteArrayLiteral("5d2e19393cc5ef67");
+    QTest::newRow("mypass") << QStringLiteral("mypass") << QByteArrayLiteral("*6C8989366EAF75BB670AD8EA7A7FC1176A95CEF4") << QByteArrayLiteral("6f8c114b58f2ce9e");
+    QTest::newRow("mixed") << QStringLiteral("Sk4ff4ri") << QByteArrayLiteral("*41BD3C0A2EB27AF80F239593796D4313F9A3F643") << QByteArrayLiteral("2fcfb5775c032ae5");
+    QTest::newRow("space") << QStringLiteral("pass word") << QByteArrayLiteral("*EDBBEA7F4E7B5D8B0BC8D7AC5D1936FB7DA10611") << QByteArrayLiteral("5d2e19393cc5ef67");
+    QTest::newRow("empty") << QString() << QByteArray() << QByteArray();
+}
+
+void PasswordTest::mysqlPassword()
+{
+    QFETCH(QString, password);
+    QFETCH(QByteArray, newHash);
+    QFETCH(QByteArray, oldHash);
+
+    const Password pw(password);
+    QCOMPARE(pw.encrypt(Password::MySQL, Password::MySQLNew), newHash);
+    QCOMPARE(pw.encrypt(Password::MySQL, Password::Default), newHash);
+    QCOMPARE(pw.encrypt(Password::MySQL, Password::MySQLOld), oldHash);
+}
+
+QTEST_MAIN(PasswordTest)
+
+#include "testpassword.moc"
@@ -0,0 +1,224 @@
+#include "imap/quotaeventlistener.h"
+#include "imap/quotacache.h"
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+class QuotaEventsTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QuotaEventsTest(QObject *parent = nullptr)
+        : QObject{parent}
+    {}
+    ~QuotaEventsTest() override = default;
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testParse_data();
+    void testParse();
+
+    void testApply();
+
+    void testListen();
+
+private:
+    static QByteArray notifydDatagram(const QByteArray &event);
+    static bool send(const QString &path, const QByteArray &datagram);
+};
+
+void QuotaEventsTest::initTestCase()
+{
+    qRegisterMetaType<QuotaEventListener::Event>();
+}
+
+QByteArray QuotaEventsTest::notifydDatagram(const QByteArray &event)
+{
+    static const char header[] = "log\0EVENT\0NOTICE\0\0\0" "0\0";
+    QByteArray datagram(header, sizeof(header) - 1);
+    datagram.append(event);
+    datagram.append('\0');
+    datagram.append('\0');
+    return datagram;
+}
+
+bool QuotaEventsTest::send(const QString &path, const QByteArray &datagram)
+{
+    const QByteArray encoded = QFile::encodeName(path);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, encoded.constData(), static_cast<size_t>(encoded.size()));
+
+    const int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::sendto(fd, datagram.constData(), static_cast<size_t>(datagram.size()), 0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == datagram.size();
+    ::close(fd);
+    return ok;
+}
+
+void QuotaEventsTest::testParse_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("type");
+    QTest::addColumn<QString>("user");
+    QTest::addColumn<QString>("mailbox");
+    QTest::addColumn<bool>("userRoot");
+    QTest::addColumn<qint64>("used");
+    QTest::addColumn<qint64>("limit");
+
+    const QByteArray quotaChange = QByteArrayLiteral(R"({"event":"QuotaChange","timestamp":"2024-03-01T10:00:00.000+01:00","service":"imapd","uri":"imap://john%40example.com@mail.example.com/INBOX","diskQuota":10240,"diskUsed":2048,"maxMessages":-1,"messages":12,"pid":1234,"user":"cyrus"})");
+
+    QTest::newRow("json") << quotaChange << true << QStringLiteral("QuotaChange") << QStringLiteral("john@example.com") << QStringLiteral("INBOX") << true << Q_INT64_C(2048) << Q_INT64_C(10240);
+
+    QTest::newRow("notifyd") << notifydDatagram(quotaChange) << true << QStringLiteral("QuotaChange") << QStringLiteral("john@example.com") << QStringLiteral("INBOX") << true << Q_INT64_C(2048) << Q_INT64_C(10240);
+
+    QTest::newRow("quota-exceeded") << QByteArrayLiteral(R"({"event":"QuotaExceeded","uri":"imap://jane@mail.example.com/INBOX","diskQuota":1024,"diskUsed":1030})")
+                                    << true << QStringLiteral("QuotaExceeded") << QStringLiteral("jane") << QStringLiteral("INBOX") << true << Q_INT64_C(1030) << Q_INT64_C(1024);
+
+    QTest::newRow("message-new") << QByteArrayLiteral(R"({"event":"MessageNew","uri":"imap://jane@mail.example.com/INBOX;UIDVALIDITY=1712;UID=7","diskUsed":"512"})")
+                                 << true << QStringLiteral("MessageNew") << QStringLiteral("jane") << QStringLiteral("INBOX") << true << Q_INT64_C(512) << Q_INT64_C(-1);
+
+    QTest::newRow("mailbox-create") << QByteArrayLiteral(R"({"event":"MailboxCreate","uri":"imap://jane@mail.example.com/INBOX;UIDVALIDITY=1712","user":"cyrus"})")
+                                    << true << QStringLiteral("MailboxCreate") << QStringLiteral("jane") << QStringLiteral("INBOX") << true << Q_INT64_C(-1) << Q_INT64_C(-1);
+
+    QTest::newRow("mailbox-delete-folder") << QByteArrayLiteral(R"({"event":"MailboxDelete","uri":"imap://jane@mail.example.com/INBOX/Sent;UIDVALIDITY=1713"})")
+                                           << true << QStringLiteral("MailboxDelete") << QStringLiteral("jane") << QStringLiteral("INBOX/Sent") << false << Q_INT64_C(-1) << Q_INT64_C(-1);
+
+    QTest::newRow("shared") << QByteArrayLiteral(R"({"event":"QuotaChange","uri":"imap://mail.example.com/shared","diskQuota":1024,"diskUsed":10})")
+                            << true << QStringLiteral("QuotaChange") << QString() << QStringLiteral("shared") << false << Q_INT64_C(10) << Q_INT64_C(1024);
+
+    QTest::newRow("no-event") << QByteArrayLiteral(R"({"uri":"imap://jane@mail.example.com/INBOX","diskUsed":10})")
+                              << false << QString() << QString() << QString() << false << Q_INT64_C(-1) << Q_INT64_C(-1);
+
+    QTest::newRow("invalid-json") << QByteArrayLiteral(R"({"event":"QuotaChange",)")
+                                  << false << QString() << QString() << QString() << false << Q_INT64_C(-1) << Q_INT64_C(-1);
+
+    QTest::newRow("plain-notify") << QByteArray("mailto\0MESSAGE\0NORMAL\0jane\0INBOX\0" "0\0You have new mail\0\0", 54)
+                                  << false << QString() << QString() << QString() << false << Q_INT64_C(-1) << Q_INT64_C(-1);
+}
+
+void QuotaEventsTest::testParse()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, valid);
+    QFETCH(QString, type);
+    QFETCH(QString, user);
+    QFETCH(QString, mailbox);
+    QFETCH(bool, userRoot);
+    QFETCH(qint64, used);
+    QFETCH(qint64, limit);
+
+    const QuotaEventListener::Event event = QuotaEventListener::parse(data);
+    QCOMPARE(event.isValid(), valid);
+    if (!valid) {
+        return;
+    }
+
+    QCOMPARE(event.type, type);
+    QCOMPARE(event.user, user);
+    QCOMPARE(event.mailbox, mailbox);
+    QCOMPARE(event.isUserRoot(), userRoot);
+    QCOMPARE(event.used.has_value(), used >= 0);
+    if (used >= 0) {
+        QCOMPARE(*event.used, static_cast<quota_size_t>(used));
+    }
+    QCOMPARE(event.limit.has_value(), limit >= 0);
+    if (limit >= 0) {
+        QCOMPARE(*event.limit, static_cast<quota_size_t>(limit));
+    }
+}
+
+void QuotaEventsTest::testApply()
+{
+    QuotaEventListener listener;
+    const QString user = QStringLiteral("apply@example.com");
+
+    // usage without limit is not stored if the limit is not known yet
+    listener.apply(QuotaEventListener::parse(QByteArrayLiteral(R"({"event":"MessageNew","uri":"imap://apply%40example.com@localhost/INBOX","diskUsed":5})")));
+    QVERIFY(!QuotaCache::value(user));
+
+    listener.apply(QuotaEventListener::parse(QByteArrayLiteral(R"({"event":"QuotaChange","uri":"imap://apply%40example.com@localhost/INBOX","diskQuota":4096,"diskUsed":100})")));
+    auto cached = QuotaCache::value(user);
+    QVERIFY(cached);
+    QCOMPARE(cached->first, static_cast<quota_size_t>(100));
+    QCOMPARE(cached->second, static_cast<quota_size_t>(4096));
+    // not listening, so the values are no replacement for asking the IMAP server
+    QVERIFY(!QuotaCache::current(user));
+
+    listener.apply(QuotaEventListener::parse(QByteArrayLiteral(R"({"event":"MessageExpunge","uri":"imap://apply%40example.com@localhost/INBOX","diskUsed":80})")));
+    cached = QuotaCache::value(user);
+    QVERIFY(cached);
+    QCOMPARE(cached->first, static_cast<quota_size_t>(80));
+    QCOMPARE(cached->second, static_cast<quota_size_t>(4096));
+
+    // creating a folder does not change the usage
+    listener.apply(QuotaEventListener::parse(QByteArrayLiteral(R"({"event":"MailboxCreate","uri":"imap://apply%40example.com@localhost/INBOX/Archive"})")));
+    QVERIFY(QuotaCache::value(user));
+
+    listener.apply(QuotaEventListener::parse(QByteArrayLiteral(R"({"event":"MailboxDelete","uri":"imap://apply%40example.com@localhost/INBOX/Archive"})")));
+    QVERIFY(!QuotaCache::value(user));
+}
+
+void QuotaEventsTest::testListen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("notify"));
+
+    auto first = new QuotaEventListener;
+    QVERIFY(first->listen(path));
+    QVERIFY(first->isListening());
+    QVERIFY(QuotaCache::isEventFed());
+
+    QuotaEventListener second;
+    QVERIFY(!second.listen(path));
+    QVERIFY(QuotaCache::isEventFed());
+
+    QSignalSpy spy(first, &QuotaEventListener::eventReceived);
+    QVERIFY(send(path, notifydDatagram(QByteArrayLiteral(R"({"event":"QuotaWithin","uri":"imap://listen@localhost/INBOX","diskQuota":2048,"diskUsed":1000})"))));
+    QVERIFY(send(path, QByteArrayLiteral("garbage")));
+    QVERIFY(send(path, notifydDatagram(QByteArrayLiteral(R"({"event":"MailboxDelete","uri":"imap://other@localhost/INBOX"})"))));
+    QTRY_COMPARE(spy.count(), 2);
+
+    const auto cached = QuotaCache::value(QStringLiteral("listen"));
+    QVERIFY(cached);
+    QCOMPARE(cached->first, static_cast<quota_size_t>(1000));
+    QCOMPARE(cached->second, static_cast<quota_size_t>(2048));
+    const auto current = QuotaCache::current(QStringLiteral("listen"));
+    QVERIFY(current);
+    QCOMPARE(current->first, static_cast<quota_size_t>(1000));
+
+    delete first;
+    QVERIFY(!QFile::exists(path));
+    QVERIFY(!QuotaCache::isEventFed());
+    QVERIFY(!QuotaCache::current(QStringLiteral("listen")));
+
+    // a socket file without listener is taken over
+    const int stale = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const QByteArray encoded = QFile::encodeName(path);
+    std::memcpy(addr.sun_path, encoded.constData(), static_cast<size_t>(encoded.size()));
+    QCOMPARE(::bind(stale, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    ::close(stale);
+    QVERIFY(QFile::exists(path));
+
+    QVERIFY(second.listen(path));
+}
+
+QTEST_MAIN(QuotaEventsTest)
+
+#include "testquotaevents.moc"
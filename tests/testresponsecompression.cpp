@@ -0,0 +1,92 @@
+#include "../src/plugins/responsecompression.h"
+
+#include <QTest>
+
+#include <zlib.h>
+
+class ResponseCompressionTest : public QObject
+{
+    Q_OBJECT
+public:
+    ResponseCompressionTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void compress_data();
+    void compress();
+
+    void cleanupTestCase() {}
+
+private:
+    static QByteArray inflate(const QByteArray &data, bool gzip);
+};
+
+QByteArray ResponseCompressionTest::inflate(const QByteArray &data, bool gzip)
+{
+    QByteArray out;
+    z_stream stream{};
+    if (inflateInit2(&stream, gzip ? 31 : 15) != Z_OK) {
+        return out;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    char buf[4096];
+    int ret = Z_OK;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buf);
+        stream.avail_out = sizeof(buf);
+        ret = ::inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            inflateEnd(&stream);
+            return QByteArray();
+        }
+        out.append(buf, static_cast<int>(sizeof(buf) - stream.avail_out));
+    } while (ret != Z_STREAM_END);
+
+    inflateEnd(&stream);
+    return out;
+}
+
+void ResponseCompressionTest::compress_data()
+{
+    QTest::addColumn<int>("level");
+    QTest::addColumn<bool>("gzip");
+
+    QTest::newRow("gzip-1") << 1 << true;
+    QTest::newRow("gzip-6") << 6 << true;
+    QTest::newRow("gzip-9") << 9 << true;
+    QTest::newRow("deflate-1") << 1 << false;
+    QTest::newRow("deflate-6") << 6 << false;
+    QTest::newRow("deflate-9") << 9 << false;
+}
+
+void ResponseCompressionTest::compress()
+{
+    QFETCH(int, level);
+    QFETCH(bool, gzip);
+
+    QByteArray json("[");
+    for (int i = 0; i < 500; ++i) {
+        if (i > 0) {
+            json.append(',');
+        }
+        json.append("{\"id\":" + QByteArray::number(i) + ",\"username\":\"user" + QByteArray::number(i) + "\",\"domainName\":\"example.com\"}");
+    }
+    json.append(']');
+
+    const QByteArray compressed = ResponseCompression::compress(json, level, gzip);
+    QVERIFY(!compressed.isEmpty());
+    QVERIFY(compressed.size() < json.size() / 4);
+    if (gzip) {
+        QCOMPARE(static_cast<quint8>(compressed.at(0)), static_cast<quint8>(0x1f));
+        QCOMPARE(static_cast<quint8>(compressed.at(1)), static_cast<quint8>(0x8b));
+    }
+    QCOMPARE(inflate(compressed, gzip), json);
+}
+
+QTEST_MAIN(ResponseCompressionTest)
+
+#include "testresponsecompression.moc"
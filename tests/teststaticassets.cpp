@@ -0,0 +1,55 @@
+#include "../src/plugins/staticassets.h"
+
+#include <QTest>
+
+class StaticAssetsTest : public QObject
+{
+    Q_OBJECT
+public:
+    StaticAssetsTest(QObject *parent = nullptr) : QObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase() {}
+
+    void acceptsEncoding_data();
+    void acceptsEncoding();
+    void assetPathWithoutManifest();
+
+    void cleanupTestCase() {}
+};
+
+void StaticAssetsTest::acceptsEncoding_data()
+{
+    QTest::addColumn<QString>("header");
+    QTest::addColumn<QString>("coding");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("empty") << QString() << QStringLiteral("gzip") << false;
+    QTest::newRow("single") << QStringLiteral("gzip") << QStringLiteral("gzip") << true;
+    QTest::newRow("list") << QStringLiteral("gzip, deflate, br") << QStringLiteral("br") << true;
+    QTest::newRow("missing") << QStringLiteral("gzip, deflate") << QStringLiteral("br") << false;
+    QTest::newRow("case") << QStringLiteral("GZip") << QStringLiteral("gzip") << true;
+    QTest::newRow("quality") << QStringLiteral("br;q=0.8, gzip;q=1.0") << QStringLiteral("br") << true;
+    QTest::newRow("quality-zero") << QStringLiteral("br;q=0, gzip") << QStringLiteral("br") << false;
+    QTest::newRow("quality-zero-spaces") << QStringLiteral("gzip ; q=0.000") << QStringLiteral("gzip") << false;
+    QTest::newRow("prefix") << QStringLiteral("x-gzip") << QStringLiteral("gzip") << false;
+}
+
+void StaticAssetsTest::acceptsEncoding()
+{
+    QFETCH(QString, header);
+    QFETCH(QString, coding);
+    QFETCH(bool, result);
+
+    const QByteArray codingLatin1 = coding.toLatin1();
+    QCOMPARE(StaticAssets::acceptsEncoding(header, QLatin1String(codingLatin1)), result);
+}
+
+void StaticAssetsTest::assetPathWithoutManifest()
+{
+    QCOMPARE(StaticAssets::assetPath(QStringLiteral("/css/style.css")), QStringLiteral("/css/style.css"));
+}
+
+QTEST_MAIN(StaticAssetsTest)
+
+#include "teststaticassets.moc"
@@ -1,7 +1,4 @@
-#include "../grantlee/stringformatfilter.h"
-#include <grantlee/filter.h>
-#include <grantlee/engine.h>
-#include <grantlee/template.h>
+#include "../src/cutelee/stringformatfilter.h"
 
 #include <QTest>
 
@@ -12,35 +9,125 @@ public:
     StringFormatFilterTest(QObject *parent = nullptr) : QObject(parent) {}
 
 private Q_SLOTS:
-    void initTestCase();
+    void initTestCase() {}
 
-    void simpleTest();
+    void parse();
+    void doFilter_data();
+    void doFilter();
+    void invalidInput();
 
-    void cleanupTestCase();
+    void benchmarkDoFilter_data();
+    void benchmarkDoFilter();
 
-private:
-    void doTest();
-
-    Grantlee::Engine *m_engine = nullptr;
-    QSharedPointer<Grantlee::InMemoryTemplateLoader> m_loader;
+    void cleanupTestCase() {}
 };
 
-void StringFormatFilterTest::initTestCase()
+void StringFormatFilterTest::parse()
+{
+    const StringformatFilter::FormatSpec spec = StringformatFilter::parse(QStringLiteral("%-+08.3lld"));
+    QVERIFY(spec.isValid());
+    QCOMPARE(spec.conversion, QChar(QLatin1Char('d')));
+    QCOMPARE(spec.lengthModifier, StringformatFilter::ll);
+    QCOMPARE(spec.fieldWidth, 8);
+    QCOMPARE(spec.precision, 3);
+    QVERIFY(spec.leftJustified);
+    QVERIFY(spec.forceSign);
+    QVERIFY(spec.leadingZeroPad);
+    QVERIFY(!spec.prependSpace);
+    QVERIFY(!spec.altForm);
+
+    QCOMPARE(StringformatFilter::parse(QStringLiteral("s")).precision, -1);
+    QCOMPARE(StringformatFilter::parse(QStringLiteral(".s")).precision, 0);
+    QVERIFY(!StringformatFilter::parse(QString()).isValid());
+    QVERIFY(!StringformatFilter::parse(QStringLiteral("5")).isValid());
+}
+
+void StringFormatFilterTest::doFilter_data()
+{
+    QTest::addColumn<QVariant>("input");
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("string") << QVariant(QStringLiteral("abc")) << QStringLiteral("s") << QStringLiteral("abc");
+    QTest::newRow("string-width") << QVariant(QStringLiteral("abc")) << QStringLiteral("%5s") << QStringLiteral("  abc");
+    QTest::newRow("string-left") << QVariant(QStringLiteral("abc")) << QStringLiteral("-5s") << QStringLiteral("abc  ");
+    QTest::newRow("string-precision") << QVariant(QStringLiteral("abcdef")) << QStringLiteral(".3s") << QStringLiteral("abc");
+    QTest::newRow("char") << QVariant(QChar(QLatin1Char('x'))) << QStringLiteral("3c") << QStringLiteral("  x");
+    QTest::newRow("int") << QVariant(42) << QStringLiteral("d") << QStringLiteral("42");
+    QTest::newRow("int-negative") << QVariant(-42) << QStringLiteral("i") << QStringLiteral("-42");
+    QTest::newRow("int-zero-pad") << QVariant(-42) << QStringLiteral("05d") << QStringLiteral("-0042");
+    QTest::newRow("int-force-sign") << QVariant(42) << QStringLiteral("+d") << QStringLiteral("+42");
+    QTest::newRow("int-space") << QVariant(42) << QStringLiteral("% d") << QStringLiteral(" 42");
+    QTest::newRow("int-precision") << QVariant(7) << QStringLiteral("6.3d") << QStringLiteral("   007");
+    QTest::newRow("int-string-input") << QVariant(QStringLiteral("123")) << QStringLiteral("d") << QStringLiteral("123");
+    QTest::newRow("int-out-of-range") << QVariant(300) << QStringLiteral("hhd") << QStringLiteral("300");
+    QTest::newRow("longlong") << QVariant(Q_INT64_C(-9223372036854775807) - 1) << QStringLiteral("lld") << QStringLiteral("-9223372036854775808");
+    QTest::newRow("unsigned") << QVariant(4294967295U) << QStringLiteral("u") << QStringLiteral("4294967295");
+    QTest::newRow("octal-alt") << QVariant(8U) << QStringLiteral("#o") << QStringLiteral("010");
+    QTest::newRow("hex") << QVariant(255U) << QStringLiteral("x") << QStringLiteral("ff");
+    QTest::newRow("hex-upper-alt") << QVariant(255U) << QStringLiteral("#06X") << QStringLiteral("0X00FF");
+    QTest::newRow("double") << QVariant(3.14159) << QStringLiteral(".2f") << QStringLiteral("3.14");
+    QTest::newRow("double-default-precision") << QVariant(1.5) << QStringLiteral("f") << QStringLiteral("1.500000");
+    QTest::newRow("double-zero-pad") << QVariant(-1.5) << QStringLiteral("08.2f") << QStringLiteral("-0001.50");
+    QTest::newRow("double-exp") << QVariant(12345.678) << QStringLiteral(".2E") << QStringLiteral("1.23E+04");
+    QTest::newRow("double-general") << QVariant(0.0001234) << QStringLiteral("g") << QStringLiteral("0.0001234");
+}
+
+void StringFormatFilterTest::doFilter()
 {
-    m_engine = new Grantlee::Engine(this);
-    QVERIFY(m_engine);
+    QFETCH(QVariant, input);
+    QFETCH(QString, format);
+    QFETCH(QString, expected);
 
-    m_loader = QSharedPointer<Grantlee::InMemoryTemplateLoader>(new Grantlee::InMemoryTemplateLoader());
+    const StringformatFilter filter;
+    // the second run uses the cached spec
+    for (int i = 0; i < 2; ++i) {
+        QCOMPARE(filter.doFilter(input, QVariant(format)).toString(), expected);
+    }
 }
 
-void StringFormatFilterTest::simpleTest()
+void StringFormatFilterTest::invalidInput()
 {
+    const StringformatFilter filter;
+    QVERIFY(!filter.doFilter(QVariant(), QVariant(QStringLiteral("s"))).isValid());
+    QCOMPARE(filter.doFilter(QVariant(QStringLiteral("abc")), QVariant(QStringLiteral("d"))).toString(), QStringLiteral("abc"));
+    QCOMPARE(filter.doFilter(QVariant(QStringLiteral("abc")), QVariant(QString())).toString(), QStringLiteral("abc"));
+}
 
+void StringFormatFilterTest::benchmarkDoFilter_data()
+{
+    QTest::addColumn<QVariant>("input");
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<bool>("parseEveryTime");
+
+    QTest::newRow("string") << QVariant(QStringLiteral("john.doe@example.com")) << QStringLiteral("-30s") << false;
+    QTest::newRow("string-parse") << QVariant(QStringLiteral("john.doe@example.com")) << QStringLiteral("-30s") << true;
+    QTest::newRow("int") << QVariant(12345) << QStringLiteral("08d") << false;
+    QTest::newRow("int-parse") << QVariant(12345) << QStringLiteral("08d") << true;
+    QTest::newRow("double") << QVariant(98.7654) << QStringLiteral("6.2f") << false;
+    QTest::newRow("double-parse") << QVariant(98.7654) << QStringLiteral("6.2f") << true;
 }
 
-void StringFormatFilterTest::cleanupTestCase()
+void StringFormatFilterTest::benchmarkDoFilter()
 {
-    delete m_engine;
+    QFETCH(QVariant, input);
+    QFETCH(QString, format);
+    QFETCH(bool, parseEveryTime);
+
+    const StringformatFilter filter;
+    const QVariant argument(format);
+
+    QString result;
+    if (parseEveryTime) {
+        QBENCHMARK {
+            result = StringformatFilter::format(input, StringformatFilter::parse(format));
+        }
+    } else {
+        QBENCHMARK {
+            result = filter.doFilter(input, argument).toString();
+        }
+    }
+    QVERIFY(!result.isEmpty());
 }
 
 QTEST_MAIN(StringFormatFilterTest)